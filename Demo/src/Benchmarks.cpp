@@ -0,0 +1,177 @@
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <string>
+
+#include "Log.h"
+#include "MemBuffer.h"
+#include "PODArray.h"
+#include "MessageBus.h"
+#include "SystemStack.h"
+#include "EngineMessages.h"
+#include "Framework.h"
+#include "JobPool.h"
+
+#define BENCH_MESSAGE_COUNT (2 * 1024 * 1024)
+#define BENCH_FONT_PATH "../Engine/assets/fonts/NotoSans-BSR.ttf"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double ElapsedMS(Clock::time_point a_start)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - a_start).count();
+}
+
+//--------------------------------------------------------------------------------------
+// The MessageBus as it was before it went lock-free, kept for comparison.
+//--------------------------------------------------------------------------------------
+class MutexMessageQueue
+{
+public:
+
+  MutexMessageQueue(size_t a_memSize)
+    : m_buf(a_memSize)
+  {
+
+  }
+
+  void Register(Engine::TRef<Engine::Message> const & a_message)
+  {
+    size_t sze = a_message->Size();
+    void * buf = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      buf = m_buf.Allocate(sze);
+      m_messageQueue.push_back(static_cast<Engine::Message *>(buf));
+    }
+    a_message->Clone(buf);
+  }
+
+  // Returns the number of messages dispatched, to compare with MessageBus::MessageCount()
+  size_t Dispatch()
+  {
+    size_t dispatched = 0;
+    for (size_t i = 0; i < m_messageQueue.size(); i++)
+    {
+      // Handled messages would be skipped, as there are no systems to pass them to
+      if (!m_messageQueue[i]->QueryFlag(Engine::Message::Flag::Handled))
+        dispatched++;
+    }
+    m_messageQueue.clear();
+    m_buf.clear();
+    return dispatched;
+  }
+
+private:
+
+  std::mutex                  m_mutex;
+  PODArray<Engine::Message *> m_messageQueue;
+  MemBuffer                   m_buf;
+};
+
+//--------------------------------------------------------------------------------------
+// Benchmarks
+//--------------------------------------------------------------------------------------
+
+// Splits BENCH_MESSAGE_COUNT posts over a number of threads
+template<typename PostFn>
+static double TimePosts(uint32_t a_threadCount, PostFn a_post)
+{
+  uint32_t perThread = BENCH_MESSAGE_COUNT / a_threadCount;
+  std::vector<std::thread> threads;
+
+  Clock::time_point start = Clock::now();
+  for (uint32_t t = 0; t < a_threadCount; t++)
+  {
+    threads.push_back(std::thread([perThread, &a_post]()
+      {
+        Engine::TRef<Engine::Message> msg = Engine::StaticPointerCast<Engine::Message>(Engine::TRef<Engine::Message_GUI_Up>::New());
+        for (uint32_t i = 0; i < perThread; i++)
+          a_post(msg);
+      }));
+  }
+
+  for (auto & thread : threads)
+    thread.join();
+
+  return ElapsedMS(start);
+}
+
+// Note: this will dispatch, and drop, any messages already on the bus.
+void BENCH_MessageBus()
+{
+  uint32_t const threadCounts[] = {1, 2, 4, 8, 16};
+  Engine::SystemStack emptyStack;
+
+  for (uint32_t threadCount : threadCounts)
+  {
+    MutexMessageQueue mutexQueue(BENCH_MESSAGE_COUNT * 2 * sizeof(Engine::Message_GUI_Up));
+    double mutexPost = TimePosts(threadCount, [&mutexQueue](Engine::TRef<Engine::Message> const & a_msg)
+      {
+        mutexQueue.Register(a_msg);
+      });
+
+    Clock::time_point start = Clock::now();
+    size_t mutexCount = mutexQueue.Dispatch();
+    double mutexDispatch = ElapsedMS(start);
+
+    double lockFreePost = TimePosts(threadCount, [](Engine::TRef<Engine::Message> const & a_msg)
+      {
+        POST(a_msg);
+      });
+
+    size_t lockFreeCount = Engine::MessageBus::Instance()->MessageCount();
+    start = Clock::now();
+    Engine::MessageBus::Instance()->DispatchMessages(emptyStack);
+    double lockFreeDispatch = ElapsedMS(start);
+
+    LOG_INFO("MessageBus, {} thread(s): mutex {} msgs, post {:.2f} ms, dispatch {:.2f} ms | lock-free {} msgs, post {:.2f} ms, dispatch {:.2f} ms",
+      threadCount, mutexCount, mutexPost, mutexDispatch, lockFreeCount, lockFreePost, lockFreeDispatch);
+  }
+}
+
+// Every glyph in the font at a few sizes, committed with different thread counts
+void BENCH_FontAtlas()
+{
+  // A thread count of 1 rasterises on the calling thread, and is the serial baseline the
+  // others are compared to. 0 is the default, one slice per JobPool thread.
+  uint32_t const threadCounts[] = {1, 2, 4, 8, 16, 0};
+  uint32_t const sizes[] = {12, 16, 24, 32, 48};
+  Engine::FontID fontID;
+
+  if (Engine::IFontAtlas::RegisterFont(BENCH_FONT_PATH, fontID) != Dg::ErrorCode::None)
+  {
+    LOG_WARN("BENCH_FontAtlas(): Failed to register font '{}'", BENCH_FONT_PATH);
+    return;
+  }
+
+  double serial = 0.0;
+  for (uint32_t threadCount : threadCounts)
+  {
+    Engine::Ref<Engine::IFontAtlas> atlas = Engine::Framework::Instance()->CreateFontAtlas();
+    atlas->SetLoadThreadCount(threadCount);
+    atlas->BeginLoad();
+    for (uint32_t size : sizes)
+      atlas->RegisterAllGlyphs(fontID, size);
+
+    Clock::time_point start = Clock::now();
+    Dg::ErrorCode result = atlas->CommitLoad();
+    double commit = ElapsedMS(start);
+
+    if (threadCount == 1)
+      serial = commit;
+
+    std::string slices = threadCount == 0 ? "default" : std::to_string(threadCount);
+    LOG_INFO("FontAtlas CommitLoad, {} slice(s) on {} thread(s): {:.2f} ms, {:.2f}x serial{}", slices, Engine::JobPool::GetConcurrency(), commit,
+      commit > 0.0 ? serial / commit : 0.0, result == Dg::ErrorCode::None ? "" : " (failed)");
+  }
+}
+
+void RunBenchmarks()
+{
+  BENCH_MessageBus();
+  BENCH_FontAtlas();
+
+  LOG_INFO("Finished running benchmarks.");
+}
\ No newline at end of file
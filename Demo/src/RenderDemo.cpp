@@ -158,15 +158,15 @@ void RenderDemo::OnAttach()
 
     // Set Uniform Buffer
     m_bindingPoint = BindingPoint::Create(StorageBlockType::Uniform, ShaderDomain::Fragment);
-    m_ubo = UniformBuffer::Create((uint32_t)sizeof(UBOData));
+    m_ubo = UniformBuffer::Create((uint32_t)sizeof(UBOData), BF_None);
     m_ubo->Bind(m_bindingPoint);
   }
 }
 
 void RenderDemo::Render()
 {
-  m_material->Bind();
-  m_va->Bind();
+  RenderState state = RenderState::Create();
+  state.Set<RenderState::Attr::System>(RenderState::System::Game);
 
-  Renderer::DrawIndexed(m_va, Engine::RenderMode::Triangles, 25);
+  Renderer::DrawIndexed(state, m_va, m_material, Engine::RenderMode::Triangles, 25);
 }
\ No newline at end of file
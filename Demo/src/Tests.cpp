@@ -4,6 +4,17 @@
 #include "Buffer.h"
 #include "unicode.h"
 #include "ShaderUniform.h"
+#include "RenderCommandQueue.h"
+#include "SystemStack.h"
+#include "EngineMessages.h"
+#include "MemBuffer.h"
+#include "Options.h"
+#include "TextureProcessing.h"
+#include "JobPool.h"
+
+#include <thread>
+#include <filesystem>
+#include <atomic>
 
 #define CHECK(val) do { if (!(val)) LOG_ERROR("TEST FAILED! Line: {}", __LINE__); } while(false)
 
@@ -89,11 +100,391 @@ void TEST_UTF8()
   CHECK(parser.Done());
 }
 
+namespace
+{
+  std::vector<int> g_executed;
+
+  void RecordCommand(void * a_ptr)
+  {
+    g_executed.push_back(*static_cast<int *>(a_ptr));
+  }
+
+  void SubmitTestCommand(Engine::RenderCommandQueue & a_queue, Engine::RenderState a_state, int a_id)
+  {
+    void * ptr = a_queue.AllocateForCommand(a_state, RecordCommand, sizeof(int));
+    *static_cast<int *>(ptr) = a_id;
+  }
+
+  void SubmitTestDraw(Engine::RenderCommandQueue & a_queue, uint64_t a_translucency, uint64_t a_material, uint64_t a_vao, uint64_t a_depth, int a_id)
+  {
+    Engine::RenderState state = Engine::RenderState::Create();
+    state.Set<Engine::RenderState::Attr::Type>(Engine::RenderState::Type::DrawCall);
+    state.Set<Engine::RenderState::Attr::Translucency>(a_translucency);
+    state.Set<Engine::RenderState::Attr::Material>(a_material);
+    state.Set<Engine::RenderState::Attr::VAO>(a_vao);
+    state.Set<Engine::RenderState::Attr::Depth>(a_depth);
+    SubmitTestCommand(a_queue, state, a_id);
+  }
+}
+
+void TEST_RenderCommandSort()
+{
+  uint64_t const opaque = Engine::RenderState::Translucency::None;
+  uint64_t const blended = Engine::RenderState::Translucency::Additive;
+
+  Engine::RenderCommandQueue queue;
+  g_executed.clear();
+
+  // Opaque draws group by material, then vertex array, then depth. Equal keys keep their order.
+  SubmitTestDraw(queue, opaque, 2, 1, 5, 0);
+  SubmitTestDraw(queue, opaque, 1, 2, 9, 1);
+  SubmitTestDraw(queue, opaque, 1, 1, 3, 2);
+  SubmitTestDraw(queue, opaque, 2, 1, 5, 3);
+
+  // Commands are not moved, and draws are not sorted across them
+  Engine::RenderState command = Engine::RenderState::Create();
+  command.Set<Engine::RenderState::Attr::Type>(Engine::RenderState::Type::Command);
+  command.Set<Engine::RenderState::Attr::Command>(Engine::RenderState::Command::Clear);
+  SubmitTestCommand(queue, command, 4);
+
+  // Translucent draws come after opaque ones, furthest first, whatever their material
+  SubmitTestDraw(queue, blended, 1, 1, 1, 5);
+  SubmitTestDraw(queue, blended, 2, 1, 7, 6);
+  SubmitTestDraw(queue, opaque, 3, 3, 0, 7);
+
+  queue.Swap();
+  queue.Execute();
+
+  int const expected[] = {2, 1, 0, 3, 4, 7, 6, 5};
+  CHECK(g_executed.size() == ARRAY_SIZE_32(expected));
+  for (size_t i = 0; i < g_executed.size() && i < ARRAY_SIZE_32(expected); i++)
+    CHECK(g_executed[i] == expected[i]);
+}
+
+void TEST_RenderCommandThreadSlots()
+{
+  Engine::RenderCommandQueue queue;
+  Engine::RenderCommandQueue other;
+  g_executed.clear();
+
+  // A thread which exits keeps its slot until what it recorded has been merged
+  std::thread([&queue]() { CHECK(queue.SetThreadSlot(3)); SubmitTestDraw(queue, 0, 1, 1, 1, 0); }).join();
+  std::thread([&queue]() { CHECK(!queue.SetThreadSlot(3)); SubmitTestDraw(queue, 0, 1, 1, 1, 1); }).join();
+  queue.MergeThreadCommands();
+  std::thread([&queue]() { CHECK(queue.SetThreadSlot(3)); SubmitTestDraw(queue, 0, 1, 1, 1, 2); }).join();
+
+  // Recording into another queue does not lose the slot
+  std::thread([&queue, &other]()
+    {
+      CHECK(queue.SetThreadSlot(4));
+      SubmitTestDraw(other, 0, 1, 1, 1, 100);
+      CHECK(queue.SetThreadSlot(4));
+      SubmitTestDraw(queue, 0, 1, 1, 1, 3);
+    }).join();
+
+  queue.MergeThreadCommands();
+  other.MergeThreadCommands();
+  queue.Swap();
+  queue.Execute();
+
+  int const expected[] = {0, 1, 2, 3};
+  CHECK(g_executed.size() == ARRAY_SIZE_32(expected));
+  for (size_t i = 0; i < g_executed.size() && i < ARRAY_SIZE_32(expected); i++)
+    CHECK(g_executed[i] == expected[i]);
+}
+
+namespace
+{
+  int g_handled = 0;
+  int g_deleted = 0;
+
+  // Pops itself and the system below it, and pushes a new one, from its handler.
+  class TestSystem_Popper : public Engine::System
+  {
+  public:
+    MAKE_SYSTEM_DECL
+
+    TestSystem_Popper(Engine::SystemStack * a_pStack) : m_pStack(a_pStack) {}
+    ~TestSystem_Popper() { g_deleted++; }
+
+    void OnAttach() override { Subscribe(Engine::Message_GUI_Up::GetStaticID()); }
+    void Update(float) override {}
+    void HandleMessage(Engine::Message *) override;
+
+  private:
+    Engine::SystemStack * m_pStack;
+  };
+
+  class TestSystem_Listener : public Engine::System
+  {
+  public:
+    MAKE_SYSTEM_DECL
+
+    ~TestSystem_Listener() { g_deleted++; }
+
+    void OnAttach() override { Subscribe(Engine::Message_GUI_Up::GetStaticID()); }
+    void Update(float) override {}
+    void HandleMessage(Engine::Message *) override { g_handled++; }
+  };
+
+  class TestSystem_Pushed : public Engine::System
+  {
+  public:
+    MAKE_SYSTEM_DECL
+
+    void OnAttach() override { Subscribe(Engine::Message_GUI_Up::GetStaticID()); }
+    void Update(float) override {}
+  };
+
+  MAKE_SYSTEM_DEFINITION(TestSystem_Popper)
+  MAKE_SYSTEM_DEFINITION(TestSystem_Listener)
+  MAKE_SYSTEM_DEFINITION(TestSystem_Pushed)
+
+  void TestSystem_Popper::HandleMessage(Engine::Message *)
+  {
+    g_handled++;
+    m_pStack->PopSystem(TestSystem_Listener::GetStaticID());
+    m_pStack->PopSystem(GetStaticID());
+    m_pStack->PushSystem(new TestSystem_Pushed(), TestSystem_Pushed::GetStaticID());
+  }
+}
+
+// Dispatches the way MessageBus::DispatchMessages() does, without touching the global bus.
+void TEST_SystemStackPopInHandler()
+{
+  Engine::SystemStack stack;
+  g_handled = 0;
+  g_deleted = 0;
+
+  stack.PushSystem(new TestSystem_Popper(&stack), TestSystem_Popper::GetStaticID());
+  stack.PushSystem(new TestSystem_Listener(), TestSystem_Listener::GetStaticID());
+
+  Engine::Message_GUI_Up msg;
+  stack.BeginDispatch();
+  for (Engine::System * pSystem : stack.GetSubscribers(msg.GetID()))
+  {
+    pSystem->HandleMessage(&msg);
+    CHECK(g_deleted == 0);
+  }
+  stack.EndDispatch();
+
+  // Both systems still saw the message, and were removed once it had been handled
+  CHECK(g_handled == 2);
+  CHECK(g_deleted == 2);
+  CHECK(stack.GetSystem(TestSystem_Popper::GetStaticID()) == nullptr);
+  CHECK(stack.GetSystem(TestSystem_Listener::GetStaticID()) == nullptr);
+  CHECK(stack.GetSystem(TestSystem_Pushed::GetStaticID()) != nullptr);
+  CHECK(stack.GetSubscribers(msg.GetID()).size() == 1);
+}
+
+void TEST_MemBufferChunked()
+{
+  size_t const pageSize = 256;
+  size_t const recordSize = 96;   // Two records to a page
+  int const recordCount = 9;
+
+  MemBufferChunked buf(pageSize, 16);
+
+  auto Append = [&buf, recordSize](int a_first, int a_count)
+  {
+    for (int i = 0; i < a_count; i++)
+    {
+      int * pRecord = static_cast<int *>(buf.Allocate(recordSize));
+      for (size_t j = 0; j < recordSize / sizeof(int); j++)
+        pRecord[j] = a_first + i;
+    }
+  };
+
+  // Records are read back in the order they were written, each one whole
+  auto Verify = [&buf, recordSize](int a_first, int a_count)
+  {
+    int next = a_first;
+    buf.ForEachPage([&next, recordSize](Engine::byte * a_pData, size_t a_bytesUsed)
+      {
+        CHECK(a_bytesUsed % recordSize == 0);
+        for (size_t offset = 0; offset < a_bytesUsed; offset += recordSize)
+        {
+          int const * pRecord = reinterpret_cast<int const *>(a_pData + offset);
+          for (size_t j = 0; j < recordSize / sizeof(int); j++)
+            CHECK(pRecord[j] == next);
+          next++;
+        }
+      });
+    CHECK(next == a_first + a_count);
+  };
+
+  Append(0, recordCount);
+  CHECK(buf.size() == recordCount * recordSize);
+  CHECK(buf.capacity() == 5 * pageSize);
+  Verify(0, recordCount);
+
+  // An allocation larger than a page gets a page of its own
+  buf.Allocate(pageSize * 2);
+  CHECK(buf.capacity() == 7 * pageSize);
+
+  // Pages are kept and reused after a clear
+  size_t capacity = buf.capacity();
+  buf.clear();
+  CHECK(buf.size() == 0);
+  CHECK(buf.peak() == recordCount * recordSize + pageSize * 2);
+
+  Append(100, 4);
+  CHECK(buf.capacity() == capacity);
+  Verify(100, 4);
+}
+
+void TEST_JobPool()
+{
+  // Every job runs once, including those of batches started from inside a job
+  std::atomic<uint32_t> counts[64] = {};
+  Engine::JobPool::Run(8, [&counts](uint32_t a_outer)
+    {
+      Engine::JobPool::Run(8, [&counts, a_outer](uint32_t a_inner)
+        {
+          counts[a_outer * 8 + a_inner]++;
+        });
+    });
+
+  for (size_t i = 0; i < ARRAY_SIZE_32(counts); i++)
+    CHECK(counts[i] == 1);
+}
+
+void TEST_UniformBlockLayout()
+{
+#ifdef ENABLE_MATERIAL_UNIFORM_BLOCKS
+  char const * src =
+    "#version 430\n"
+    "#extension GL_ARB_explicit_uniform_location : enable\n"
+    "uniform vec3 u_vec3;\n"
+    "uniform float u_float;\n"
+    "uniform mat3 u_mat3;\n"
+    "uniform float u_array[3];\n"
+    "uniform float u_single[1];\n"
+    "uniform vec2 u_vec2;\n"
+    "uniform sampler2D u_texture;\n"
+    "void main() {}\n";
+
+  Engine::ShaderData data({Engine::ShaderSourceElement(Engine::ShaderDomain::Vertex, Engine::StrType::Source, src)});
+
+  // A float packs into the end of a vec3. Matrix columns and array elements are 16 bytes,
+  // including arrays of one element.
+  CHECK(data.FindUniform("u_vec3")->GetBlockOffset() == 0);
+  CHECK(data.FindUniform("u_float")->GetBlockOffset() == 12);
+  CHECK(data.FindUniform("u_mat3")->GetBlockOffset() == 16);
+  CHECK(data.FindUniform("u_array")->GetBlockOffset() == 64);
+  CHECK(data.FindUniform("u_single")->GetBlockOffset() == 112);
+  CHECK(data.FindUniform("u_single")->IsArray());
+  CHECK(data.FindUniform("u_vec2")->GetBlockOffset() == 128);
+  CHECK(!data.FindUniform("u_texture")->IsInBlock());
+  CHECK(data.GetUniformBlockSize() == 144);
+
+  // The block must follow any #extension directives
+  std::string const & result = data.GetShaderSource().Get(Engine::ShaderDomain::Vertex);
+  CHECK(result.find("#version") == 0);
+  CHECK(result.find("#extension") < result.find(Engine::ShaderData::UniformBlockName()));
+#endif
+}
+
+namespace
+{
+  Engine::TextureData CreateTestTexture(uint32_t a_width, uint32_t a_height, uint8_t const * a_pRGBA)
+  {
+    Engine::TextureAttributes attrs;
+    attrs.SetPixelType(Engine::TexturePixelType::RGBA8);
+    attrs.SetWrap(Engine::TextureWrap::Clamp);
+
+    size_t size = size_t(a_width) * a_height * 4;
+    uint8_t * pPixels = new uint8_t[size];
+    memcpy(pPixels, a_pRGBA, size);
+    return Engine::TextureData(a_width, a_height, pPixels, attrs);
+  }
+}
+
+void TEST_TextureProcessing()
+{
+  uint8_t const colour[4] = {200, 100, 50, 255};
+  uint8_t flat[8 * 8 * 4];
+  for (size_t i = 0; i < sizeof(flat); i++)
+    flat[i] = colour[i % 4];
+  Engine::TextureData flatTexture = CreateTestTexture(8, 8, flat);
+
+  // A flat colour stays flat whatever the factor
+  for (uint32_t factor = 2; factor <= 4; factor++)
+  {
+    Engine::TextureData out;
+    CHECK(Engine::TextureProcessing::Upscale(flatTexture, Engine::ResizeMethod::BRz, factor, out, 2) == Dg::ErrorCode::None);
+    CHECK(out.width == 8 * factor && out.height == 8 * factor);
+    bool isFlat = out.pPixels != nullptr;
+    for (size_t i = 0; isFlat && i < size_t(out.width) * out.height * 4; i++)
+      isFlat = out.pPixels[i] == colour[i % 4];
+    CHECK(isFlat);
+  }
+
+  // hqx is not implemented
+  Engine::TextureData hqx;
+  CHECK(Engine::TextureProcessing::Upscale(flatTexture, Engine::ResizeMethod::HQx, 2, hqx) != Dg::ErrorCode::None);
+
+  // A box filtered 2x2 texture mips down to the average
+  uint8_t const quad[2 * 2 * 4] =
+  {
+    0,   40,  100, 255,    100, 80,  200, 255,
+    200, 120, 0,   255,    100, 160, 100, 255
+  };
+  std::vector<Engine::TextureData> mips;
+  CHECK(Engine::TextureProcessing::GenerateMipmaps(CreateTestTexture(2, 2, quad), Engine::MipmapKernel::Box, mips, 1) == Dg::ErrorCode::None);
+  CHECK(mips.size() == 1);
+  if (mips.size() == 1)
+  {
+    CHECK(mips[0].width == 1 && mips[0].height == 1);
+    uint8_t const average[4] = {100, 100, 100, 255};
+    for (int c = 0; c < 4; c++)
+      CHECK(mips[0].pPixels[c] == average[c]);
+  }
+
+  // The cached result, both when it is made and when it is read back, matches the original
+  uint8_t diagonal[8 * 8 * 4];
+  for (uint32_t i = 0; i < 8 * 8; i++)
+  {
+    uint8_t value = (i % 8) > (i / 8) ? 255 : 0;
+    diagonal[i * 4 + 0] = diagonal[i * 4 + 1] = diagonal[i * 4 + 2] = value;
+    diagonal[i * 4 + 3] = 255;
+  }
+  Engine::TextureData diagonalTexture = CreateTestTexture(8, 8, diagonal);
+
+  // Starts from an empty cache, away from the real one, so the first call always fills it
+  std::string cacheDir = (std::filesystem::temp_directory_path() / "bsr-test-texture-cache").string();
+  std::error_code ec;
+  std::filesystem::remove_all(cacheDir, ec);
+
+  Engine::TextureData scaled, cached0, cached1;
+  CHECK(Engine::TextureProcessing::Upscale(diagonalTexture, Engine::ResizeMethod::BRz, 3, scaled) == Dg::ErrorCode::None);
+  CHECK(Engine::TextureProcessing::UpscaleCached(diagonalTexture, Engine::ResizeMethod::BRz, 3, cached0, 0, cacheDir) == Dg::ErrorCode::None);
+  CHECK(!std::filesystem::is_empty(cacheDir, ec));
+  CHECK(Engine::TextureProcessing::UpscaleCached(diagonalTexture, Engine::ResizeMethod::BRz, 3, cached1, 0, cacheDir) == Dg::ErrorCode::None);
+  std::filesystem::remove_all(cacheDir, ec);
+
+  size_t size = size_t(scaled.width) * scaled.height * 4;
+  CHECK(cached0.width == scaled.width && cached0.height == scaled.height);
+  CHECK(cached1.width == scaled.width && cached1.height == scaled.height);
+  if (cached0.width == scaled.width && cached1.width == scaled.width && cached0.height == scaled.height && cached1.height == scaled.height)
+  {
+    CHECK(memcmp(cached0.pPixels, scaled.pPixels, size) == 0);
+    CHECK(memcmp(cached1.pPixels, scaled.pPixels, size) == 0);
+  }
+}
+
 void RunTests()
 {
   TEST_BufferLayout();
+  TEST_UniformBlockLayout();
   TEST_Serialize();
   TEST_UTF8();
+  TEST_RenderCommandSort();
+  TEST_RenderCommandThreadSlots();
+  TEST_SystemStackPopInHandler();
+  TEST_MemBufferChunked();
+  TEST_JobPool();
+  TEST_TextureProcessing();
 
   LOG_INFO("Finished running tests.");
 }
\ No newline at end of file
@@ -8,6 +8,12 @@
 #include "Message.h"
 #include "DgWorkerPool.h"
 
+// Benchmarks take a while, so are only run when this is defined
+//#define RUN_BENCHMARKS
+
+// Run the demo headless for this many frames and log a report, instead of opening a window
+//#define RUN_FRAME_BENCHMARK 1000
+
 uint32_t NextID();
 
 enum MyMessageClass
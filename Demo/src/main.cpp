@@ -24,6 +24,11 @@ public:
     void RunTests();
     RunTests();
 
+#ifdef RUN_BENCHMARKS
+    void RunBenchmarks();
+    RunBenchmarks();
+#endif
+
     PushSystem(new RenderDemo());
     PushSystem(new GUIDemo());
   }
@@ -38,5 +43,9 @@ public:
 Engine::Application* Engine::CreateApplication()
 {
   Application::Opts opts;
+#ifdef RUN_FRAME_BENCHMARK
+  opts.headless = true;
+  opts.frameLimit = RUN_FRAME_BENCHMARK;
+#endif
   return new Game(opts);
 }
@@ -1,6 +1,7 @@
 //@group Core
 
 #include <exception>
+#include <chrono>
 
 #include "MessageBus.h"
 #include "SystemStack.h"
@@ -19,6 +20,10 @@
 #include "ResourceManager.h"
 #include "GUI.h"
 #include "GUI_Internal.h"
+#include "Profiler.h"
+#include "Headless.h"
+#include "HotReload.h"
+#include "JobPool.h"
 
 #include "System_Console.h"
 #include "System_Input.h"
@@ -35,6 +40,8 @@ namespace Engine
     PIMPL()
       : pWindow(nullptr)
       , shouldQuit(false)
+      , headless(false)
+      , frameLimit(0)
     {
     
     }
@@ -42,6 +49,9 @@ namespace Engine
     bool        shouldQuit;
     IWindow *   pWindow;
     SystemStack  systemStack;
+    std::string profileFile;
+    bool        headless;
+    uint32_t    frameLimit;
   };
 
   //------------------------------------------------------------------------------------
@@ -49,6 +59,14 @@ namespace Engine
   //------------------------------------------------------------------------------------
   Application * Application::s_instance = nullptr;
 
+  // Accumulated over a run with a frame limit
+  struct BenchmarkTotals
+  {
+    uint64_t frames;
+    uint64_t commands;
+    size_t   peakCommandBytes;
+  };
+
   void Application::InitWindow()
   {
     m_pimpl->pWindow = Framework::Instance()->GetWindow();
@@ -82,13 +100,20 @@ namespace Engine
 
     ResourceManager::Init();
     MessageBus::Init();
+    Profiler::Init();
+    Profiler::Instance()->Enable(a_opts.enableProfiler);
+    m_pimpl->profileFile = a_opts.profileFile;
+    m_pimpl->headless = a_opts.headless;
+    m_pimpl->frameLimit = a_opts.frameLimit;
 
     if (a_opts.loggerType == E_UseFileLogger)
       impl::Logger::Init_file(a_opts.loggerName.c_str(), a_opts.logFile.c_str());
     else
       impl::Logger::Init_stdout(a_opts.loggerName.c_str());
 
-    if (Framework::Init() != Dg::ErrorCode::None)
+    JobPool::Init(JOB_POOL_THREAD_COUNT);
+
+    if (Framework::Init(a_opts.headless ? Framework::Backend::Headless : Framework::Backend::SDL_OpenGL) != Dg::ErrorCode::None)
       throw std::runtime_error("Failed to initialise framework!");
 
     InitWindow();
@@ -118,6 +143,19 @@ namespace Engine
 
   Application::~Application()
   {
+    TBUFStats tbufStats = TBUFGetStats();
+    if (tbufStats.frames != 0)
+      LOG_INFO("Temp buffer usage: high-water {} bytes, average {} bytes/frame, capacity {} bytes",
+        tbufStats.highWaterMark, tbufStats.totalBytes / tbufStats.frames, tbufStats.capacity);
+
+    if (Profiler::Instance()->IsEnabled())
+    {
+      Profiler::Instance()->Enable(false);
+      if (Profiler::Instance()->WriteChromeTrace(m_pimpl->profileFile) != Dg::ErrorCode::None)
+        LOG_ERROR("Failed to write profile to '{}'", m_pimpl->profileFile);
+    }
+
+    HotReload::Clear();
     GUI::ShutDown();
     RenderThread::ShutDown();
     Renderer::ShutDown();
@@ -125,16 +163,22 @@ namespace Engine
     if (Framework::ShutDown() != Dg::ErrorCode::None)
       LOG_ERROR("Failed to shut down framework!");
 
+    JobPool::ShutDown();
+
     s_instance = nullptr;
     MessageBus::ShutDown();
     ResourceManager::ShutDown();
+    Profiler::ShutDown();
 
     LOG_TRACE("Shutdown complete!");
   }
 
   void Application::EndFrame()
   {
-    RenderThread::Instance()->Sync();
+    PROFILE_SCOPE("EndFrame");
+
+    // Anything recorded on other threads is drawn before the window is swapped
+    Renderer::Instance()->MergeThreadCommands();
 
     RenderState state = RenderState::Create();
     state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
@@ -145,23 +189,38 @@ namespace Engine
         Framework::Instance()->GetWindow()->SwapBuffers();
       });
 
+    // Blocks only if the render thread has fallen too far behind
+    RenderThread::Instance()->SubmitFrame();
     Renderer::Instance()->SwapBuffers();
     Engine::TBUFClear();
-    RenderThread::Instance()->Continue();
   }
 
   void Application::Run()
   {
+    PROFILE_THREAD("Main");
+
     //Start to execute any renderer commands generated on startup
     EndFrame();
 
+    BenchmarkTotals totals = {};
+    auto startTime = std::chrono::steady_clock::now();
+    uint64_t startGLCalls = m_pimpl->headless ? GetHeadlessGLStats().calls : 0;
+
     while (!m_pimpl->shouldQuit)
     {
+      PROFILE_SCOPE("Frame");
       float dt = 1.0f / 60.0f;
 
+#ifdef ENABLE_HOT_RELOAD
+      HotReload::Update();
+#endif
+
       for (auto it = m_pimpl->systemStack.begin(); it != m_pimpl->systemStack.end(); it++)
       {
-        it->second->Update(dt);
+        {
+          PROFILE_SCOPE_TAGGED("SystemUpdate", it->first);
+          it->second->Update(dt);
+        }
         MessageBus::Instance()->DispatchMessages(m_pimpl->systemStack);
       }
 
@@ -171,10 +230,36 @@ namespace Engine
       while (it != m_pimpl->systemStack.begin())
       {
         it--;
+        PROFILE_SCOPE_TAGGED("SystemRender", it->first);
         it->second->Render();
       }
 
       EndFrame();
+
+      if (m_pimpl->frameLimit != 0)
+      {
+        RenderCommandQueue::FrameStats stats = Renderer::Instance()->GetCommandStats();
+        totals.frames++;
+        totals.commands += stats.commandCount;
+        if (stats.commandBytes + stats.dataBytes > totals.peakCommandBytes)
+          totals.peakCommandBytes = stats.commandBytes + stats.dataBytes;
+
+        if (totals.frames >= m_pimpl->frameLimit)
+          m_pimpl->shouldQuit = true;
+      }
+    }
+
+    if (m_pimpl->frameLimit != 0 && totals.frames != 0)
+    {
+      RenderThread::Instance()->Sync();
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+      TBUFStats tbufStats = TBUFGetStats();
+
+      LOG_INFO("Benchmark: {} frames in {:.3f} s, {:.1f} frames/s", totals.frames, seconds, double(totals.frames) / seconds);
+      LOG_INFO("Benchmark: {:.1f} render commands/frame, peak command memory {} bytes", double(totals.commands) / double(totals.frames), totals.peakCommandBytes);
+      LOG_INFO("Benchmark: temp buffer high-water {} bytes, average {} bytes/frame", tbufStats.highWaterMark, tbufStats.totalBytes / tbufStats.frames);
+      if (m_pimpl->headless)
+        LOG_INFO("Benchmark: {:.1f} GL calls/frame", double(GetHeadlessGLStats().calls - startGLCalls) / double(totals.frames));
     }
   }
 
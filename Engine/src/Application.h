@@ -30,6 +30,10 @@ namespace Engine
         : logFile("log_output.txt")
         , loggerName("BSR")
         , loggerType(E_UseStdOutLogger)
+        , profileFile("profile-trace.json")
+        , enableProfiler(false)
+        , headless(false)
+        , frameLimit(0)
       {
       
       }
@@ -37,6 +41,16 @@ namespace Engine
       std::string logFile;
       std::string loggerName;
       int         loggerType;
+
+      // The profile is written out as a Chrome trace on shut down
+      std::string profileFile;
+      bool        enableProfiler;
+
+      // Run without a window or GPU, see Headless.h
+      bool        headless;
+
+      // Quit after this many frames and log a benchmark report. 0 == run until quit.
+      uint32_t    frameLimit;
     };
 
     Application(Opts const &);
@@ -24,9 +24,32 @@
 #include "RenderThreadData.h"
 #include "ShaderUtils.h"
 #include "Serialize.h"
+#include "Options.h"
 
 namespace Engine 
 {
+  //------------------------------------------------------------------------------------------------
+  // Helper functions
+  //------------------------------------------------------------------------------------------------
+
+  // Returns the data the render thread should upload from. See BufferFlags.
+  static void * PrepareData(void const * a_pData, uint32_t a_size, uint32_t a_flags)
+  {
+    if ((a_flags & (BF_NoCopy | BF_TakeOwnership)) != 0)
+      return const_cast<void *>(a_pData);
+
+    void * pData = RENDER_ALLOCATE(a_size);
+    memcpy(pData, a_pData, a_size);
+    return pData;
+  }
+
+  // Render thread. Call once the data has been uploaded.
+  static void ReleaseData(void * a_pData, uint32_t a_flags)
+  {
+    if ((a_flags & BF_TakeOwnership) != 0)
+      free(a_pData);
+  }
+
   //------------------------------------------------------------------------------------------------
   // BufferElement
   //------------------------------------------------------------------------------------------------
@@ -177,8 +200,7 @@ namespace Engine
   {
     BSR_ASSERT(a_pData != nullptr);
 
-    uint8_t * data = (uint8_t*)RENDER_ALLOCATE(a_size);
-    memcpy(data, a_pData, a_size);
+    void * data = PrepareData(a_pData, a_size, a_flags);
 
     RenderState state = RenderState::Create();
     state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
@@ -187,6 +209,7 @@ namespace Engine
     RENDER_SUBMIT(state, [resID = m_id, size = a_size, flags = a_flags, usage = a_usage, data]()
       {
         ::Engine::RT_VertexBuffer * pVB = ::Engine::RT_VertexBuffer::Create(data, size, flags, usage);
+        ReleaseData(data, flags);
         if (pVB == nullptr)
         {
           LOG_WARN("VertexBuffer::VertexBuffer(): Failed to create vertex buffer!");
@@ -343,19 +366,125 @@ namespace Engine
     return Ref<VertexBuffer>(new VertexBuffer(a_size, a_flags, a_usage));
   }
 
+  //------------------------------------------------------------------------------------------------
+  // StreamingVertexBuffer
+  //------------------------------------------------------------------------------------------------
+
+  StreamingVertexBuffer::StreamingVertexBuffer(uint32_t a_regionSize)
+    : VertexBuffer(a_regionSize * STREAMING_BUFFER_REGION_COUNT, BF_Mapped, BufferUsage::Dynamic)
+    , m_pMapping(new Mapping())
+    , m_frameIndex(0)
+    , m_regionSize(a_regionSize)
+    , m_cursor(0)
+  {
+    m_pMapping->pMapped = nullptr;
+
+    RenderState state = RenderState::Create();
+    state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
+    state.Set<RenderState::Attr::Command>(RenderState::Command::BufferCreate);
+
+    RENDER_SUBMIT(state, [resID = m_id, pMapping = m_pMapping]()
+      {
+        ::Engine::RT_VertexBuffer ** ppVBO = ::Engine::RenderThreadData::Instance()->VBOs.at(resID);
+        if (ppVBO == nullptr)
+        {
+          LOG_WARN("StreamingVertexBuffer::StreamingVertexBuffer(): RefID '{}' does not exist!", resID);
+          return;
+        }
+        pMapping->pMapped.store((byte *)(*ppVBO)->GetMappedPointer(), std::memory_order_release);
+      });
+  }
+
+  StreamingVertexBuffer::~StreamingVertexBuffer()
+  {
+    RenderState state = RenderState::Create();
+    state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
+    state.Set<RenderState::Attr::Command>(RenderState::Command::BufferDelete);
+
+    // The render thread may still be about to publish the pointer
+    RENDER_SUBMIT(state, [pMapping = m_pMapping]()
+      {
+        delete pMapping;
+      });
+  }
+
+  Ref<StreamingVertexBuffer> StreamingVertexBuffer::Create(uint32_t a_regionSize)
+  {
+    return Ref<StreamingVertexBuffer>(new StreamingVertexBuffer(a_regionSize));
+  }
+
+  bool StreamingVertexBuffer::Reserve(uint32_t a_size, uint32_t a_stride, uint32_t & a_offset)
+  {
+    BSR_ASSERT(a_stride != 0);
+
+    uint64_t frameIndex = Renderer::Instance()->GetFrameIndex();
+    if (frameIndex != m_frameIndex)
+    {
+      m_frameIndex = frameIndex;
+      m_cursor = 0;
+    }
+
+    // Align relative to the start of the buffer, so the offset is a whole number of elements
+    uint32_t regionBegin = uint32_t(frameIndex % STREAMING_BUFFER_REGION_COUNT) * m_regionSize;
+    uint32_t offset = ((regionBegin + m_cursor + a_stride - 1) / a_stride) * a_stride;
+    if (offset + a_size > regionBegin + m_regionSize)
+      return false;
+
+    m_cursor = offset + a_size - regionBegin;
+    a_offset = offset;
+    return true;
+  }
+
+  void * StreamingVertexBuffer::Map(uint32_t a_size, uint32_t a_stride, uint32_t & a_index)
+  {
+    byte * pMapped = m_pMapping->pMapped.load(std::memory_order_acquire);
+    if (pMapped == nullptr)
+      return nullptr;
+
+    uint32_t offset = 0;
+    if (!Reserve(a_size, a_stride, offset))
+      return nullptr;
+
+    a_index = offset / a_stride;
+    return pMapped + offset;
+  }
+
+  bool StreamingVertexBuffer::Write(void const * a_pData, uint32_t a_size, uint32_t a_stride, uint32_t & a_index)
+  {
+    BSR_ASSERT(a_pData != nullptr);
+
+    uint32_t offset = 0;
+    if (!Reserve(a_size, a_stride, offset))
+      return false;
+
+    a_index = offset / a_stride;
+
+    byte * pMapped = m_pMapping->pMapped.load(std::memory_order_acquire);
+    if (pMapped != nullptr)
+      memcpy(pMapped + offset, a_pData, a_size);
+    else
+      SetData(a_pData, a_size, offset);
+    return true;
+  }
+
+  uint32_t StreamingVertexBuffer::GetRegionSize() const
+  {
+    return m_regionSize;
+  }
+
   //------------------------------------------------------------------------------------------------
   // UniformBuffer
   //------------------------------------------------------------------------------------------------
 
-  UniformBuffer::UniformBuffer(uint32_t a_size, BufferUsage a_usage)
+  UniformBuffer::UniformBuffer(uint32_t a_size, uint32_t a_flags, BufferUsage a_usage)
   {
     RenderState state = RenderState::Create();
     state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
     state.Set<RenderState::Attr::Command>(RenderState::Command::BufferCreate);
 
-    RENDER_SUBMIT(state, [resID = m_id, size = a_size, usage = a_usage]()
+    RENDER_SUBMIT(state, [resID = m_id, size = a_size, flags = a_flags, usage = a_usage]()
     {
-      RT_UniformBuffer * pUB = RT_UniformBuffer::Create(size, usage);
+      RT_UniformBuffer * pUB = RT_UniformBuffer::Create(size, flags, usage);
       if (pUB == nullptr)
       {
         LOG_WARN("UniformBuffer::UniformBuffer(): Failed to create uniform buffer!");
@@ -365,20 +494,20 @@ namespace Engine
     });
   }
 
-  UniformBuffer::UniformBuffer(void const * a_pData, uint32_t a_size, BufferUsage a_usage)
+  UniformBuffer::UniformBuffer(void const * a_pData, uint32_t a_size, uint32_t a_flags, BufferUsage a_usage)
   {
     BSR_ASSERT(a_pData != nullptr);
 
-    uint8_t * data = (uint8_t *)RENDER_ALLOCATE(a_size);
-    memcpy(data, a_pData, a_size);
+    void * data = PrepareData(a_pData, a_size, a_flags);
 
     RenderState state = RenderState::Create();
     state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
     state.Set<RenderState::Attr::Command>(RenderState::Command::BufferCreate);
 
-    RENDER_SUBMIT(state, [resID = m_id, size = a_size, usage = a_usage, data]()
+    RENDER_SUBMIT(state, [resID = m_id, size = a_size, flags = a_flags, usage = a_usage, data]()
       {
-        ::Engine::RT_UniformBuffer * pUB = ::Engine::RT_UniformBuffer::Create(data, size, usage);
+        ::Engine::RT_UniformBuffer * pUB = ::Engine::RT_UniformBuffer::Create(data, size, flags, usage);
+        ReleaseData(data, flags);
         if (pUB == nullptr)
         {
           LOG_WARN("UniformBuffer::UniformBuffer(): Failed to create uniform buffer!");
@@ -432,17 +561,19 @@ namespace Engine
 
   Ref<UniformBuffer> UniformBuffer::Create(void const * a_pData,
                                            uint32_t a_size,
+                                           uint32_t a_flags,
                                            BufferUsage a_usage)
   {
     BSR_ASSERT(a_pData != nullptr);
 
-    return Ref<UniformBuffer>(new UniformBuffer(a_pData, a_size, a_usage));
+    return Ref<UniformBuffer>(new UniformBuffer(a_pData, a_size, a_flags, a_usage));
   }
 
   Ref<UniformBuffer> UniformBuffer::Create(uint32_t a_size,
+                                           uint32_t a_flags,
                                            BufferUsage a_usage)
   {
-    return Ref<UniformBuffer>(new UniformBuffer(a_size, a_usage));
+    return Ref<UniformBuffer>(new UniformBuffer(a_size, a_flags, a_usage));
   }
 
   void UniformBuffer::Bind(Ref<BindingPoint> const& a_bp)
@@ -645,22 +776,22 @@ namespace Engine
   // IndexBuffer
   //------------------------------------------------------------------------------------------------
 
-  IndexBuffer::IndexBuffer(void const * a_pData, IndexDataType a_dataType, uint32_t a_count)
+  IndexBuffer::IndexBuffer(void const * a_pData, IndexDataType a_dataType, uint32_t a_count, uint32_t a_flags)
     : m_dataType(a_dataType)
     , m_elementCount(a_count)
   {
     BSR_ASSERT(a_pData != nullptr);
     uint32_t dataSize = GetIndexDataTypeSize(m_dataType) * a_count;
-    uint8_t* pData = (uint8_t*)RENDER_ALLOCATE(dataSize);
-    memcpy(pData, a_pData, dataSize);
+    void * pData = PrepareData(a_pData, dataSize, a_flags);
 
     RenderState state = RenderState::Create();
     state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
     state.Set<RenderState::Attr::Command>(RenderState::Command::BufferCreate);
 
-    RENDER_SUBMIT(state, [resID = m_id, pData, dataSize]()
+    RENDER_SUBMIT(state, [resID = m_id, pData, dataSize, flags = a_flags]()
       {
         RT_IndexBuffer * pIB = RT_IndexBuffer::Create(pData, dataSize);
+        ReleaseData(pData, flags);
         if (pIB == nullptr)
         {
           LOG_WARN("RT_IndexBuffer::RT_IndexBuffer(): Failed to create index buffer!");
@@ -670,22 +801,22 @@ namespace Engine
       });
   }
 
-  Ref<IndexBuffer> IndexBuffer::Create(uint8_t const * a_pData, uint32_t a_count)
+  Ref<IndexBuffer> IndexBuffer::Create(uint8_t const * a_pData, uint32_t a_count, uint32_t a_flags)
   {
     BSR_ASSERT(a_pData != nullptr);
-    return Ref<IndexBuffer>(new IndexBuffer(a_pData, IndexDataType::unsigned_8, a_count));
+    return Ref<IndexBuffer>(new IndexBuffer(a_pData, IndexDataType::unsigned_8, a_count, a_flags));
   }
 
-  Ref<IndexBuffer> IndexBuffer::Create(uint16_t const * a_pData, uint32_t a_count)
+  Ref<IndexBuffer> IndexBuffer::Create(uint16_t const * a_pData, uint32_t a_count, uint32_t a_flags)
   {
     BSR_ASSERT(a_pData != nullptr);
-    return Ref<IndexBuffer>(new IndexBuffer(a_pData, IndexDataType::unsigned_16, a_count));
+    return Ref<IndexBuffer>(new IndexBuffer(a_pData, IndexDataType::unsigned_16, a_count, a_flags));
   }
 
-  Ref<IndexBuffer> IndexBuffer::Create(uint32_t const * a_pData, uint32_t a_count)
+  Ref<IndexBuffer> IndexBuffer::Create(uint32_t const * a_pData, uint32_t a_count, uint32_t a_flags)
   {
     BSR_ASSERT(a_pData != nullptr);
-    return Ref<IndexBuffer>(new IndexBuffer(a_pData, IndexDataType::unsigned_32, a_count));
+    return Ref<IndexBuffer>(new IndexBuffer(a_pData, IndexDataType::unsigned_32, a_count, a_flags));
   }
 
   IndexBuffer::~IndexBuffer()
@@ -22,6 +22,7 @@
 #include <stdint.h>
 #include <string>
 #include <vector>
+#include <atomic>
 
 #include "Memory.h"
 #include "BSR_Assert.h"
@@ -44,7 +45,13 @@ namespace Engine
   enum BufferFlags
   {
     BF_None = 0,
-    BF_Mapped = 1
+    BF_Mapped = 1,        // Persistently mapped for the lifetime of the buffer
+
+    // How the data passed to Create() is handled. By default it is copied into render
+    // command memory, and uploaded once the render thread gets to it.
+    BF_NoCopy = 2,        // Use the data in place. It must stay valid until the render thread has
+                          // created the buffer, eg static data or memory from RENDER_ALLOCATE.
+    BF_TakeOwnership = 4  // Use the data in place and free() it once uploaded. Must come from malloc().
   };
 
 
@@ -98,11 +105,9 @@ namespace Engine
   // VertexBuffer
   //------------------------------------------------------------------------------------------------
 
-  // TODO Add option to Create buffers using memory allocated from the render heap.
-  //      This way we eliminate the need to do any copying.
   class VertexBuffer : public RenderResource
   {
-  private:
+  protected:
     VertexBuffer(void const * data, uint32_t size, uint32_t a_flags, BufferUsage a_usage = BufferUsage::Static);
     VertexBuffer(uint32_t size, uint32_t a_flags, BufferUsage a_usage = BufferUsage::Static);
 
@@ -133,24 +138,72 @@ namespace Engine
     void SetLayout(BufferLayout const &);
   };
 
+  //------------------------------------------------------------------------------------------------
+  // StreamingVertexBuffer
+  //------------------------------------------------------------------------------------------------
+
+  // A persistently mapped vertex buffer for geometry which changes every frame. The buffer
+  // is split into STREAMING_BUFFER_REGION_COUNT regions, one per frame in use. The main thread
+  // writes straight into the current frame's region, then draws with the returned index as 
+  // the base vertex or base instance. Regions are not reused until the GPU has finished
+  // the frame which last read from them.
+  // Only use from the main thread.
+  class StreamingVertexBuffer : public VertexBuffer
+  {
+    StreamingVertexBuffer(uint32_t regionSize);
+
+  public:
+
+    static Ref<StreamingVertexBuffer> Create(uint32_t regionSize);
+
+    ~StreamingVertexBuffer();
+
+    // Reserve 'size' bytes from this frame's region, aligned to 'stride'. 'index' is set to 
+    // the offset in units of stride. Returns nullptr if the region is full, or if the render
+    // thread has not mapped the buffer yet, usually only in the frame it was created.
+    void * Map(uint32_t size, uint32_t stride, uint32_t & index);
+
+    // As Map(), but copies 'data' in. Until the buffer is mapped, the data is sent
+    // through the command queue instead. Returns false if the region is full.
+    bool Write(void const * data, uint32_t size, uint32_t stride, uint32_t & index);
+
+    uint32_t GetRegionSize() const;
+
+  private:
+
+    // Returns false if the region is full
+    bool Reserve(uint32_t size, uint32_t stride, uint32_t & offset);
+
+    // Shared with the render thread, which sets the pointer once the buffer exists.
+    // Deleted on the render thread.
+    struct Mapping
+    {
+      std::atomic<byte *> pMapped;
+    };
+
+    Mapping * m_pMapping;
+    uint64_t m_frameIndex;
+    uint32_t m_regionSize;
+    uint32_t m_cursor;
+  };
+
   //------------------------------------------------------------------------------------------------
   // UniformBuffer
   //------------------------------------------------------------------------------------------------
 
-  // TODO update constructors with flags
   class UniformBuffer : public RenderResource
   {
   private:
-    UniformBuffer(uint32_t size, BufferUsage);
-    UniformBuffer(void const * a_pData, uint32_t size, BufferUsage);
+    UniformBuffer(uint32_t size, uint32_t flags, BufferUsage);
+    UniformBuffer(void const * a_pData, uint32_t size, uint32_t flags, BufferUsage);
 
     UniformBuffer(UniformBuffer const&) = delete;
     UniformBuffer& operator=(UniformBuffer const&) = delete;
 
   public:
 
-    static Ref<UniformBuffer> Create(void const * a_pData, uint32_t size, BufferUsage = BufferUsage::Static);
-    static Ref<UniformBuffer> Create(uint32_t size, BufferUsage = BufferUsage::Static);
+    static Ref<UniformBuffer> Create(void const * a_pData, uint32_t size, uint32_t flags, BufferUsage = BufferUsage::Static);
+    static Ref<UniformBuffer> Create(uint32_t size, uint32_t flags, BufferUsage = BufferUsage::Static);
 
     ~UniformBuffer();
 
@@ -195,22 +248,18 @@ namespace Engine
   // IndexBuffer
   //------------------------------------------------------------------------------------------------
 
-  // TODO update constructors with flags
   class IndexBuffer : public RenderResource
   {
-    IndexBuffer(void const * a_pData, IndexDataType a_dataType, uint32_t a_count);
+    IndexBuffer(void const * a_pData, IndexDataType a_dataType, uint32_t a_count, uint32_t a_flags);
 
     IndexBuffer(IndexBuffer const&) = delete;
     IndexBuffer& operator=(IndexBuffer const&) = delete;
   public:
 
-    // TODO add flag to take ownership of the memory
-    //      persistant: can just pass pointer to RT_Buffer, but do not free
-    //      makeCopy: must copy data
-    //      dealloc: can take ownership and must free once done
-    static Ref<IndexBuffer> Create(uint8_t const * a_pData, uint32_t a_count);
-    static Ref<IndexBuffer> Create(uint16_t const * a_pData, uint32_t a_count);
-    static Ref<IndexBuffer> Create(uint32_t const * a_pData, uint32_t a_count);
+    // See BufferFlags for how the data is handled. Only BF_NoCopy and BF_TakeOwnership apply.
+    static Ref<IndexBuffer> Create(uint8_t const * a_pData, uint32_t a_count, uint32_t a_flags = BF_None);
+    static Ref<IndexBuffer> Create(uint16_t const * a_pData, uint32_t a_count, uint32_t a_flags = BF_None);
+    static Ref<IndexBuffer> Create(uint32_t const * a_pData, uint32_t a_count, uint32_t a_flags = BF_None);
 
      ~IndexBuffer();
 
@@ -57,7 +57,7 @@ namespace Engine
     return s_instance;
   }
 
-  Dg::ErrorCode Framework::Init()
+  Dg::ErrorCode Framework::Init(Backend a_backend)
   {
     BSR_ASSERT(s_instance == nullptr, "Framework already initialized!");
     s_instance = new Framework();
@@ -68,12 +68,24 @@ namespace Engine
       //Init APIs...
       //-----------------------------------------------------------------------------------------
 
-      //Init SDL...
-      if (SDL_Init(SDL_INIT_EVERYTHING) != 0) 
+      if (a_backend == Backend::Headless)
       {
-        LOG_ERROR("Unable to initialize SDL: {}", SDL_GetError());
-        result = Dg::ErrorCode::Failure;
-        break;
+        result = s_instance->InitHeadless();
+        if (result != Dg::ErrorCode::None)
+        {
+          LOG_ERROR("Failed to Initialise headless backend");
+          break;
+        }
+      }
+      else
+      {
+        //Init SDL...
+        if (SDL_Init(SDL_INIT_EVERYTHING) != 0) 
+        {
+          LOG_ERROR("Unable to initialize SDL: {}", SDL_GetError());
+          result = Dg::ErrorCode::Failure;
+          break;
+        }
       }
 
       //-----------------------------------------------------------------------------------------
@@ -81,7 +93,7 @@ namespace Engine
       //-----------------------------------------------------------------------------------------
 
 #undef ITEM
-#define ITEM(m) result = s_instance->Init##m(); if (result != Dg::ErrorCode::None) { LOG_ERROR("Failed to Initialise module: " #m); break; }
+#define ITEM(m) if (s_instance->Get##m() == nullptr) { result = s_instance->Init##m(); if (result != Dg::ErrorCode::None) { LOG_ERROR("Failed to Initialise module: " #m); break; } }
       UNROLL_FRAMEWORK_CLASSES
 
     } while (false);
@@ -13,6 +13,7 @@
 #include "IGraphicsContext.h"
 #include "IFontAtlas.h"
 #include "IFileSystem.h"
+#include "IFileWatcher.h"
 #include "Buffer.h"
 
 #define UNROLL_FRAMEWORK_CLASSES \
@@ -20,7 +21,8 @@
  ITEM(EventPoller)\
  ITEM(MouseController)\
  ITEM(GraphicsContext)\
- ITEM(FileSystem)
+ ITEM(FileSystem)\
+ ITEM(FileWatcher)
 
 namespace Engine
 {
@@ -28,11 +30,17 @@ namespace Engine
   {
   public:
 
+    enum class Backend
+    {
+      SDL_OpenGL,
+      Headless    // No window, input or GPU. See Headless.h
+    };
+
     Framework();
     ~Framework();
 
     static Framework * Instance();
-    static Dg::ErrorCode Init();
+    static Dg::ErrorCode Init(Backend = Backend::SDL_OpenGL);
     static Dg::ErrorCode ShutDown();
 
     Ref<IFontAtlas> CreateFontAtlas();
@@ -41,6 +49,11 @@ namespace Engine
 #define ITEM(x) public: I ## x * Get ## x(); void Set ## x(I ## x *); private: Dg::ErrorCode Init ## x();
     UNROLL_FRAMEWORK_CLASSES
 
+  private:
+
+    // Sets the modules the headless backend replaces. The rest are initialised as normal.
+    Dg::ErrorCode InitHeadless();
+
   private:
 
     static Framework * s_instance;
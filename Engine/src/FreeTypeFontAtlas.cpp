@@ -1,8 +1,14 @@
 //@group Framework
 
+#include <cstring>
 #include <vector>
 #include <set>
+#include <list>
 #include <algorithm>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "IFontAtlas.h"
 #include "DgMap_AVL.h"
@@ -10,6 +16,7 @@
 #include "Framework.h"
 #include "BSR_Assert.h"
 #include "Options.h"
+#include "JobPool.h"
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -73,11 +80,395 @@ namespace Engine
     std::set<LoadGlyph> glyphs;
   };
 
+  // 'spread' is the margin a distance field adds around the glyph, 0 for a plain bitmap
+  static void SetGlyphMetrics(FT_GlyphSlot a_slot, uint32_t a_spread, GlyphData & a_data)
+  {
+    if (a_slot->bitmap.width == 0 || a_slot->bitmap.rows == 0)
+      a_spread = 0;
+
+    a_data.textureID = INVALID_FONT_TEXTURE;
+    a_data.advance = (int16_t)(a_slot->advance.x >> 6);
+    a_data.width = uint16_t(a_slot->bitmap.width + 2 * a_spread);
+    a_data.height = uint16_t(a_slot->bitmap.rows + 2 * a_spread);
+    a_data.texWidth = a_data.width;
+    a_data.texHeight = a_data.height;
+    a_data.bearingX = int16_t(a_slot->bitmap_left - int32_t(a_spread));
+    a_data.bearingY = int16_t(a_slot->bitmap_top + int32_t(a_spread));
+  }
+
+  // Squared euclidean distance transform of a sampled function, after Felzenszwalb and 
+  // Huttenlocher. 'v', 'z' and 'd' are scratch space, of count, count + 1 and count elements.
+  static void DistanceTransform(float * a_pF, uint32_t a_count, uint32_t a_stride, int32_t * a_pV, float * a_pZ, float * a_pD)
+  {
+    float const INF = 1e20f;
+    int32_t k = 0;
+    a_pV[0] = 0;
+    a_pZ[0] = -INF;
+    a_pZ[1] = INF;
+
+    for (int32_t q = 1; q < int32_t(a_count); q++)
+    {
+      float fq = a_pF[q * a_stride] + float(q * q);
+      float s = (fq - (a_pF[a_pV[k] * a_stride] + float(a_pV[k] * a_pV[k]))) / float(2 * (q - a_pV[k]));
+      while (s <= a_pZ[k])
+      {
+        k--;
+        s = (fq - (a_pF[a_pV[k] * a_stride] + float(a_pV[k] * a_pV[k]))) / float(2 * (q - a_pV[k]));
+      }
+      k++;
+      a_pV[k] = q;
+      a_pZ[k] = s;
+      a_pZ[k + 1] = INF;
+    }
+
+    k = 0;
+    for (int32_t q = 0; q < int32_t(a_count); q++)
+    {
+      while (a_pZ[k + 1] < float(q))
+        k++;
+      float dq = float(q - a_pV[k]);
+      a_pD[q] = dq * dq + a_pF[a_pV[k] * a_stride];
+    }
+
+    for (uint32_t q = 0; q < a_count; q++)
+      a_pF[q * a_stride] = a_pD[q];
+  }
+
+  static void DistanceTransform(std::vector<float> & a_grid, uint32_t a_width, uint32_t a_height)
+  {
+    uint32_t count = std::max(a_width, a_height);
+    std::vector<int32_t> v(count);
+    std::vector<float> z(count + 1);
+    std::vector<float> d(count);
+
+    for (uint32_t x = 0; x < a_width; x++)
+      DistanceTransform(&a_grid[x], a_height, a_width, v.data(), z.data(), d.data());
+    for (uint32_t y = 0; y < a_height; y++)
+      DistanceTransform(&a_grid[y * a_width], a_width, 1, v.data(), z.data(), d.data());
+  }
+
+  // Writes the signed distance field of a glyph bitmap to 'pOut', which has a 'spread' margin
+  // around the bitmap and rows of 'outPitch' bytes. Distances of 'spread' pixels and more map
+  // to 0 outside the glyph and 255 inside.
+  static void RenderDistanceField(FT_Bitmap const & a_bitmap, uint32_t a_spread, uint8_t * a_pOut, uint32_t a_outPitch)
+  {
+    float const INF = 1e20f;
+    uint32_t w = a_bitmap.width + 2 * a_spread;
+    uint32_t h = a_bitmap.rows + 2 * a_spread;
+    std::vector<float> toInside(size_t(w) * h);
+    std::vector<float> toOutside(size_t(w) * h);
+
+    for (uint32_t y = 0; y < h; y++)
+    {
+      for (uint32_t x = 0; x < w; x++)
+      {
+        bool inside = false;
+        if (x >= a_spread && x < a_spread + a_bitmap.width && y >= a_spread && y < a_spread + a_bitmap.rows)
+          inside = a_bitmap.buffer[(y - a_spread) * a_bitmap.pitch + (x - a_spread)] >= 128;
+
+        toInside[y * w + x] = inside ? 0.0f : INF;
+        toOutside[y * w + x] = inside ? INF : 0.0f;
+      }
+    }
+
+    DistanceTransform(toInside, w, h);
+    DistanceTransform(toOutside, w, h);
+
+    for (uint32_t y = 0; y < h; y++)
+    {
+      for (uint32_t x = 0; x < w; x++)
+      {
+        float dist = sqrtf(toOutside[y * w + x]) - sqrtf(toInside[y * w + x]);
+        float val = 0.5f + dist / float(2 * a_spread);
+        val = std::min(std::max(val, 0.0f), 1.0f);
+        a_pOut[y * a_outPitch + x] = uint8_t(val * 255.0f + 0.5f);
+      }
+    }
+  }
+
+  static Ref<Texture2D> CreateAtlasTexture(uint32_t a_dimension, uint8_t * a_pPixels)
+  {
+    Ref<Texture2D> texture = Texture2D::Create();
+    TextureAttributes attrs;
+    attrs.SetFilter(TextureFilter::Linear);
+    attrs.SetIsMipmapped(false);
+    attrs.SetWrap(TextureWrap::None);
+    attrs.SetPixelType(TexturePixelType::R8);
+
+    texture->Set(a_dimension, a_dimension, a_pPixels, attrs);
+    texture->Upload(true);
+    return texture;
+  }
+
+  //------------------------------------------------------------------------------------------------
+  // Rasterising
+  //------------------------------------------------------------------------------------------------
+
+  struct RasterisedGlyph
+  {
+    GlyphID id;
+    GlyphData data;
+
+    // (texWidth + FONTATLAS_GLYPH_PADDING) * (texHeight + FONTATLAS_GLYPH_PADDING) pixels, with 
+    // the glyph in the top left and the padding cleared. nullptr if the glyph has no pixels.
+    uint8_t * pPixels;
+    bool failed;
+  };
+
+  // FreeType libraries cannot be shared between threads, so each thread which rasterises 
+  // glyphs has its own library and faces.
+  class FaceCache
+  {
+  public:
+
+    FaceCache();
+    ~FaceCache();
+
+    // Opens the font the first time it is asked for
+    Dg::ErrorCode Get(FontID, std::string const & path, FT_Face & out);
+
+  private:
+
+    FT_Library m_pContext;
+    std::vector<FT_Face> m_faces;
+  };
+
+  FaceCache::FaceCache()
+    : m_pContext(nullptr)
+  {
+    if (FT_Init_FreeType(&m_pContext) != 0)
+      m_pContext = nullptr;
+  }
+
+  FaceCache::~FaceCache()
+  {
+    for (size_t i = 0; i < m_faces.size(); i++)
+    {
+      if (m_faces[i] != nullptr)
+        FT_Done_Face(m_faces[i]);
+    }
+    FT_Done_FreeType(m_pContext);
+  }
+
+  Dg::ErrorCode FaceCache::Get(FontID a_fontID, std::string const & a_path, FT_Face & a_out)
+  {
+    Dg::ErrorCode result;
+    FT_Error err;
+
+    DG_ERROR_NULL(m_pContext, Dg::ErrorCode::FailedToInitialise);
+
+    if (a_fontID >= m_faces.size())
+      m_faces.resize(a_fontID + 1, nullptr);
+
+    if (m_faces[a_fontID] == nullptr)
+    {
+      err = FT_New_Face(m_pContext, a_path.c_str(), 0, &m_faces[a_fontID]);
+      if (err != 0)
+        m_faces[a_fontID] = nullptr;
+      DG_ERROR_IF(err == FT_Err_Unknown_File_Format, Dg::ErrorCode::IncorrectFileType);
+      DG_ERROR_IF(err != 0, Dg::ErrorCode::FailedToOpenFile);
+      FT_Select_Charmap(m_faces[a_fontID], FT_ENCODING_UNICODE);
+    }
+
+    a_out = m_faces[a_fontID];
+    result = Dg::ErrorCode::None;
+  epilogue:
+    return result;
+  }
+
+  // 'spread' is the distance field spread, or 0 to rasterise a plain bitmap
+  static void RasteriseGlyph(FT_Face a_face, GlyphID a_id, uint32_t a_spread, RasterisedGlyph & a_out)
+  {
+    FontID fontID;
+    uint32_t size;
+    CodePoint cp;
+    UnpackGlyphID(a_id, fontID, cp, size);
+
+    a_out.id = a_id;
+    a_out.data = {};
+    a_out.pPixels = nullptr;
+    a_out.failed = true;
+
+    if (a_face == nullptr)
+      return;
+
+    FT_Set_Pixel_Sizes(a_face, 0, size);
+    if (FT_Load_Char(a_face, cp, FT_LOAD_RENDER) != 0)
+      return;
+
+    SetGlyphMetrics(a_face->glyph, a_spread, a_out.data);
+    a_out.failed = false;
+
+    if (a_out.data.texWidth == 0 || a_out.data.texHeight == 0)
+      return;
+
+    FT_Bitmap const & bitmap = a_face->glyph->bitmap;
+    uint32_t w = a_out.data.texWidth + FONTATLAS_GLYPH_PADDING;
+    uint32_t h = a_out.data.texHeight + FONTATLAS_GLYPH_PADDING;
+    a_out.pPixels = new uint8_t[w * h]{};
+
+    if (a_spread != 0)
+    {
+      RenderDistanceField(bitmap, a_spread, a_out.pPixels, w);
+    }
+    else
+    {
+      for (uint32_t y = 0; y < bitmap.rows; y++)
+        memcpy(&a_out.pPixels[y * w], &bitmap.buffer[y * bitmap.pitch], bitmap.width);
+    }
+  }
+
+  // Rasterises glyphs [begin, end) into pOut
+  static Dg::ErrorCode RasteriseSlice(std::vector<GlyphID> const & a_ids, size_t a_begin, size_t a_end, uint32_t a_spread, RasterisedGlyph * a_pOut)
+  {
+    FaceCache faces;
+    for (size_t i = a_begin; i < a_end; i++)
+    {
+      FontID fontID;
+      uint32_t size;
+      CodePoint cp;
+      UnpackGlyphID(a_ids[i], fontID, cp, size);
+
+      FT_Face face = nullptr;
+      Dg::ErrorCode result = faces.Get(fontID, s_Fonts[fontID].path, face);
+      if (result != Dg::ErrorCode::None)
+        return result;
+
+      RasteriseGlyph(face, a_ids[i], a_spread, a_pOut[i]);
+    }
+    return Dg::ErrorCode::None;
+  }
+
   struct TempData
   {
+    ~TempData()
+    {
+      for (size_t i = 0; i < glyphs.size(); i++)
+        delete[] glyphs[i].pPixels;
+    }
+
     std::vector<LoadFont> loadFonts;
+    std::vector<RasterisedGlyph> glyphs;  // Sorted by ID
   };
 
+  //------------------------------------------------------------------------------------------------
+  // GlyphRasteriser
+  //------------------------------------------------------------------------------------------------
+
+  // Rasterises glyphs for the dynamic atlas on its own thread
+  class GlyphRasteriser
+  {
+  public:
+
+    GlyphRasteriser();
+    ~GlyphRasteriser();
+
+    // 'spread' is the distance field spread, or 0 to rasterise a plain bitmap
+    void Request(GlyphID, std::string const & fontPath, uint32_t spread);
+
+    // Moves finished glyphs into 'out'. The caller owns the pixels.
+    void TakeResults(std::vector<RasterisedGlyph> & out);
+
+  private:
+
+    struct GlyphRequest
+    {
+      GlyphID id;
+      std::string fontPath;
+      uint32_t spread;
+    };
+
+    void Run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_shouldStop;
+    std::vector<GlyphRequest> m_requests;
+    std::vector<RasterisedGlyph> m_results;
+    std::thread m_thread;
+  };
+
+  GlyphRasteriser::GlyphRasteriser()
+    : m_shouldStop(false)
+  {
+    m_thread = std::thread([this]() { Run(); });
+  }
+
+  GlyphRasteriser::~GlyphRasteriser()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_shouldStop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+
+    for (size_t i = 0; i < m_results.size(); i++)
+      delete[] m_results[i].pPixels;
+  }
+
+  void GlyphRasteriser::Request(GlyphID a_id, std::string const & a_fontPath, uint32_t a_spread)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_requests.push_back({a_id, a_fontPath, a_spread});
+    }
+    m_cv.notify_one();
+  }
+
+  void GlyphRasteriser::TakeResults(std::vector<RasterisedGlyph> & a_out)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    a_out.insert(a_out.end(), m_results.begin(), m_results.end());
+    m_results.clear();
+  }
+
+  void GlyphRasteriser::Run()
+  {
+    FaceCache faces;
+    std::vector<GlyphRequest> requests;
+    std::vector<RasterisedGlyph> results;
+
+    while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_shouldStop || !m_requests.empty(); });
+        if (m_shouldStop)
+          break;
+        requests.swap(m_requests);
+      }
+
+      for (size_t i = 0; i < requests.size(); i++)
+      {
+        FontID fontID;
+        uint32_t size;
+        CodePoint cp;
+        UnpackGlyphID(requests[i].id, fontID, cp, size);
+
+        FT_Face face = nullptr;
+        Dg::ErrorCode err = faces.Get(fontID, requests[i].fontPath, face);
+        if (err != Dg::ErrorCode::None)
+          LOG_WARN("GlyphRasteriser: Failed to open font '{}'. Error: {}", requests[i].fontPath, Dg::ErrorCodeToString(err));
+
+        RasterisedGlyph glyph;
+        RasteriseGlyph(face, requests[i].id, requests[i].spread, glyph);
+        results.push_back(glyph);
+      }
+      requests.clear();
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_results.insert(m_results.end(), results.begin(), results.end());
+      }
+      results.clear();
+    }
+  }
+
+  //------------------------------------------------------------------------------------------------
+  // FreeTypeFontAtlas
+  //------------------------------------------------------------------------------------------------
+
   class FreeTypeFontAtlas : public IFontAtlas
   {
   public:
@@ -89,8 +480,15 @@ namespace Engine
     Dg::ErrorCode Init();
 
     void SetTextureDimension(uint32_t) override;
+    void SetLoadThreadCount(uint32_t) override;
     Dg::ErrorCode GetTexture(uint16_t, Ref<Texture2D> & out) override;
 
+    void EnableDynamicLoading(size_t memoryBudget) override;
+    void EnableDistanceField(uint32_t referenceSize) override;
+    bool IsDistanceField() const override;
+    void Update() override;
+    uint32_t GetVersion() const override;
+
     void BeginLoad() override;
     Dg::ErrorCode RegisterGlyph(FontID, uint32_t size, CodePoint c) override;
     Dg::ErrorCode RegisterAllGlyphs(FontID, uint32_t size) override;
@@ -99,14 +497,91 @@ namespace Engine
 
   private:
 
+    Dg::ErrorCode RasteriseGlyphs();
     Dg::ErrorCode GenerateCharMap();
     Dg::ErrorCode GenerateTextures();
+    uint32_t GetLoadThreadCount(size_t glyphCount) const;
+
+    // Distance fields are stored at the reference size, which is what glyphs are loaded at
+    uint32_t GetLoadSize(uint32_t size) const;
+    uint32_t GetSpread() const;
+    GlyphData * GetScaledGlyphData(GlyphData *, GlyphID, uint32_t size);
+
+    // Dynamic loading...
+
+    // Free horizontal space in a shelf
+    struct Span
+    {
+      uint16_t x;
+      uint16_t width;
+    };
+
+    // Pages are divided into rows, each of which holds glyphs up to its height
+    struct Shelf
+    {
+      uint16_t y;
+      uint16_t height;
+      std::vector<Span> free;
+    };
+
+    struct Page
+    {
+      std::vector<Shelf> shelves;
+      uint32_t shelfEnd;
+    };
+
+    enum class GlyphState
+    {
+      Loading,
+      Ready,
+      Missing   // Not in the font
+    };
+
+    struct CachedGlyph
+    {
+      GlyphData data;
+      GlyphState state;
+      uint16_t shelf;
+      uint64_t lastUsed;
+      std::list<GlyphID>::iterator lru;
+    };
+
+    // Call whenever glyphs are added or removed
+    void Changed();
+
+    Dg::ErrorCode CommitDynamic();
+    Dg::ErrorCode LoadSizeRange(FontID, uint32_t size);
+    GlyphData * GetDynamicGlyphData(GlyphID);
+    void ClearCache();
+    void AddPage();
+    bool Allocate(uint32_t width, uint32_t height, uint16_t & page, uint16_t & shelf, uint16_t & x, uint16_t & y);
+    bool AllocateInShelf(Shelf &, uint32_t width, uint16_t & x);
+    void Free(uint16_t page, uint16_t shelf, uint16_t x, uint16_t width);
+    bool EvictOne();
+
+    // Returns false if the glyph could not fit and should be tried again later
+    bool AddGlyph(RasterisedGlyph &);
 
     uint32_t m_textureDimension;
+    uint32_t m_loadThreadCount;
     FT_Library m_pContext;
     TempData *m_pTempData;
     Dg::Map_AVL<GlyphID, GlyphData> m_charMap;
     std::vector<Ref<Texture2D>> m_textures;
+    uint32_t m_version;
+
+    uint32_t m_distanceFieldSize;               // 0 if glyphs are plain bitmaps
+    Dg::Map_AVL<GlyphID, GlyphData> m_scaled;   // Distance field glyphs at the sizes asked for
+
+    GlyphRasteriser * m_pRasteriser;
+    size_t m_memoryBudget;
+    uint64_t m_frame;
+    uint64_t m_changedFrame;
+    uint64_t m_inUseFrame;                      // Glyphs used since this frame may be on screen
+    std::vector<Page> m_pages;
+    Dg::Map_AVL<GlyphID, CachedGlyph> m_cache;
+    std::list<GlyphID> m_lru;                   // Most recently used first
+    std::vector<RasterisedGlyph> m_arrived;
   };
 
   Ref<IFontAtlas> Framework::CreateFontAtlas()
@@ -131,14 +606,24 @@ namespace Engine
 
   FreeTypeFontAtlas::FreeTypeFontAtlas()
     : m_textureDimension(FONTATLAS_DEFAULT_TEXTURE_DIMENSION)
+    , m_loadThreadCount(0)
     , m_pContext(nullptr)
     , m_pTempData(nullptr)
+    , m_version(0)
+    , m_distanceFieldSize(0)
+    , m_pRasteriser(nullptr)
+    , m_memoryBudget(0)
+    , m_frame(0)
+    , m_changedFrame(0)
+    , m_inUseFrame(0)
   {
 
   }
 
   FreeTypeFontAtlas::~FreeTypeFontAtlas()
   {
+    delete m_pRasteriser;
+    ClearCache();
     delete m_pTempData;
     FT_Done_FreeType(m_pContext);
   }
@@ -153,6 +638,7 @@ namespace Engine
     delete m_pTempData;
     m_pTempData = nullptr;
     m_textures.clear();
+    ClearCache();
   }
 
   void FreeTypeFontAtlas::SetTextureDimension(uint32_t a_uv)
@@ -221,6 +707,7 @@ epilogue:
     delete m_pTempData;
     m_pTempData = new TempData();
     m_textures.clear();
+    ClearCache();
 
     for (uint32_t i = 0; i < (uint32_t)s_Fonts.size(); i++)
     {
@@ -237,8 +724,11 @@ epilogue:
     DG_ERROR_NULL(m_pTempData, Dg::ErrorCode::NullObject);
     DG_ERROR_IF((size_t)fID >= s_Fonts.size(), Dg::ErrorCode::OutOfBounds);
 
+    if (m_distanceFieldSize != 0)
+      DG_ERROR_CHECK(LoadSizeRange(fID, size));
+
     lg.cp = cp;
-    lg.size = size;
+    lg.size = GetLoadSize(size);
     
     m_pTempData->loadFonts[fID].glyphs.insert(lg);
 
@@ -258,6 +748,13 @@ epilogue:
     DG_ERROR_NULL(m_pTempData, Dg::ErrorCode::NullObject);
     DG_ERROR_IF((size_t)fID >= s_Fonts.size(), Dg::ErrorCode::OutOfBounds);
 
+    // Glyphs will be loaded as they are used
+    if (m_pRasteriser != nullptr || m_distanceFieldSize != 0)
+      DG_ERROR_CHECK(LoadSizeRange(fID, size));
+
+    if (m_pRasteriser != nullptr)
+      DG_ERROR_SET_AND_BREAK(Dg::ErrorCode::None);
+
     err = FT_New_Face(m_pContext, s_Fonts[fID].path.c_str(), 0, &face);
     DG_ERROR_IF(err == FT_Err_Unknown_File_Format, Dg::ErrorCode::IncorrectFileType);
     DG_ERROR_IF(err != 0, Dg::ErrorCode::FailedToOpenFile);
@@ -268,7 +765,7 @@ epilogue:
     {
       LoadGlyph lg = {};
       lg.cp = charcode;
-      lg.size = size;
+      lg.size = GetLoadSize(size);
 
       m_pTempData->loadFonts[fID].glyphs.insert(lg);
       charcode = FT_Get_Next_Char(face, charcode, &gindex);
@@ -284,67 +781,94 @@ epilogue:
     return result;
   }
 
-  Dg::ErrorCode FreeTypeFontAtlas::GenerateCharMap()
+  // Glyphs are split into a contiguous slice per job, run on the JobPool, and each slice writes
+  // to its own part of the results. So the results, and how they are packed, do not depend on 
+  // the thread count.
+  Dg::ErrorCode FreeTypeFontAtlas::RasteriseGlyphs()
   {
     Dg::ErrorCode result;
-    FT_Error err;
+    std::vector<GlyphID> ids;
+    std::vector<Dg::ErrorCode> sliceResults;
+    uint32_t threadCount = 0;
+    size_t sliceSize = 0;
 
     DG_ERROR_NULL(m_pTempData, Dg::ErrorCode::NullObject);
 
     for (size_t i = 0; i < m_pTempData->loadFonts.size(); i++)
     {
-      FT_Face face = nullptr;
-      err = FT_New_Face(m_pContext, s_Fonts[i].path.c_str(), 0, &face);
-      DG_ERROR_IF(err == FT_Err_Unknown_File_Format, Dg::ErrorCode::IncorrectFileType);
-      DG_ERROR_IF(err != 0, Dg::ErrorCode::FailedToOpenFile);
+      for (std::set<LoadGlyph>::const_iterator it = m_pTempData->loadFonts[i].glyphs.begin(); it != m_pTempData->loadFonts[i].glyphs.end(); it++)
+        ids.push_back(PackGlyphID(FontID(i), it->cp, it->size));
+    }
 
-      FT_Select_Charmap(face, FT_ENCODING_UNICODE);
-      for (std::set<LoadGlyph>::iterator it = m_pTempData->loadFonts[i].glyphs.begin(); it != m_pTempData->loadFonts[i].glyphs.end();)
+    m_pTempData->glyphs.assign(ids.size(), RasterisedGlyph());
+    threadCount = GetLoadThreadCount(ids.size());
+    sliceSize = (ids.size() + threadCount - 1) / threadCount;
+    sliceResults.assign(threadCount, Dg::ErrorCode::None);
+
+    JobPool::Run(threadCount, [&ids, &sliceResults, sliceSize, spread = GetSpread(), pOut = m_pTempData->glyphs.data()](uint32_t a_slice)
       {
-        FT_Set_Pixel_Sizes(face, 0, it->size);
+        sliceResults[a_slice] = RasteriseSlice(ids, std::min(ids.size(), a_slice * sliceSize), std::min(ids.size(), (a_slice + 1) * sliceSize), spread, pOut);
+      });
 
-        bool hasFailed = true;
-        do
-        {
-          if (FT_Load_Char(face, it->cp, FT_LOAD_RENDER) != 0)
-          {
-            LOG_WARN("Failed to read character: {}", it->cp);
-            break;
-          }
+    for (size_t t = 0; t < sliceResults.size(); t++)
+      DG_ERROR_CHECK(sliceResults[t]);
 
-          GlyphID glyphID = PackGlyphID(FontID(i), it->cp, it->size);
+    result = Dg::ErrorCode::None;
+  epilogue:
+    return result;
+  }
 
-          GlyphData gData ={};
-          gData.textureID = INVALID_FONT_TEXTURE;
-          gData.advance = (int16_t)(face->glyph->advance.x >> 6);
-          gData.width = face->glyph->bitmap.width;
-          gData.height = face->glyph->bitmap.rows;
-          gData.bearingX = face->glyph->bitmap_left;
-          gData.bearingY = face->glyph->bitmap_top;
+  uint32_t FreeTypeFontAtlas::GetLoadThreadCount(size_t a_glyphCount) const
+  {
+    uint32_t count = m_loadThreadCount;
+    if (count == 0)
+      count = JobPool::GetConcurrency();
 
-          m_charMap.insert(Dg::Pair<GlyphID, GlyphData>(glyphID, gData));
+    // Each slice opens its own faces, which is not worth it for a few glyphs
+    size_t maxCount = a_glyphCount / FONTATLAS_MIN_GLYPHS_PER_LOAD_THREAD + 1;
+    return uint32_t(std::min(size_t(count), maxCount));
+  }
 
-          int16_t ascent = gData.bearingY;
-          int16_t descent = gData.bearingY - gData.height;
+  void FreeTypeFontAtlas::SetLoadThreadCount(uint32_t a_count)
+  {
+    m_loadThreadCount = a_count;
+  }
 
-          FontSizeData & fsData = s_Fonts[i].fontSizeData[it->size];
+  Dg::ErrorCode FreeTypeFontAtlas::GenerateCharMap()
+  {
+    Dg::ErrorCode result;
 
-          if (ascent > fsData.greatestAscent)
-            fsData.greatestAscent = ascent;
-          if (descent < fsData.greatestDescent)
-            fsData.greatestDescent = descent;
+    DG_ERROR_NULL(m_pTempData, Dg::ErrorCode::NullObject);
 
-          hasFailed = false;
-        } while (false);
+    for (size_t i = 0; i < m_pTempData->glyphs.size(); i++)
+    {
+      RasterisedGlyph const & glyph = m_pTempData->glyphs[i];
 
-        if (!hasFailed)
-        {
-          it++;
-        }
-        else
-        {
-          it = m_pTempData->loadFonts[i].glyphs.erase(it);
-        }
+      FontID fontID;
+      uint32_t size;
+      CodePoint cp;
+      UnpackGlyphID(glyph.id, fontID, cp, size);
+
+      if (glyph.failed)
+      {
+        LOG_WARN("Failed to read character: {}", cp);
+        continue;
+      }
+
+      m_charMap.insert(Dg::Pair<GlyphID, GlyphData>(glyph.id, glyph.data));
+
+      // Size ranges for distance fields were set from the font metrics when registering
+      if (m_distanceFieldSize == 0)
+      {
+        int16_t ascent = glyph.data.bearingY;
+        int16_t descent = glyph.data.bearingY - glyph.data.height;
+
+        FontSizeData & fsData = s_Fonts[fontID].fontSizeData[size];
+
+        if (ascent > fsData.greatestAscent)
+          fsData.greatestAscent = ascent;
+        if (descent < fsData.greatestDescent)
+          fsData.greatestDescent = descent;
       }
     }
 
@@ -356,35 +880,24 @@ epilogue:
   Dg::ErrorCode FreeTypeFontAtlas::GenerateTextures()
   {
     Dg::ErrorCode result;
-    FT_Error err;
     BinPacker binPacker;
-    std::vector<FT_Face> fonts;
     size_t previousRemaining = 0;
-    size_t remaining = m_charMap.size();
+    size_t remaining = 0;
 
     DG_ERROR_NULL(m_pTempData, Dg::ErrorCode::NullObject);
 
-    for (size_t i = 0; i < s_Fonts.size(); i++)
+    for (size_t i = 0; i < m_pTempData->glyphs.size(); i++)
     {
-      FT_Face face = nullptr;
-      err = FT_New_Face(m_pContext, s_Fonts[i].path.c_str(), 0, &face);
-      DG_ERROR_IF(err == FT_Err_Unknown_File_Format, Dg::ErrorCode::IncorrectFileType);
-      DG_ERROR_IF(err != 0, Dg::ErrorCode::FailedToOpenFile);
-      FT_Select_Charmap(face, FT_ENCODING_UNICODE);
-      fonts.push_back(face);
-    }
+      RasterisedGlyph const & glyph = m_pTempData->glyphs[i];
 
-    for (auto const & kv : m_charMap)
-    {
-      FontID fontID;
-      uint32_t size;
-      CodePoint cp;
-      UnpackGlyphID(kv.first, fontID, cp, size);
+      // White space...
+      if (glyph.pPixels == nullptr)
+        continue;
 
-      if (binPacker.RegisterItem(kv.first, kv.second.width, kv.second.height) != Dg::ErrorCode::None)
-      {
-        // White space...
-      }
+      if (binPacker.RegisterItem(glyph.id, 
+                                 glyph.data.texWidth + FONTATLAS_GLYPH_PADDING, 
+                                 glyph.data.texHeight + FONTATLAS_GLYPH_PADDING) == Dg::ErrorCode::None)
+        remaining++;
     }
 
     while ((remaining > 0) && (previousRemaining != remaining))
@@ -395,7 +908,7 @@ epilogue:
         [ &charMap = this->m_charMap,
           &textures = this->m_textures,
           &textureDimension = this->m_textureDimension,
-          &fonts,
+          &glyphs = this->m_pTempData->glyphs,
           &pBuffer ]
       (Dg::BinPacker<uint32_t, GlyphID>::Item const & item)
       {
@@ -416,44 +929,21 @@ epilogue:
         it->second.posY = (uint16_t)item.xy[1];
         it->second.textureID = uint16_t(textures.size());
 
-        FT_Set_Pixel_Sizes(fonts[fontID], 0, size);
-        if (FT_Load_Char(fonts[fontID], cp, FT_LOAD_RENDER) != 0)
-        {
-          LOG_WARN("Failed to load character. Font: {}, size: {}, code point: {}", fontID, size, cp);
-          return;
-        }
+        std::vector<RasterisedGlyph>::const_iterator glyph = std::lower_bound(glyphs.begin(), glyphs.end(), item.id,
+          [](RasterisedGlyph const & a, GlyphID b) { return a.id < b; });
 
-        for (int xLocal = 0; xLocal < it->second.width; xLocal++)
-        {
-          int x = item.xy[0] + xLocal;
-          for (int yLocal = 0; yLocal < it->second.height; yLocal++)
-          {
-            int y = item.xy[1] + yLocal;
-            uint8_t pixel = fonts[fontID]->glyph->bitmap.buffer[yLocal * fonts[fontID]->glyph->bitmap.width + xLocal];
-            pBuffer[y * textureDimension + x] = pixel;
-          }
-        }
+        uint32_t w = it->second.texWidth + FONTATLAS_GLYPH_PADDING;
+        uint32_t h = it->second.texHeight + FONTATLAS_GLYPH_PADDING;
+        for (uint32_t y = 0; y < h; y++)
+          memcpy(&pBuffer[(item.xy[1] + y) * textureDimension + item.xy[0]], &glyph->pPixels[y * w], w);
       };
 
       previousRemaining = remaining;
       remaining = binPacker.Fill(callback, m_textureDimension, m_textureDimension);
 
-      Ref<Texture2D> texture = Texture2D::Create();
-      TextureAttributes attrs;
-      attrs.SetFilter(TextureFilter::Linear);
-      attrs.SetIsMipmapped(false);
-      attrs.SetWrap(TextureWrap::None);
-      attrs.SetPixelType(TexturePixelType::R8);
-
-      texture->Set(m_textureDimension, m_textureDimension, pBuffer, attrs);
-      texture->Upload(true);
-
-      m_textures.push_back(texture);
+      m_textures.push_back(CreateAtlasTexture(m_textureDimension, pBuffer));
     }
 
-    for (FT_Face face : fonts)
-      FT_Done_Face(face);
-
     if (remaining > 0)
       LOG_WARN("Glyphs not loaded: {}", remaining);
 
@@ -468,9 +958,19 @@ epilogue:
     Dg::ErrorCode result;
 
     DG_ERROR_NULL(m_pTempData, Dg::ErrorCode::NullObject);
-    DG_ERROR_CHECK(GenerateCharMap());
-    DG_ERROR_CHECK(GenerateTextures());
 
+    if (m_pRasteriser != nullptr)
+    {
+      DG_ERROR_CHECK(CommitDynamic());
+    }
+    else
+    {
+      DG_ERROR_CHECK(RasteriseGlyphs());
+      DG_ERROR_CHECK(GenerateCharMap());
+      DG_ERROR_CHECK(GenerateTextures());
+    }
+
+    Changed();
     result = Dg::ErrorCode::None;
   epilogue:
 
@@ -485,10 +985,59 @@ epilogue:
 
   GlyphData * FreeTypeFontAtlas::GetGlyphData(FontID fID, CodePoint cp, uint32_t size)
   {
-    Dg::Map_AVL<GlyphID, GlyphData>::iterator it = m_charMap.find(PackGlyphID(fID, cp, size));
-    if (it != m_charMap.end())
-      return &(it->second);
-    return nullptr;
+    GlyphData * pData = nullptr;
+    GlyphID loadID = PackGlyphID(fID, cp, GetLoadSize(size));
+
+    if (m_pRasteriser != nullptr)
+    {
+      if ((size_t)fID < s_Fonts.size())
+        pData = GetDynamicGlyphData(loadID);
+    }
+    else
+    {
+      Dg::Map_AVL<GlyphID, GlyphData>::iterator it = m_charMap.find(loadID);
+      if (it != m_charMap.end())
+        pData = &(it->second);
+    }
+
+    return GetScaledGlyphData(pData, PackGlyphID(fID, cp, size), size);
+  }
+
+  GlyphData * FreeTypeFontAtlas::GetScaledGlyphData(GlyphData * a_pData, GlyphID a_id, uint32_t a_size)
+  {
+    if (a_pData == nullptr || m_distanceFieldSize == 0 || a_size == m_distanceFieldSize)
+      return a_pData;
+
+    // The texture region stays the same; only where it is drawn changes
+    float scale = float(a_size) / float(m_distanceFieldSize);
+    GlyphData & scaled = m_scaled[a_id];
+    scaled = *a_pData;
+    scaled.advance = int16_t(roundf(float(a_pData->advance) * scale));
+    scaled.width = uint16_t(roundf(float(a_pData->width) * scale));
+    scaled.height = uint16_t(roundf(float(a_pData->height) * scale));
+    scaled.bearingX = int16_t(roundf(float(a_pData->bearingX) * scale));
+    scaled.bearingY = int16_t(roundf(float(a_pData->bearingY) * scale));
+    return &scaled;
+  }
+
+  uint32_t FreeTypeFontAtlas::GetLoadSize(uint32_t a_size) const
+  {
+    return m_distanceFieldSize != 0 ? m_distanceFieldSize : a_size;
+  }
+
+  uint32_t FreeTypeFontAtlas::GetSpread() const
+  {
+    return m_distanceFieldSize != 0 ? FONTATLAS_SDF_SPREAD : 0;
+  }
+
+  void FreeTypeFontAtlas::EnableDistanceField(uint32_t a_referenceSize)
+  {
+    m_distanceFieldSize = a_referenceSize;
+  }
+
+  bool FreeTypeFontAtlas::IsDistanceField() const
+  {
+    return m_distanceFieldSize != 0;
   }
 
   Dg::ErrorCode FreeTypeFontAtlas::GetTexture(uint16_t a_index, Ref<Texture2D> & a_out)
@@ -498,4 +1047,345 @@ epilogue:
     a_out = m_textures[a_index];
     return Dg::ErrorCode::None;
   }
-}
\ No newline at end of file
+
+  uint32_t FreeTypeFontAtlas::GetVersion() const
+  {
+    return m_version;
+  }
+
+  void FreeTypeFontAtlas::Changed()
+  {
+    m_version++;
+    m_changedFrame = m_frame;
+  }
+
+  //------------------------------------------------------------------------------------------------
+  // Dynamic loading
+  //------------------------------------------------------------------------------------------------
+
+  void FreeTypeFontAtlas::EnableDynamicLoading(size_t a_memoryBudget)
+  {
+    m_memoryBudget = a_memoryBudget;
+    if (m_pRasteriser == nullptr)
+      m_pRasteriser = new GlyphRasteriser();
+  }
+
+  void FreeTypeFontAtlas::ClearCache()
+  {
+    m_scaled.clear();
+    m_cache.clear();
+    m_lru.clear();
+    m_pages.clear();
+
+    for (size_t i = 0; i < m_arrived.size(); i++)
+      delete[] m_arrived[i].pPixels;
+    m_arrived.clear();
+
+    Changed();
+  }
+
+  Dg::ErrorCode FreeTypeFontAtlas::LoadSizeRange(FontID a_fID, uint32_t a_size)
+  {
+    Dg::ErrorCode result;
+    FT_Face face = nullptr;
+    FT_Error err;
+
+    if (s_Fonts[a_fID].fontSizeData.find(a_size) != s_Fonts[a_fID].fontSizeData.end())
+      DG_ERROR_SET_AND_BREAK(Dg::ErrorCode::None);
+
+    err = FT_New_Face(m_pContext, s_Fonts[a_fID].path.c_str(), 0, &face);
+    DG_ERROR_IF(err == FT_Err_Unknown_File_Format, Dg::ErrorCode::IncorrectFileType);
+    DG_ERROR_IF(err != 0, Dg::ErrorCode::FailedToOpenFile);
+
+    FT_Set_Pixel_Sizes(face, 0, a_size);
+
+    // No glyphs have been rasterised yet, so go by the extents the font gives for this size
+    {
+      FontSizeData & fsData = s_Fonts[a_fID].fontSizeData[a_size];
+      fsData.greatestAscent = (int16_t)(face->size->metrics.ascender >> 6);
+      fsData.greatestDescent = (int16_t)(face->size->metrics.descender >> 6);
+    }
+
+    result = Dg::ErrorCode::None;
+  epilogue:
+    FT_Done_Face(face);
+    return result;
+  }
+
+  Dg::ErrorCode FreeTypeFontAtlas::CommitDynamic()
+  {
+    Dg::ErrorCode result;
+
+    // Samplers need something bound before any glyphs arrive
+    if (m_pages.empty())
+      AddPage();
+
+    // Registered glyphs are requested now so they are ready sooner
+    for (size_t i = 0; i < m_pTempData->loadFonts.size(); i++)
+    {
+      for (std::set<LoadGlyph>::const_iterator it = m_pTempData->loadFonts[i].glyphs.begin(); it != m_pTempData->loadFonts[i].glyphs.end(); it++)
+      {
+        DG_ERROR_CHECK(LoadSizeRange(FontID(i), it->size));
+        GetDynamicGlyphData(PackGlyphID(FontID(i), it->cp, it->size));
+      }
+    }
+
+    result = Dg::ErrorCode::None;
+  epilogue:
+    return result;
+  }
+
+  GlyphData * FreeTypeFontAtlas::GetDynamicGlyphData(GlyphID a_id)
+  {
+    CachedGlyph * pGlyph = m_cache.at(a_id);
+
+    if (pGlyph == nullptr)
+    {
+      FontID fontID;
+      uint32_t size;
+      CodePoint cp;
+      UnpackGlyphID(a_id, fontID, cp, size);
+
+      CachedGlyph glyph = {};
+      glyph.state = GlyphState::Loading;
+      m_cache.insert(a_id, glyph);
+      m_pRasteriser->Request(a_id, s_Fonts[fontID].path, GetSpread());
+      return nullptr;
+    }
+
+    if (pGlyph->state != GlyphState::Ready)
+      return nullptr;
+
+    if (pGlyph->data.textureID != INVALID_FONT_TEXTURE)
+    {
+      pGlyph->lastUsed = m_frame;
+      m_lru.splice(m_lru.begin(), m_lru, pGlyph->lru);
+    }
+
+    return &pGlyph->data;
+  }
+
+  void FreeTypeFontAtlas::Update()
+  {
+    if (m_pRasteriser == nullptr)
+      return;
+
+    // If the atlas changed last frame, everything drawn since has been laid out again, 
+    // so any glyph on screen has been used since then.
+    if (m_changedFrame == m_frame)
+      m_inUseFrame = m_frame;
+    m_frame++;
+
+    // Glyphs which did not fit last frame are tried first
+    m_pRasteriser->TakeResults(m_arrived);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < m_arrived.size(); i++)
+    {
+      if (!AddGlyph(m_arrived[i]))
+        m_arrived[kept++] = m_arrived[i];
+    }
+    m_arrived.resize(kept);
+  }
+
+  bool FreeTypeFontAtlas::AddGlyph(RasterisedGlyph & a_glyph)
+  {
+    FontID fontID;
+    uint32_t size;
+    CodePoint cp;
+    uint16_t page, shelf, x, y;
+    uint32_t w, h;
+    UnpackGlyphID(a_glyph.id, fontID, cp, size);
+
+    // Glyphs can be cleared while they are loading
+    CachedGlyph * pGlyph = m_cache.at(a_glyph.id);
+    if (pGlyph == nullptr || pGlyph->state != GlyphState::Loading)
+    {
+      delete[] a_glyph.pPixels;
+      return true;
+    }
+
+    if (a_glyph.failed)
+    {
+      LOG_WARN("Failed to load character. Font: {}, size: {}, code point: {}", fontID, size, cp);
+      pGlyph->state = GlyphState::Missing;
+      return true;
+    }
+
+    // White space
+    if (a_glyph.pPixels == nullptr)
+    {
+      pGlyph->data = a_glyph.data;
+      pGlyph->state = GlyphState::Ready;
+      Changed();
+      return true;
+    }
+
+    w = a_glyph.data.texWidth + FONTATLAS_GLYPH_PADDING;
+    h = a_glyph.data.texHeight + FONTATLAS_GLYPH_PADDING;
+    if (w > m_textureDimension || h > m_textureDimension)
+    {
+      LOG_WARN("Character too large for the font atlas. Font: {}, size: {}, code point: {}", fontID, size, cp);
+      pGlyph->state = GlyphState::Missing;
+      delete[] a_glyph.pPixels;
+      return true;
+    }
+
+    while (!Allocate(w, h, page, shelf, x, y))
+    {
+      if (!EvictOne())
+        return false;
+    }
+
+    m_textures[page]->SetSubData(x, y, w, h, a_glyph.pPixels);
+    delete[] a_glyph.pPixels;
+    a_glyph.pPixels = nullptr;
+
+    m_lru.push_front(a_glyph.id);
+
+    // Evicting may have moved things around in the cache
+    pGlyph = m_cache.at(a_glyph.id);
+    pGlyph->data = a_glyph.data;
+    pGlyph->data.textureID = page;
+    pGlyph->data.posX = x;
+    pGlyph->data.posY = y;
+    pGlyph->shelf = shelf;
+    pGlyph->lastUsed = m_frame;
+    pGlyph->lru = m_lru.begin();
+    pGlyph->state = GlyphState::Ready;
+
+    Changed();
+    return true;
+  }
+
+  bool FreeTypeFontAtlas::EvictOne()
+  {
+    if (m_lru.empty())
+      return false;
+
+    GlyphID id = m_lru.back();
+    CachedGlyph * pGlyph = m_cache.at(id);
+    if (pGlyph->lastUsed >= m_inUseFrame)
+      return false;
+
+    Free(pGlyph->data.textureID, pGlyph->shelf, pGlyph->data.posX, uint16_t(pGlyph->data.texWidth + FONTATLAS_GLYPH_PADDING));
+    m_lru.pop_back();
+    m_cache.erase(id);
+
+    Changed();
+    return true;
+  }
+
+  void FreeTypeFontAtlas::AddPage()
+  {
+    Page page;
+    page.shelfEnd = 0;
+    m_pages.push_back(page);
+    m_textures.push_back(CreateAtlasTexture(m_textureDimension, new uint8_t[m_textureDimension * m_textureDimension]{}));
+  }
+
+  bool FreeTypeFontAtlas::AllocateInShelf(Shelf & a_shelf, uint32_t a_width, uint16_t & a_x)
+  {
+    for (size_t i = 0; i < a_shelf.free.size(); i++)
+    {
+      Span & span = a_shelf.free[i];
+      if (span.width < a_width)
+        continue;
+
+      a_x = span.x;
+      span.x += uint16_t(a_width);
+      span.width -= uint16_t(a_width);
+      if (span.width == 0)
+        a_shelf.free.erase(a_shelf.free.begin() + i);
+      return true;
+    }
+    return false;
+  }
+
+  bool FreeTypeFontAtlas::Allocate(uint32_t a_width, uint32_t a_height, uint16_t & a_page, uint16_t & a_shelf, uint16_t & a_x, uint16_t & a_y)
+  {
+    // First try shelves near the glyph height, then open new shelves, and only then put
+    // the glyph in a shelf much taller than it.
+    uint32_t maxHeight = a_height + a_height / 2;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+      for (size_t p = 0; p < m_pages.size(); p++)
+      {
+        Page & page = m_pages[p];
+        for (size_t s = 0; s < page.shelves.size(); s++)
+        {
+          Shelf & shelf = page.shelves[s];
+          if (shelf.height < a_height || (pass == 0 && shelf.height > maxHeight))
+            continue;
+
+          if (AllocateInShelf(shelf, a_width, a_x))
+          {
+            a_page = uint16_t(p);
+            a_shelf = uint16_t(s);
+            a_y = shelf.y;
+            return true;
+          }
+        }
+
+        if (pass == 0 && page.shelfEnd + a_height <= m_textureDimension)
+        {
+          Shelf shelf;
+          shelf.y = uint16_t(page.shelfEnd);
+          shelf.height = uint16_t(a_height);
+          shelf.free.push_back({0, uint16_t(m_textureDimension)});
+          page.shelves.push_back(shelf);
+          page.shelfEnd += a_height;
+
+          AllocateInShelf(page.shelves.back(), a_width, a_x);
+          a_page = uint16_t(p);
+          a_shelf = uint16_t(page.shelves.size() - 1);
+          a_y = shelf.y;
+          return true;
+        }
+      }
+    }
+
+    size_t pageSize = size_t(m_textureDimension) * m_textureDimension;
+    if ((m_pages.size() + 1) * pageSize <= m_memoryBudget)
+    {
+      AddPage();
+      return Allocate(a_width, a_height, a_page, a_shelf, a_x, a_y);
+    }
+
+    return false;
+  }
+
+  void FreeTypeFontAtlas::Free(uint16_t a_page, uint16_t a_shelf, uint16_t a_x, uint16_t a_width)
+  {
+    Page & page = m_pages[a_page];
+    std::vector<Span> & free = page.shelves[a_shelf].free;
+
+    size_t i = 0;
+    while (i < free.size() && free[i].x < a_x)
+      i++;
+    free.insert(free.begin() + i, {a_x, a_width});
+
+    // Merge with the neighbours
+    if (i + 1 < free.size() && free[i].x + free[i].width == free[i + 1].x)
+    {
+      free[i].width += free[i + 1].width;
+      free.erase(free.begin() + i + 1);
+    }
+    if (i > 0 && free[i - 1].x + free[i - 1].width == free[i].x)
+    {
+      free[i - 1].width += free[i].width;
+      free.erase(free.begin() + i);
+    }
+
+    // Give empty shelves at the bottom of the page back, so they can be opened at another height
+    while (!page.shelves.empty())
+    {
+      Shelf const & last = page.shelves.back();
+      if (last.free.size() != 1 || last.free[0].width != m_textureDimension)
+        break;
+      page.shelfEnd = last.y;
+      page.shelves.pop_back();
+    }
+  }
+}
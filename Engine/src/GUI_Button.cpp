@@ -142,7 +142,7 @@ namespace Engine
       vec2 pos = GetGlobalPosition() + vec2(m_outlineWidth, m_outlineWidth);
       int s = m_state == WidgetState::HoverOn ? (int)ButtonState::Hover : (int)ButtonState::Normal;
 
-      ::Engine::Renderer::SetSissorBox((int)viewableWindow.position.x(), (int)viewableWindow.position.y(), (int)viewableWindow.size.x(), (int)viewableWindow.size.y());
+      Renderer::SetClipRect(viewableWindow);
       Renderer::DrawBoxWithOutline({pos, size}, m_outlineWidth, m_clr[s][(int)ButtonElement::Face], m_clr[s][(int)ButtonElement::Outline]);
 
       m_pText->SetColour(m_clr[s][(int)ButtonElement::Text]);
@@ -205,7 +205,7 @@ namespace Engine
 
         vec2 pos = m_pData->pContainer->GetGlobalPosition() + vec2(m_pData->outlineWidth, m_pData->outlineWidth);
 
-        ::Engine::Renderer::SetSissorBox((int)viewableWindow.position.x(), (int)viewableWindow.position.y(), (int)viewableWindow.size.x(), (int)viewableWindow.size.y());
+        Renderer::SetClipRect(viewableWindow);
         Renderer::DrawBoxWithOutline({pos, size}, m_pData->outlineWidth, m_pData->clr[(int)ContainerElement::Face], m_pData->clr[(int)ContainerElement::Outline]);
       }
 
@@ -3,12 +3,14 @@
 #include "GUI.h"
 #include "GUI_Internal.h"
 #include "BSR_Assert.h"
+#include "Log.h"
 #include "Framework.h"
 #include "Material.h"
 #include "ShaderUniform.h"
 #include "RendererProgram.h"
 #include "VertexArray.h"
 #include "Renderer.h"
+#include "DgDynamicArray.h"
 #include <algorithm>
 
 // TODO This needs to come from input args or something
@@ -20,66 +22,74 @@ namespace Engine
   {
     namespace Renderer
     {
-      static char const * g_flatShader_vs = R"(
+      // Boxes, outline edges and glyphs are all drawn as instances of a unit quad. Each 
+      // instance is clipped to its own clip rect, so the GUI needs no scissor changes.
+      static char const * g_shader_vs = R"(
       #version 430
       layout(location = 0) in vec2 inPos;
+      layout(location = 1) in vec4 inRect;
+      layout(location = 2) in vec4 inClip;
+      layout(location = 3) in vec4 inColour;
+      layout(location = 4) in vec4 inTexRect;
+      layout(location = 5) in float inTextured;
       uniform vec2 windowSize;
-      uniform vec2 offset;
-      uniform vec2 scale;
+      out vec2 texCoord;
+      out vec4 colour;
+      flat out float textured;
       void main()
       {
-        vec2 xy = ((inPos * scale + offset)  / windowSize  - vec2(0.5, 0.5)) * 2.0;
-        xy.y = -xy.y;
-        gl_Position = vec4(xy, 0.0, 1.0);
-      })";
+        // Quads outside the clip rect collapse to a point
+        vec2 lower = max(inRect.xy, inClip.xy);
+        vec2 upper = max(lower, min(inRect.xy + inRect.zw, inClip.xy + inClip.zw));
+        vec2 pos = mix(lower, upper, inPos);
 
-      static char const * g_boxBorderShader_vs = R"(
-      #version 430
-      layout(location = 0) in vec2 inPos;
-      uniform vec2 windowSize;
-      void main()
-      {
-        vec2 xy = (inPos  / windowSize  - vec2(0.5, 0.5)) * 2.0;
+        // Distance field glyphs are drawn at a different size to the texture
+        texCoord = inTexRect.xy + (pos - inRect.xy) * (inTexRect.zw / max(inRect.zw, vec2(1.0)));
+        colour = inColour;
+        textured = inTextured;
+
+        vec2 xy = (pos / windowSize - vec2(0.5, 0.5)) * 2.0;
         xy.y = -xy.y;
         gl_Position = vec4(xy, 0.0, 1.0);
       })";
 
-      static char const * g_flatShader_fs = R"(
+      static char const * g_shader_fs = R"(
       #version 430
-      uniform vec4 colour;
+      in vec2 texCoord;
+      in vec4 colour;
+      flat in float textured;
       out vec4 FragColour;
+      uniform sampler2D textureAtlas;
       void main()
       {
-        FragColour = colour;
-      })";
-
-      static char const * g_textShader_vs = R"(
-      #version 430
-      layout (location = 0) in vec2 inPos;
-      layout (location = 1) in vec2 inPosOffset;
-      layout (location = 2) in vec2 inTexOffset;
-      layout (location = 3) in vec2 inScale;
-      uniform vec2 windowSize;
-      out vec2 texCoord;
-      void main()
-      {
-        vec2 posXY = ((inPos * inScale + inPosOffset)  / windowSize  - vec2(0.5, 0.5)) * 2.0;
-        posXY.y = -posXY.y;
-        texCoord = inPos * inScale + inTexOffset;
-        gl_Position = vec4(posXY, 0.0, 1.0);
+        float alpha = 1.0;
+        if (textured != 0.0)
+        {
+          ivec2 texDim = textureSize(textureAtlas, 0);
+          alpha = texture(textureAtlas, texCoord / vec2(float(texDim.x), float(texDim.y))).x;
+        }
+        FragColour = vec4(colour.x, colour.y, colour.z, colour.w * alpha);
       })";
 
-      static char const * g_textShader_fs = R"(
+      // Used when the font atlas holds distance fields. The edge is antialiased over a pixel.
+      static char const * g_shaderSDF_fs = R"(
       #version 430
       in vec2 texCoord;
-      out vec4 FragColor;
+      in vec4 colour;
+      flat in float textured;
+      out vec4 FragColour;
       uniform sampler2D textureAtlas;
-      uniform vec4 textColour;
       void main()
       {
-        ivec2 texDim = textureSize(textureAtlas, 0);
-        vec2 texCoordn = texCoord / vec2(float(texDim.x), float(texDim.y));
-        FragColor = vec4(textColour.x, textColour.y, textColour.z, textColour.w * texture(textureAtlas, texCoordn).x);
+        float alpha = 1.0;
+        if (textured != 0.0)
+        {
+          ivec2 texDim = textureSize(textureAtlas, 0);
+          float dist = texture(textureAtlas, texCoord / vec2(float(texDim.x), float(texDim.y))).x;
+          float width = max(fwidth(dist), 0.0001) * 0.5;
+          alpha = smoothstep(0.5 - width, 0.5 + width, dist);
+        }
+        FragColour = vec4(colour.x, colour.y, colour.z, colour.w * alpha);
       })";
 
       static float const g_unitBoxVerts[] =
@@ -92,12 +102,22 @@ namespace Engine
 
       static uint16_t const g_unitBoxIndices[] ={0, 1, 2, 0, 2, 3};
 
-      static uint16_t const g_boxBorderIndices[] =
+      // Positions are in pixels, [0, 0] top left
+      struct Instance
+      {
+        float rect[4];        // x, y, w, h
+        float clip[4];        // x, y, w, h
+        float colour[4];
+        float texRect[4];     // Glyph in the atlas, in texels
+        float textured;       // 0 for a flat colour
+      };
+
+      // A run of instances drawn with the same atlas texture
+      struct Batch
       {
-        0, 5, 4,  0, 5, 1,
-        1, 6, 5,  1, 6, 2,
-        2, 7, 6,  2, 7, 3,
-        3, 4, 7,  3, 4, 0
+        uint32_t first;
+        uint32_t count;
+        uint16_t textureID;
       };
 
       struct RenderContext
@@ -105,101 +125,65 @@ namespace Engine
         Ref<IFontAtlas> fontAtlas;
         FontID defaultFont;
 
-        Ref<VertexBuffer> vb_unitBox;
-        Ref<IndexBuffer>  ib_unitBox;
-        Ref<VertexArray>  va_unitBox;
-        Ref<Material>     materialColourBox;
+        Ref<VertexBuffer>           vb_unitBox;
+        Ref<IndexBuffer>            ib_unitBox;
+        Ref<StreamingVertexBuffer>  vb_instances;
+        Ref<VertexArray>            va;
+        Ref<Material>               material;
 
-        Ref<VertexBuffer> vb_boxBorder;
-        Ref<IndexBuffer>  ib_boxBorder;
-        Ref<VertexArray>  va_boxBorder;
-        Ref<Material>     materialBoxBorder;
-
-        Ref<VertexBuffer> vb_textInstance;
-        Ref<VertexArray>  va_text;
-        Ref<Material>     materialText;
+        float clip[4];
+        Instance * pInstances;
+        uint32_t instanceCount;
+        Dg::DynamicArray<Batch> batches;
       };
 
       static RenderContext *s_pRenderContext = nullptr;
 
-      static void InitBox()
+      static void InitRenderer()
       {
-        s_pRenderContext->vb_unitBox = VertexBuffer::Create(g_unitBoxVerts, SIZEOF32(g_unitBoxVerts), BF_None);
+        s_pRenderContext->vb_unitBox = VertexBuffer::Create(g_unitBoxVerts, SIZEOF32(g_unitBoxVerts), BF_NoCopy);
         s_pRenderContext->vb_unitBox->SetLayout(
           {
-            { Engine::ShaderDataType::VEC2 }
+            { Engine::ShaderDataType::VEC2 }  // inPos
           });
 
-        s_pRenderContext->ib_unitBox = Engine::IndexBuffer::Create(g_unitBoxIndices, ARRAY_SIZE_32(g_unitBoxIndices));
-        s_pRenderContext->va_unitBox = Engine::VertexArray::Create();
-
-        s_pRenderContext->va_unitBox->AddVertexBuffer(s_pRenderContext->vb_unitBox);
-        s_pRenderContext->va_unitBox->SetIndexBuffer(s_pRenderContext->ib_unitBox);
-
-        Engine::ShaderData * pSD = new ShaderData({
-            { Engine::ShaderDomain::Vertex, Engine::StrType::Source, g_flatShader_vs },
-            { Engine::ShaderDomain::Fragment, Engine::StrType::Source, g_flatShader_fs }
-          });
-
-        ResourceManager::Instance()->RegisterResource(ir_GUIBoxShader, pSD);
-        Ref<Engine::RendererProgram> refProg;
-        refProg = Engine::RendererProgram::Create(ir_GUIBoxShader);
-        s_pRenderContext->materialColourBox = Material::Create(refProg);
-      }
-
-      static void InitBoxBorder()
-      {
-        s_pRenderContext->vb_boxBorder = VertexBuffer::Create(sizeof(float) * 2 * 8, BF_None);
-        s_pRenderContext->vb_boxBorder->SetLayout(
+        s_pRenderContext->vb_instances = StreamingVertexBuffer::Create(GUI_MAX_INSTANCES_PER_FRAME * sizeof(Instance));
+        s_pRenderContext->vb_instances->SetLayout(
           {
-            { Engine::ShaderDataType::VEC2 }
+            { Engine::ShaderDataType::VEC4 },  // inRect
+            { Engine::ShaderDataType::VEC4 },  // inClip
+            { Engine::ShaderDataType::VEC4 },  // inColour
+            { Engine::ShaderDataType::VEC4 },  // inTexRect
+            { Engine::ShaderDataType::FLOAT }  // inTextured
           });
 
-        s_pRenderContext->ib_boxBorder = Engine::IndexBuffer::Create(g_boxBorderIndices, ARRAY_SIZE_32(g_boxBorderIndices));
-        s_pRenderContext->va_boxBorder = Engine::VertexArray::Create();
+        s_pRenderContext->ib_unitBox = Engine::IndexBuffer::Create(g_unitBoxIndices, ARRAY_SIZE_32(g_unitBoxIndices), BF_NoCopy);
+        s_pRenderContext->va = Engine::VertexArray::Create();
 
-        s_pRenderContext->va_boxBorder->AddVertexBuffer(s_pRenderContext->vb_boxBorder);
-        s_pRenderContext->va_boxBorder->SetIndexBuffer(s_pRenderContext->ib_boxBorder);
+        s_pRenderContext->va->AddVertexBuffer(s_pRenderContext->vb_unitBox);
+        s_pRenderContext->va->AddVertexBuffer(s_pRenderContext->vb_instances);
+        s_pRenderContext->va->SetIndexBuffer(s_pRenderContext->ib_unitBox);
+        for (uint32_t i = 1; i <= 5; i++)
+          s_pRenderContext->va->SetVertexAttributeDivisor(i, 1);
 
         Engine::ShaderData * pSD = new ShaderData({
-            { Engine::ShaderDomain::Vertex, Engine::StrType::Source, g_boxBorderShader_vs },
-            { Engine::ShaderDomain::Fragment, Engine::StrType::Source, g_flatShader_fs }
+            { Engine::ShaderDomain::Vertex, Engine::StrType::Source, g_shader_vs },
+            { Engine::ShaderDomain::Fragment, Engine::StrType::Source, 
+              s_pRenderContext->fontAtlas->IsDistanceField() ? g_shaderSDF_fs : g_shader_fs }
           });
 
-        ResourceManager::Instance()->RegisterResource(ir_GUIBoxBorderShader, pSD);
+        ResourceManager::Instance()->RegisterResource(ir_GUIShader, pSD);
         Ref<Engine::RendererProgram> refProg;
-        refProg = Engine::RendererProgram::Create(ir_GUIBoxBorderShader);
-        s_pRenderContext->materialBoxBorder = Material::Create(refProg);
-      }
+        refProg = Engine::RendererProgram::Create(ir_GUIShader);
+        s_pRenderContext->material = Material::Create(refProg);
 
-      static void InitText()
-      {
-        s_pRenderContext->vb_textInstance = VertexBuffer::Create(MAX_TEXT_CHARACTERS * sizeof(float) * 6, BF_None);
-        s_pRenderContext->vb_textInstance->SetLayout(
-          {
-            { Engine::ShaderDataType::VEC2 }, // inPosOffset
-            { Engine::ShaderDataType::VEC2 }, // inTexOffset
-            { Engine::ShaderDataType::VEC2 }  // inScale
-          });
-
-        s_pRenderContext->va_text = Engine::VertexArray::Create();
-
-        s_pRenderContext->va_text->AddVertexBuffer(s_pRenderContext->vb_unitBox);
-        s_pRenderContext->va_text->AddVertexBuffer(s_pRenderContext->vb_textInstance);
-        s_pRenderContext->va_text->SetIndexBuffer(s_pRenderContext->ib_unitBox);
-        s_pRenderContext->va_text->SetVertexAttributeDivisor(1, 1);
-        s_pRenderContext->va_text->SetVertexAttributeDivisor(2, 1);
-        s_pRenderContext->va_text->SetVertexAttributeDivisor(3, 1);
+        // Batches of flat boxes still need something bound to the sampler
+        Ref<Texture2D> texture;
+        if (s_pRenderContext->fontAtlas->GetTexture(0, texture) == Dg::ErrorCode::None)
+          s_pRenderContext->material->SetTexture("textureAtlas", texture);
 
-        Engine::ShaderData * pSD = new ShaderData({
-            { Engine::ShaderDomain::Vertex, Engine::StrType::Source, g_textShader_vs },
-            { Engine::ShaderDomain::Fragment, Engine::StrType::Source, g_textShader_fs }
-          });
-      
-        ResourceManager::Instance()->RegisterResource(ir_GUITextShader, pSD);
-        Ref<Engine::RendererProgram> refProg;
-        refProg = Engine::RendererProgram::Create(ir_GUITextShader);
-        s_pRenderContext->materialText = Material::Create(refProg);
+        s_pRenderContext->pInstances = new Instance[GUI_INSTANCE_BATCH_SIZE];
+        s_pRenderContext->instanceCount = 0;
       }
 
       Dg::ErrorCode Init()
@@ -215,6 +199,14 @@ namespace Engine
         DG_ERROR_CHECK(s_pRenderContext->fontAtlas->RegisterFont(DEFAULT_FONT_PATH, s_pRenderContext->defaultFont));
         s_pRenderContext->fontAtlas->SetTextureDimension(FONTATLAS_DEFAULT_TEXTURE_DIMENSION);
 
+#ifdef ENABLE_DYNAMIC_FONT_ATLAS
+        s_pRenderContext->fontAtlas->EnableDynamicLoading(FONTATLAS_DYNAMIC_MEMORY_BUDGET);
+#endif
+
+#ifdef ENABLE_DISTANCE_FIELD_FONTS
+        s_pRenderContext->fontAtlas->EnableDistanceField(FONTATLAS_SDF_REFERENCE_SIZE);
+#endif
+
         s_pRenderContext->fontAtlas->BeginLoad();
 
         // TODO allow the user to load other fonts and font sizes
@@ -227,9 +219,7 @@ namespace Engine
 
         DG_ERROR_CHECK(s_pRenderContext->fontAtlas->CommitLoad());
 
-        InitBox();
-        InitBoxBorder();
-        InitText();
+        InitRenderer();
 
         result = Dg::ErrorCode::None;
       epilogue:
@@ -238,56 +228,84 @@ namespace Engine
 
       void Destroy()
       {
+        if (s_pRenderContext != nullptr)
+          delete[] s_pRenderContext->pInstances;
         delete s_pRenderContext;
         s_pRenderContext = nullptr;
       }
 
       void SetScreenSize(vec2 const & a_size)
       {
-        s_pRenderContext->materialColourBox->SetUniform("windowSize", a_size.GetData(), sizeof(a_size));
-        s_pRenderContext->materialBoxBorder->SetUniform("windowSize", a_size.GetData(), sizeof(a_size));
-        s_pRenderContext->materialText->SetUniform("windowSize", a_size.GetData(), sizeof(a_size));
+        s_pRenderContext->material->SetUniform("windowSize", a_size.GetData(), sizeof(a_size));
+        SetClipRect({vec2(0.0f, 0.0f), a_size});
       }
 
-      void DrawBox(UIAABB const & a_aabb, Colour a_colour)
+      void SetClipRect(UIAABB const & a_clip)
       {
-        float clr[4] ={a_colour.fr(), a_colour.fg(), a_colour.fb(), a_colour.fa()};
+        s_pRenderContext->clip[0] = a_clip.position.x();
+        s_pRenderContext->clip[1] = a_clip.position.y();
+        s_pRenderContext->clip[2] = a_clip.size.x();
+        s_pRenderContext->clip[3] = a_clip.size.y();
+      }
 
-        s_pRenderContext->materialColourBox->SetUniform("colour", clr, sizeof(clr));
-        s_pRenderContext->materialColourBox->SetUniform("offset", a_aabb.position.GetData(), sizeof(a_aabb.position));
-        s_pRenderContext->materialColourBox->SetUniform("scale", a_aabb.size.GetData(), sizeof(a_aabb.size));
+      // Instances are appended to the last batch, unless it uses a different texture.
+      // Flat boxes can go in any batch.
+      static Instance * AddInstance(Colour a_colour, uint16_t a_textureID)
+      {
+        if (s_pRenderContext->instanceCount == GUI_INSTANCE_BATCH_SIZE)
+          Flush();
+
+        Dg::DynamicArray<Batch> & batches = s_pRenderContext->batches;
+        if (batches.size() == 0
+          || (a_textureID != INVALID_FONT_TEXTURE 
+            && batches[batches.size() - 1].textureID != INVALID_FONT_TEXTURE
+            && batches[batches.size() - 1].textureID != a_textureID))
+          batches.push_back({s_pRenderContext->instanceCount, 0, a_textureID});
+
+        Batch & batch = batches[batches.size() - 1];
+        if (batch.textureID == INVALID_FONT_TEXTURE)
+          batch.textureID = a_textureID;
+        batch.count++;
+
+        Instance * pInstance = &s_pRenderContext->pInstances[s_pRenderContext->instanceCount];
+        s_pRenderContext->instanceCount++;
+
+        memcpy(pInstance->clip, s_pRenderContext->clip, sizeof(pInstance->clip));
+        pInstance->colour[0] = a_colour.fr();
+        pInstance->colour[1] = a_colour.fg();
+        pInstance->colour[2] = a_colour.fb();
+        pInstance->colour[3] = a_colour.fa();
+        memset(pInstance->texRect, 0, sizeof(pInstance->texRect));
+        pInstance->textured = 0.0f;
+        return pInstance;
+      }
 
-        s_pRenderContext->materialColourBox->Bind();
-        s_pRenderContext->va_unitBox->Bind();
+      static void AddBox(float a_x, float a_y, float a_w, float a_h, Colour a_colour)
+      {
+        Instance * pInstance = AddInstance(a_colour, INVALID_FONT_TEXTURE);
+        pInstance->rect[0] = a_x;
+        pInstance->rect[1] = a_y;
+        pInstance->rect[2] = a_w;
+        pInstance->rect[3] = a_h;
+      }
 
-        ::Engine::Renderer::DrawIndexed(s_pRenderContext->va_unitBox, RenderMode::Triangles, 1);
+      void DrawBox(UIAABB const & a_aabb, Colour a_colour)
+      {
+        AddBox(a_aabb.position.x(), a_aabb.position.y(), a_aabb.size.x(), a_aabb.size.y(), a_colour);
       }
 
       void DrawBoxOutline(UIAABB const & a_inner, float a_thickness, Colour a_colour)
       {
-        float verts[16] = 
-        {
-          a_inner.position.x(),                    a_inner.position.y(),
-          a_inner.position.x() + a_inner.size.x(), a_inner.position.y(),
-          a_inner.position.x() + a_inner.size.x(), a_inner.position.y() + a_inner.size.y(),
-          a_inner.position.x(),                    a_inner.position.y() + a_inner.size.y(),
-
-          a_inner.position.x() - a_thickness,                    a_inner.position.y() - a_thickness,
-          a_inner.position.x() + a_inner.size.x() + a_thickness, a_inner.position.y() - a_thickness,
-          a_inner.position.x() + a_inner.size.x() + a_thickness, a_inner.position.y() + a_inner.size.y() + a_thickness,
-          a_inner.position.x() - a_thickness,                    a_inner.position.y() + a_inner.size.y() + a_thickness,
-        };
-
-        float clr[4] ={a_colour.fr(), a_colour.fg(), a_colour.fb(), a_colour.fa()};
-
-        s_pRenderContext->vb_boxBorder->SetData(verts, sizeof(float) * 16, 0);
-
-        s_pRenderContext->materialBoxBorder->SetUniform("colour", clr, sizeof(clr));
-
-        s_pRenderContext->materialBoxBorder->Bind();
-        s_pRenderContext->va_boxBorder->Bind();
-
-        ::Engine::Renderer::DrawIndexed(s_pRenderContext->va_boxBorder, RenderMode::Triangles, 1);
+        float x = a_inner.position.x();
+        float y = a_inner.position.y();
+        float w = a_inner.size.x();
+        float h = a_inner.size.y();
+        float t = a_thickness;
+
+        AddBox(x - t, y - t, w + 2.0f * t, t, a_colour); // Top
+        AddBox(x - t, y + h, w + 2.0f * t, t, a_colour); // Bottom
+        AddBox(x - t, y,     t,            h, a_colour); // Left
+        AddBox(x + w, y,     t,            h, a_colour); // Right
       }
 
       void DrawBoxWithOutline(UIAABB const & inner, float thickness, Colour clrInner, Colour clrOutline)
@@ -301,21 +319,56 @@ namespace Engine
         if (a_count == 0 || a_pVerts == nullptr)
           return;
 
-        float clr[4] ={a_colour.fr(), a_colour.fg(), a_colour.fb(), a_colour.fa()};
+        float const * pVerts = static_cast<float const *>(a_pVerts);
+        for (uint32_t i = 0; i < a_count; i++, pVerts += 8)
+        {
+          Instance * pInstance = AddInstance(a_colour, a_textureID);
+          pInstance->rect[0] = pVerts[0];
+          pInstance->rect[1] = pVerts[1];
+          pInstance->rect[2] = pVerts[4];
+          pInstance->rect[3] = pVerts[5];
+          pInstance->texRect[0] = pVerts[2];
+          pInstance->texRect[1] = pVerts[3];
+          pInstance->texRect[2] = pVerts[6];
+          pInstance->texRect[3] = pVerts[7];
+          pInstance->textured = 1.0f;
+        }
+      }
 
-        Ref<Texture2D> texture;
-        if (s_pRenderContext->fontAtlas->GetTexture(a_textureID, texture) != Dg::ErrorCode::None)
+      void Flush()
+      {
+        if (s_pRenderContext->instanceCount == 0)
           return;
 
-        s_pRenderContext->vb_textInstance->SetData(a_pVerts, a_count * sizeof(float) * 6, 0);
-
-        s_pRenderContext->materialText->SetUniform("textColour", clr, sizeof(clr));
-        s_pRenderContext->materialText->SetTexture("textureAtlas", texture);
-
-        s_pRenderContext->materialText->Bind();
-        s_pRenderContext->va_text->Bind();
+        uint32_t baseInstance = 0;
+        if (s_pRenderContext->vb_instances->Write(s_pRenderContext->pInstances,
+                                                  s_pRenderContext->instanceCount * sizeof(Instance),
+                                                  sizeof(Instance), baseInstance))
+        {
+          for (size_t i = 0; i < s_pRenderContext->batches.size(); i++)
+          {
+            Batch const & batch = s_pRenderContext->batches[i];
+            Ref<Texture2D> texture;
+            if (batch.textureID != INVALID_FONT_TEXTURE
+              && s_pRenderContext->fontAtlas->GetTexture(batch.textureID, texture) == Dg::ErrorCode::None)
+              s_pRenderContext->material->SetTexture("textureAtlas", texture);
+
+            // Every batch has the same key, and the sort is stable, so batches are still drawn
+            // in the order they were added
+            RenderState state = RenderState::Create();
+            state.Set<RenderState::Attr::System>(RenderState::System::HUD);
+
+            ::Engine::Renderer::DrawIndexed(state, s_pRenderContext->va, s_pRenderContext->material, RenderMode::Triangles,
+                                            batch.count, 0, 0, baseInstance + batch.first);
+          }
+        }
+        else
+        {
+          LOG_WARN("GUI::Renderer::Flush(): Too many GUI instances this frame!");
+        }
 
-        ::Engine::Renderer::DrawIndexed(s_pRenderContext->va_text, RenderMode::Triangles, a_count);
+        s_pRenderContext->instanceCount = 0;
+        s_pRenderContext->batches.clear();
       }
 
       GlyphData * GetGlyphData(CodePoint a_cp, uint32_t a_size)
@@ -323,6 +376,16 @@ namespace Engine
         return s_pRenderContext->fontAtlas->GetGlyphData(s_pRenderContext->defaultFont, a_cp, a_size);
       }
 
+      void UpdateFontAtlas()
+      {
+        s_pRenderContext->fontAtlas->Update();
+      }
+
+      uint32_t GetFontAtlasVersion()
+      {
+        return s_pRenderContext->fontAtlas->GetVersion();
+      }
+
       void GetCharacterSizeRange(uint32_t a_size, int16_t & a_ascent, int16_t & a_descent)
       {
         a_ascent = 0;
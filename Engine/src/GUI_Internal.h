@@ -17,13 +17,25 @@ namespace Engine
 
       void GetCharacterSizeRange(uint32_t size, int16_t & ascent, int16_t & descent);
 
-      // Get the glyph data for the default font and size
+      // Get the glyph data for the default font and size. Can be nullptr while the glyph loads.
       GlyphData * GetGlyphData(CodePoint, uint32_t size);
+
+      // Call once a frame before drawing. Text laid out against an older 
+      // font atlas version needs to be laid out again.
+      void UpdateFontAtlas();
+      uint32_t GetFontAtlasVersion();
       void SetScreenSize(vec2 const &);
+
+      // Draw calls are batched, and only submitted to the renderer on Flush(). Everything
+      // drawn is clipped to the current clip rect.
+      void SetClipRect(UIAABB const &);
       void DrawBox(UIAABB const &, Colour colour);
       void DrawBoxOutline(UIAABB const & inner, float thickness, Colour colour);
       void DrawBoxWithOutline(UIAABB const & inner, float thickness, Colour clrInner, Colour clrOutline);
+      // pVerts: [x, y, tx, ty, sizex, sizey, tsizex, tsizey] per glyph. Positions and sizes are
+      // in pixels, and texture coordinates and sizes in texels.
       void DrawText(uint16_t textureID, Colour colour, uint32_t count, void * pVerts);
+      void Flush();
     }
 
     bool Intersection(UIAABB const & A, UIAABB const & B,  UIAABB & out);
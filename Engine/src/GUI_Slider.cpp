@@ -180,7 +180,7 @@ namespace Engine
       if (!m_pData->pSlider->GetGlobalAABB(viewableWindow))
         return;
 
-      ::Engine::Renderer::SetSissorBox((int)viewableWindow.position.x(), (int)viewableWindow.position.y(), (int)viewableWindow.size.x(), (int)viewableWindow.size.y());
+      Renderer::SetClipRect(viewableWindow);
 
       UIAABB lower, upper, caret;
       GetInnerAABBs(lower, upper, caret);
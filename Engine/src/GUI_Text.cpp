@@ -29,7 +29,6 @@ namespace Engine
     {
       // Constants...
       UIAABB div;
-      UIAABB divViewable;
       HorizontalAlignment horizontalAlign;
       VerticalAlignment verticalAlign;
       int16_t lineSpacing;
@@ -57,10 +56,9 @@ namespace Engine
       GlyphData data;
     };
 
-    // Global buffers to avoid excessive memory allocating to render text
-    // TODO This still requires copying to render memory. Perhaps we can write directly to a chunk of Render memory.
-    // [x, y, tx, ty, sizex, sizey], ...
-    static float s_textVertexBuffer[MAX_TEXT_CHARACTERS * 6] = {};
+    // Global buffers to avoid excessive memory allocating when laying out text.
+    // [x, y, tx, ty, sizex, sizey, tsizex, tsizey], ...
+    static float s_textVertexBuffer[MAX_TEXT_CHARACTERS * 8] = {};
     static CPData s_glyphData[MAX_TEXT_CHARACTERS] = {};
     static uint16_t s_textureIDs[MAX_TEXTURES] = {};
 
@@ -153,7 +151,7 @@ namespace Engine
         float x = float(context.posX + pData->bearingX) + offsetX;
         float y = float(context.lineY - pData->bearingY);
 
-        uint32_t ind = context.writtenCPs * 6;
+        uint32_t ind = context.writtenCPs * 8;
 
         s_textVertexBuffer[ind + 0] = x;
         s_textVertexBuffer[ind + 1] = y;
@@ -161,6 +159,8 @@ namespace Engine
         s_textVertexBuffer[ind + 3] = pData->posY;
         s_textVertexBuffer[ind + 4] = pData->width;
         s_textVertexBuffer[ind + 5] = pData->height;
+        s_textVertexBuffer[ind + 6] = pData->texWidth;
+        s_textVertexBuffer[ind + 7] = pData->texHeight;
 
         context.writtenCPs++;
       }
@@ -170,7 +170,7 @@ namespace Engine
     static void AdjustY(TextContext const & context, float offsetY)
     {
       for (uint32_t i = 0; i < context.writtenCPs; i++)
-        s_textVertexBuffer[i * 6 + 1] += offsetY;
+        s_textVertexBuffer[i * 8 + 1] += offsetY;
     }
 
     static void WriteBlock(TextContext & context, float offsetX)
@@ -518,7 +518,10 @@ namespace Engine
             GlyphData * pData = Renderer::GetGlyphData(cp, a_size);
             if (pData == nullptr)
               pData = Renderer::GetGlyphData(uint32_t('?'), a_size);
-            BSR_ASSERT(pData != nullptr, "Default font atlas missing '?' character");
+
+            // Both may still be loading
+            if (pData == nullptr)
+              continue;
             s_glyphData[count].cp = cp;
             s_glyphData[count].data = *pData;
             if (pData->textureID != INVALID_FONT_TEXTURE)
@@ -542,6 +545,9 @@ namespace Engine
       , m_text(text)
       , m_attributes{}
       , m_aabb{position, size}
+      , m_layoutDiv{}
+      , m_layoutDirty(true)
+      , m_layoutVersion(0)
     {
       if (pAttrs != nullptr)
       {
@@ -570,7 +576,10 @@ namespace Engine
 
     void Text::SetText(std::string const & a_str)
     {
+      if (m_text == a_str)
+        return;
       m_text = a_str;
+      m_layoutDirty = true;
     }
 
     void Text::SetColour(Colour a_clr)
@@ -578,27 +587,23 @@ namespace Engine
       m_attributes.colourText = a_clr;
     }
 
-    void Text::Draw()
+    void Text::Layout(UIAABB const & a_div)
     {
-      UIAABB viewableWindow;
-      if (!GetGlobalAABB(viewableWindow))
-        return;
-
       uint32_t textureCount;
 
       TextContext context;
-      context.div = {GetGlobalPosition(), GetSize()};
+      context.div = a_div;
       Renderer::GetCharacterSizeRange(m_attributes.size, context.ascent, context.descent);
 
       context.wrap = m_attributes.wrapText;
-      context.divViewable = viewableWindow;
       context.horizontalAlign = m_attributes.horizontalAlign;
       context.verticalAlign = m_attributes.verticalAlign;
       context.lineSpacing = int16_t(m_attributes.lineSpacing * (context.ascent - context.descent));
       context.cpCount = DecodeText(m_text, textureCount, m_attributes.size);
-      
-      ::Engine::Renderer::SetSissorBox((int)viewableWindow.position.x(), (int)viewableWindow.position.y(), (int)viewableWindow.size.x(), (int)viewableWindow.size.y());
-      
+
+      m_glyphVerts.clear();
+      m_glyphRuns.clear();
+
       for (uint32_t i = 0; i < textureCount; i++)
       {
         context.posX = int16_t(context.div.position.x());
@@ -606,14 +611,48 @@ namespace Engine
         context.currentTextureID = s_textureIDs[i];
 
         WriteText(context);
+        if (context.writtenCPs == 0)
+          continue;
 
-        Renderer::DrawText(context.currentTextureID, m_attributes.colourText, context.writtenCPs, s_textVertexBuffer);
+        uint32_t first = uint32_t(m_glyphVerts.size()) / 8;
+        for (uint32_t j = 0; j < context.writtenCPs * 8; j++)
+          m_glyphVerts.push_back(s_textVertexBuffer[j]);
+        m_glyphRuns.push_back({context.currentTextureID, first, context.writtenCPs});
+      }
+
+      m_layoutDiv = a_div;
+      m_layoutDirty = false;
+      m_layoutVersion = Renderer::GetFontAtlasVersion();
+    }
+
+    void Text::Draw()
+    {
+      UIAABB viewableWindow;
+      if (!GetGlobalAABB(viewableWindow))
+        return;
+
+      UIAABB div = {GetGlobalPosition(), GetSize()};
+      if (m_layoutDirty 
+        || m_layoutVersion != Renderer::GetFontAtlasVersion()
+        || div.position != m_layoutDiv.position 
+        || div.size != m_layoutDiv.size)
+        Layout(div);
+
+      Renderer::SetClipRect(viewableWindow);
+
+      for (size_t i = 0; i < m_glyphRuns.size(); i++)
+      {
+        GlyphRun const & run = m_glyphRuns[i];
+        Renderer::DrawText(run.textureID, m_attributes.colourText, run.count, &m_glyphVerts[run.first * 8]);
       }
     }
     
     void Text::SetGlyphSize(uint32_t a_size)
     {
+      if (m_attributes.size == a_size)
+        return;
       m_attributes.size = a_size;
+      m_layoutDirty = true;
     }
 
     WidgetState Text::QueryState() const
@@ -633,7 +672,10 @@ namespace Engine
 
     void Text::SetWrap(bool a_val)
     {
+      if (m_attributes.wrapText == a_val)
+        return;
       m_attributes.wrapText = a_val;
+      m_layoutDirty = true;
     }
 
     void Text::_HandleMessage(Message * a_pMsg)
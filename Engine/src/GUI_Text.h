@@ -5,6 +5,7 @@
 
 #include "Utils.h"
 #include "GUI_Widget.h"
+#include "DgDynamicArray.h"
 
 namespace Engine
 {
@@ -66,12 +67,31 @@ namespace Engine
       vec2 _GetLocalPosition() override;
       vec2 _GetSize() override;
 
+      // Decode the text and lay out the glyphs within 'div'
+      void Layout(UIAABB const & div);
+
     private:
 
+      // Glyphs from the same atlas texture are drawn together
+      struct GlyphRun
+      {
+        uint16_t textureID;
+        uint32_t first;
+        uint32_t count;
+      };
+
       Widget * m_pParent;
       std::string m_text;
       TextAttributes m_attributes;
       UIAABB m_aabb;
+
+      // The last layout, [x, y, tx, ty, sizex, sizey, tsizex, tsizey] per glyph. Rebuilt if the text
+      // or its attributes change, the widget moves or is resized, or the font atlas changes.
+      Dg::DynamicArray<float> m_glyphVerts;
+      Dg::DynamicArray<GlyphRun> m_glyphRuns;
+      UIAABB m_layoutDiv;
+      bool m_layoutDirty;
+      uint32_t m_layoutVersion;
     };
   }
 }
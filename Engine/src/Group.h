@@ -13,7 +13,7 @@ namespace Engine
   public:
 
     typedef uint16_t IDType;
-    IDType const NONE = 0;
+    static IDType const NONE = 0;
 
     Group();
 
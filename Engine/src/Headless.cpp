@@ -0,0 +1,550 @@
+//@group Framework
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "glad/glad.h"
+#include "DgOpenHashMap.h"
+
+#include "Framework.h"
+#include "Headless.h"
+#include "Log.h"
+#include "Memory.h"
+#include "Message.h"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace Engine
+{
+  //-----------------------------------------------------------------------------------------------
+  // Stub OpenGL
+  //-----------------------------------------------------------------------------------------------
+  // Handed to glad in place of a real driver. Each GL function the engine calls has a stub
+  // with its real signature. Queries return the values a typical GL 4.6 driver would, and
+  // objects get IDs, but nothing is drawn. Any other function is missing, as it would be
+  // from a driver without it. All GL calls are made on the render thread.
+  namespace impl
+  {
+    namespace HeadlessGL
+    {
+      static std::atomic<uint64_t> calls(0);
+      static std::atomic<uint64_t> drawCalls(0);
+      static GLuint nextID = 1;
+      static GLenum error = GL_NO_ERROR;
+      static Dg::OpenHashMap<GLuint, std::vector<byte>> buffers;
+
+      static void Count()
+      {
+        calls.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      // As GL, only the first error is kept until it is read
+      static void SetError(GLenum a_error)
+      {
+        if (error == GL_NO_ERROR)
+          error = a_error;
+      }
+
+      // Functions with no visible effect
+#define HEADLESS_NO_OP(name, params) static void APIENTRY name params { Count(); }
+
+      HEADLESS_NO_OP(AttachShader,            (GLuint, GLuint))
+      HEADLESS_NO_OP(BeginQuery,              (GLenum, GLuint))
+      HEADLESS_NO_OP(BindBuffer,              (GLenum, GLuint))
+      HEADLESS_NO_OP(BindBufferBase,          (GLenum, GLuint, GLuint))
+      HEADLESS_NO_OP(BindBufferRange,         (GLenum, GLuint, GLuint, GLintptr, GLsizeiptr))
+      HEADLESS_NO_OP(BindTexture,             (GLenum, GLuint))
+      HEADLESS_NO_OP(BindTextureUnit,         (GLuint, GLuint))
+      HEADLESS_NO_OP(BindVertexArray,         (GLuint))
+      HEADLESS_NO_OP(BlendFunc,               (GLenum, GLenum))
+      HEADLESS_NO_OP(Clear,                   (GLbitfield))
+      HEADLESS_NO_OP(ClearColor,              (GLfloat, GLfloat, GLfloat, GLfloat))
+      HEADLESS_NO_OP(CompileShader,           (GLuint))
+      HEADLESS_NO_OP(DebugMessageCallback,    (GLDEBUGPROC, void const *))
+      HEADLESS_NO_OP(DeleteObject,            (GLuint))
+      HEADLESS_NO_OP(DeleteObjects,           (GLsizei, GLuint const *))
+      HEADLESS_NO_OP(DeleteSync,              (GLsync))
+      HEADLESS_NO_OP(DetachShader,            (GLuint, GLuint))
+      HEADLESS_NO_OP(EnableOrDisable,         (GLenum))
+      HEADLESS_NO_OP(EnableVertexAttribArray, (GLuint))
+      HEADLESS_NO_OP(EndQuery,                (GLenum))
+      HEADLESS_NO_OP(FrontFace,               (GLenum))
+      HEADLESS_NO_OP(GenerateMipmap,          (GLenum))
+      HEADLESS_NO_OP(GenerateTextureMipmap,   (GLuint))
+      HEADLESS_NO_OP(LinkProgram,             (GLuint))
+      HEADLESS_NO_OP(PixelStorei,             (GLenum, GLint))
+      HEADLESS_NO_OP(ProgramBinary,           (GLuint, GLenum, void const *, GLsizei))
+      HEADLESS_NO_OP(ProgramParameteri,       (GLuint, GLenum, GLint))
+      HEADLESS_NO_OP(ScissorOrViewport,       (GLint, GLint, GLsizei, GLsizei))
+      HEADLESS_NO_OP(ShaderSource,            (GLuint, GLsizei, GLchar const * const *, GLint const *))
+      HEADLESS_NO_OP(TexImage2D,              (GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, void const *))
+      HEADLESS_NO_OP(TexParameteri,           (GLenum, GLenum, GLint))
+      HEADLESS_NO_OP(TextureParameterf,       (GLuint, GLenum, GLfloat))
+      HEADLESS_NO_OP(TextureSubImage2D,       (GLuint, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, void const *))
+      HEADLESS_NO_OP(Uniform1f,               (GLint, GLfloat))
+      HEADLESS_NO_OP(Uniform1i,               (GLint, GLint))
+      HEADLESS_NO_OP(Uniformfv,               (GLint, GLsizei, GLfloat const *))
+      HEADLESS_NO_OP(Uniformiv,               (GLint, GLsizei, GLint const *))
+      HEADLESS_NO_OP(UniformBlockBinding,     (GLuint, GLuint, GLuint))
+      HEADLESS_NO_OP(UseProgram,              (GLuint))
+      HEADLESS_NO_OP(VertexAttribDivisor,     (GLuint, GLuint))
+      HEADLESS_NO_OP(VertexAttribIPointer,    (GLuint, GLint, GLenum, GLsizei, void const *))
+      HEADLESS_NO_OP(VertexAttribPointer,     (GLuint, GLint, GLenum, GLboolean, GLsizei, void const *))
+
+#undef HEADLESS_NO_OP
+
+      static const GLubyte * APIENTRY GetString(GLenum a_name)
+      {
+        Count();
+        switch (a_name)
+        {
+          case GL_VENDOR:   return reinterpret_cast<GLubyte const *>("BSR");
+          case GL_RENDERER: return reinterpret_cast<GLubyte const *>("Headless");
+          case GL_VERSION:  return reinterpret_cast<GLubyte const *>("4.6.0 Headless");
+          case GL_SHADING_LANGUAGE_VERSION: return reinterpret_cast<GLubyte const *>("4.60");
+        }
+        SetError(GL_INVALID_ENUM);
+        return nullptr;
+      }
+
+      // glad fails to load if there are no extensions
+      static const GLubyte * APIENTRY GetStringi(GLenum a_name, GLuint a_index)
+      {
+        Count();
+        if (a_name != GL_EXTENSIONS)
+        {
+          SetError(GL_INVALID_ENUM);
+          return nullptr;
+        }
+        if (a_index != 0)
+        {
+          SetError(GL_INVALID_VALUE);
+          return nullptr;
+        }
+        return reinterpret_cast<GLubyte const *>("GL_BSR_headless");
+      }
+
+      static void APIENTRY GetIntegerv(GLenum a_name, GLint * a_pData)
+      {
+        Count();
+        switch (a_name)
+        {
+          case GL_NUM_EXTENSIONS:                     *a_pData = 1; break;
+          case GL_MAJOR_VERSION:                      *a_pData = 4; break;
+          case GL_MINOR_VERSION:                      *a_pData = 6; break;
+          case GL_MAX_SAMPLES:                        *a_pData = 4; break;
+          case GL_MAX_TEXTURE_IMAGE_UNITS:            *a_pData = 16; break;
+          case GL_MAX_VERTEX_UNIFORM_BLOCKS:          *a_pData = 14; break;
+          case GL_MAX_GEOMETRY_UNIFORM_BLOCKS:        *a_pData = 14; break;
+          case GL_MAX_FRAGMENT_UNIFORM_BLOCKS:        *a_pData = 14; break;
+          case GL_MAX_UNIFORM_BLOCK_SIZE:             *a_pData = 65536; break;
+          case GL_MAX_UNIFORM_BUFFER_BINDINGS:        *a_pData = 84; break;
+          case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:    *a_pData = 256; break;
+          case GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS:   *a_pData = 16; break;
+          case GL_MAX_GEOMETRY_SHADER_STORAGE_BLOCKS: *a_pData = 16; break;
+          case GL_MAX_FRAGMENT_SHADER_STORAGE_BLOCKS: *a_pData = 16; break;
+          case GL_MAX_SHADER_STORAGE_BLOCK_SIZE:      *a_pData = 1 << 27; break;
+          case GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS: *a_pData = 16; break;
+          case GL_NUM_PROGRAM_BINARY_FORMATS:         *a_pData = 0; break; // No program cache
+          default:                                    SetError(GL_INVALID_ENUM);
+        }
+      }
+
+      static void APIENTRY GetFloatv(GLenum a_name, GLfloat * a_pData)
+      {
+        Count();
+        if (a_name == GL_MAX_TEXTURE_MAX_ANISOTROPY)
+          *a_pData = 16.0f;
+        else
+          SetError(GL_INVALID_ENUM);
+      }
+
+      static GLenum APIENTRY GetError()
+      {
+        Count();
+        GLenum result = error;
+        error = GL_NO_ERROR;
+        return result;
+      }
+
+      static void APIENTRY GenObjects(GLsizei a_count, GLuint * a_pIDs)
+      {
+        Count();
+        for (GLsizei i = 0; i < a_count; i++)
+          a_pIDs[i] = nextID++;
+      }
+
+      static void APIENTRY CreateTextures(GLenum, GLsizei a_count, GLuint * a_pIDs)
+      {
+        GenObjects(a_count, a_pIDs);
+      }
+
+      static GLuint APIENTRY CreateShader(GLenum)
+      {
+        Count();
+        return nextID++;
+      }
+
+      static GLuint APIENTRY CreateProgram()
+      {
+        Count();
+        return nextID++;
+      }
+
+      // Compiling and linking always succeed, straight away
+      static void APIENTRY GetShaderOrProgramiv(GLuint, GLenum a_name, GLint * a_pParams)
+      {
+        Count();
+        switch (a_name)
+        {
+          case GL_COMPILE_STATUS:
+          case GL_LINK_STATUS:
+          case GL_COMPLETION_STATUS_KHR:  *a_pParams = GL_TRUE; break;
+          case GL_INFO_LOG_LENGTH:
+          case GL_PROGRAM_BINARY_LENGTH:  *a_pParams = 0; break;
+          default:                        SetError(GL_INVALID_ENUM);
+        }
+      }
+
+      static void APIENTRY GetInfoLog(GLuint, GLsizei a_bufSize, GLsizei * a_pLength, GLchar * a_pLog)
+      {
+        Count();
+        if (a_pLength != nullptr)
+          *a_pLength = 0;
+        if (a_bufSize > 0)
+          a_pLog[0] = 0;
+      }
+
+      static void APIENTRY GetProgramBinary(GLuint, GLsizei, GLsizei * a_pLength, GLenum *, void *)
+      {
+        Count();
+        if (a_pLength != nullptr)
+          *a_pLength = 0;
+      }
+
+      static GLint APIENTRY GetUniformLocation(GLuint, GLchar const *)
+      {
+        Count();
+        return 0;
+      }
+
+      static GLuint APIENTRY GetUniformBlockIndex(GLuint, GLchar const *)
+      {
+        Count();
+        return 0;
+      }
+
+      static GLsync APIENTRY FenceSync(GLenum, GLbitfield)
+      {
+        Count();
+        return reinterpret_cast<GLsync>(uintptr_t(1));
+      }
+
+      static GLenum APIENTRY ClientWaitSync(GLsync, GLbitfield, GLuint64)
+      {
+        Count();
+        return GL_ALREADY_SIGNALED;
+      }
+
+      // Results are always available, and timers read 0
+      static void APIENTRY GetQueryObjectiv(GLuint, GLenum a_name, GLint * a_pParams)
+      {
+        Count();
+        *a_pParams = a_name == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+      }
+
+      static void APIENTRY GetQueryObjectui64v(GLuint, GLenum, GLuint64 * a_pParams)
+      {
+        Count();
+        *a_pParams = 0;
+      }
+
+      // Buffers get real storage, as they may be mapped
+      static void APIENTRY NamedBufferData(GLuint a_id, GLsizeiptr a_size, void const * a_pData, GLenum)
+      {
+        Count();
+        std::vector<byte> * pBuffer = buffers.at(a_id);
+        if (pBuffer == nullptr)
+        {
+          buffers.insert(a_id, std::vector<byte>());
+          pBuffer = buffers.at(a_id);
+        }
+        pBuffer->resize(static_cast<size_t>(a_size));
+        if (a_pData != nullptr)
+          memcpy(pBuffer->data(), a_pData, static_cast<size_t>(a_size));
+      }
+
+      static void APIENTRY NamedBufferStorage(GLuint a_id, GLsizeiptr a_size, void const * a_pData, GLbitfield)
+      {
+        NamedBufferData(a_id, a_size, a_pData, 0);
+      }
+
+      static void APIENTRY NamedBufferSubData(GLuint a_id, GLintptr a_offset, GLsizeiptr a_size, void const * a_pData)
+      {
+        Count();
+        std::vector<byte> * pBuffer = buffers.at(a_id);
+        if (pBuffer == nullptr || a_offset < 0 || a_size < 0 || static_cast<size_t>(a_offset + a_size) > pBuffer->size())
+        {
+          SetError(GL_INVALID_VALUE);
+          return;
+        }
+        memcpy(pBuffer->data() + a_offset, a_pData, static_cast<size_t>(a_size));
+      }
+
+      static void * APIENTRY MapNamedBufferRange(GLuint a_id, GLintptr a_offset, GLsizeiptr, GLbitfield)
+      {
+        Count();
+        std::vector<byte> * pBuffer = buffers.at(a_id);
+        return pBuffer == nullptr ? nullptr : pBuffer->data() + a_offset;
+      }
+
+      static GLboolean APIENTRY UnmapNamedBuffer(GLuint)
+      {
+        Count();
+        return GL_TRUE;
+      }
+
+      static void APIENTRY DeleteBuffers(GLsizei a_count, GLuint const * a_pIDs)
+      {
+        Count();
+        for (GLsizei i = 0; i < a_count; i++)
+          buffers.erase(a_pIDs[i]);
+      }
+
+      static void APIENTRY DrawElements(GLenum, GLsizei, GLenum, void const *)
+      {
+        Count();
+        drawCalls.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      static void APIENTRY DrawElementsInstanced(GLenum, GLsizei, GLenum, void const *, GLsizei)
+      {
+        DrawElements(0, 0, 0, nullptr);
+      }
+
+      static void APIENTRY DrawElementsInstancedBaseVertexBaseInstance(GLenum, GLsizei, GLenum, void const *, GLsizei, GLint, GLuint)
+      {
+        DrawElements(0, 0, 0, nullptr);
+      }
+
+      struct Entry
+      {
+        char const *  name;
+        void *        pFn;
+      };
+
+      static Entry const s_entries[] =
+      {
+        {"glAttachShader",            (void *)&AttachShader},
+        {"glBeginQuery",              (void *)&BeginQuery},
+        {"glBindBuffer",              (void *)&BindBuffer},
+        {"glBindBufferBase",          (void *)&BindBufferBase},
+        {"glBindBufferRange",         (void *)&BindBufferRange},
+        {"glBindTexture",             (void *)&BindTexture},
+        {"glBindTextureUnit",         (void *)&BindTextureUnit},
+        {"glBindVertexArray",         (void *)&BindVertexArray},
+        {"glBlendFunc",               (void *)&BlendFunc},
+        {"glClear",                   (void *)&Clear},
+        {"glClearColor",              (void *)&ClearColor},
+        {"glClientWaitSync",          (void *)&ClientWaitSync},
+        {"glCompileShader",           (void *)&CompileShader},
+        {"glCreateBuffers",           (void *)&GenObjects},
+        {"glCreateProgram",           (void *)&CreateProgram},
+        {"glCreateShader",            (void *)&CreateShader},
+        {"glCreateTextures",          (void *)&CreateTextures},
+        {"glCreateVertexArrays",      (void *)&GenObjects},
+        {"glDebugMessageCallback",    (void *)&DebugMessageCallback},
+        {"glDeleteBuffers",           (void *)&DeleteBuffers},
+        {"glDeleteProgram",           (void *)&DeleteObject},
+        {"glDeleteQueries",           (void *)&DeleteObjects},
+        {"glDeleteShader",            (void *)&DeleteObject},
+        {"glDeleteSync",              (void *)&DeleteSync},
+        {"glDeleteTextures",          (void *)&DeleteObjects},
+        {"glDeleteVertexArrays",      (void *)&DeleteObjects},
+        {"glDetachShader",            (void *)&DetachShader},
+        {"glDisable",                 (void *)&EnableOrDisable},
+        {"glDrawElements",            (void *)&DrawElements},
+        {"glDrawElementsInstanced",   (void *)&DrawElementsInstanced},
+        {"glDrawElementsInstancedBaseVertexBaseInstance", (void *)&DrawElementsInstancedBaseVertexBaseInstance},
+        {"glEnable",                  (void *)&EnableOrDisable},
+        {"glEnableVertexAttribArray", (void *)&EnableVertexAttribArray},
+        {"glEndQuery",                (void *)&EndQuery},
+        {"glFenceSync",               (void *)&FenceSync},
+        {"glFrontFace",               (void *)&FrontFace},
+        {"glGenQueries",              (void *)&GenObjects},
+        {"glGenVertexArrays",         (void *)&GenObjects},
+        {"glGenerateMipmap",          (void *)&GenerateMipmap},
+        {"glGenerateTextureMipmap",   (void *)&GenerateTextureMipmap},
+        {"glGetError",                (void *)&GetError},
+        {"glGetFloatv",               (void *)&GetFloatv},
+        {"glGetIntegerv",             (void *)&GetIntegerv},
+        {"glGetProgramBinary",        (void *)&GetProgramBinary},
+        {"glGetProgramInfoLog",       (void *)&GetInfoLog},
+        {"glGetProgramiv",            (void *)&GetShaderOrProgramiv},
+        {"glGetQueryObjectiv",        (void *)&GetQueryObjectiv},
+        {"glGetQueryObjectui64v",     (void *)&GetQueryObjectui64v},
+        {"glGetShaderInfoLog",        (void *)&GetInfoLog},
+        {"glGetShaderiv",             (void *)&GetShaderOrProgramiv},
+        {"glGetString",               (void *)&GetString},
+        {"glGetStringi",              (void *)&GetStringi},
+        {"glGetUniformBlockIndex",    (void *)&GetUniformBlockIndex},
+        {"glGetUniformLocation",      (void *)&GetUniformLocation},
+        {"glLinkProgram",             (void *)&LinkProgram},
+        {"glMapNamedBufferRange",     (void *)&MapNamedBufferRange},
+        {"glNamedBufferData",         (void *)&NamedBufferData},
+        {"glNamedBufferStorage",      (void *)&NamedBufferStorage},
+        {"glNamedBufferSubData",      (void *)&NamedBufferSubData},
+        {"glPixelStorei",             (void *)&PixelStorei},
+        {"glProgramBinary",           (void *)&ProgramBinary},
+        {"glProgramParameteri",       (void *)&ProgramParameteri},
+        {"glScissor",                 (void *)&ScissorOrViewport},
+        {"glShaderSource",            (void *)&ShaderSource},
+        {"glTexImage2D",              (void *)&TexImage2D},
+        {"glTexParameteri",           (void *)&TexParameteri},
+        {"glTextureParameterf",       (void *)&TextureParameterf},
+        {"glTextureSubImage2D",       (void *)&TextureSubImage2D},
+        {"glUniform1f",               (void *)&Uniform1f},
+        {"glUniform1fv",              (void *)&Uniformfv},
+        {"glUniform1i",               (void *)&Uniform1i},
+        {"glUniform1iv",              (void *)&Uniformiv},
+        {"glUniform2fv",              (void *)&Uniformfv},
+        {"glUniform4fv",              (void *)&Uniformfv},
+        {"glUniformBlockBinding",     (void *)&UniformBlockBinding},
+        {"glUnmapNamedBuffer",        (void *)&UnmapNamedBuffer},
+        {"glUseProgram",              (void *)&UseProgram},
+        {"glVertexAttribDivisor",     (void *)&VertexAttribDivisor},
+        {"glVertexAttribIPointer",    (void *)&VertexAttribIPointer},
+        {"glVertexAttribPointer",     (void *)&VertexAttribPointer},
+        {"glViewport",                (void *)&ScissorOrViewport},
+      };
+
+      // Names the engine does not call are not stubbed, and are left null, as glad does for
+      // functions a driver lacks
+      static void * GetProcAddress(char const * a_name)
+      {
+        for (Entry const & entry : s_entries)
+        {
+          if (strcmp(entry.name, a_name) == 0)
+            return entry.pFn;
+        }
+        return nullptr;
+      }
+    }
+  }
+
+  HeadlessGLStats GetHeadlessGLStats()
+  {
+    HeadlessGLStats stats;
+    stats.calls = impl::HeadlessGL::calls.load(std::memory_order_relaxed);
+    stats.drawCalls = impl::HeadlessGL::drawCalls.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  //-----------------------------------------------------------------------------------------------
+  // Framework modules
+  //-----------------------------------------------------------------------------------------------
+  class FW_HeadlessContext : public IGraphicsContext
+  {
+  public:
+
+    Dg::ErrorCode Init() override
+    {
+      if (gladLoadGLLoader(impl::HeadlessGL::GetProcAddress) == 0)
+      {
+        LOG_ERROR("Glad failed to load the headless GL functions");
+        return Dg::ErrorCode::Failure;
+      }
+      impl::HeadlessGL::calls.store(0);
+      impl::HeadlessGL::drawCalls.store(0);
+      return Dg::ErrorCode::None;
+    }
+
+    Dg::ErrorCode ShutDown() override
+    {
+      impl::HeadlessGL::buffers.clear();
+      return Dg::ErrorCode::None;
+    }
+
+    void SwapBuffers() override {}
+    void Resize(uint32_t, uint32_t) override {}
+
+    void * GetProcAddress(char const * a_name) override
+    {
+      return impl::HeadlessGL::GetProcAddress(a_name);
+    }
+  };
+
+  class FW_HeadlessWindow : public IWindow
+  {
+  public:
+
+    FW_HeadlessWindow()
+      : m_isInit(false)
+      , m_vsync(false)
+      , m_width(0)
+      , m_height(0)
+    {
+
+    }
+
+    void Update() override {}
+    void SwapBuffers() override {}
+    void SetVSync(bool a_val) override { m_vsync = a_val; }
+    bool IsVSync() const override { return m_vsync; }
+
+    bool IsInit() const override { return m_isInit; }
+
+    Dg::ErrorCode Init(WindowProps const & a_props) override
+    {
+      m_width = a_props.width;
+      m_height = a_props.height;
+      m_isInit = true;
+      return Dg::ErrorCode::None;
+    }
+
+    void Destroy() override { m_isInit = false; }
+
+    void GetDimensions(int & a_w, int & a_h) override
+    {
+      a_w = static_cast<int>(m_width);
+      a_h = static_cast<int>(m_height);
+    }
+
+  private:
+
+    bool      m_isInit;
+    bool      m_vsync;
+    unsigned  m_width;
+    unsigned  m_height;
+  };
+
+  class FW_HeadlessEventPoller : public IEventPoller
+  {
+  public:
+
+    TRef<Message> NextEvent() override { return TRef<Message>(); }
+  };
+
+  class FW_HeadlessMouseController : public IMouseController
+  {
+  public:
+
+    Dg::ErrorCode Grab() override { return Dg::ErrorCode::None; }
+    Dg::ErrorCode Release() override { return Dg::ErrorCode::None; }
+
+    void GetPos(int & a_x, int & a_y) override { a_x = 0; a_y = 0; }
+    void MoveToPos(int, int) override {}
+  };
+
+  Dg::ErrorCode Framework::InitHeadless()
+  {
+    SetWindow(new FW_HeadlessWindow());
+    SetEventPoller(new FW_HeadlessEventPoller());
+    SetMouseController(new FW_HeadlessMouseController());
+    SetGraphicsContext(new FW_HeadlessContext());
+    return Dg::ErrorCode::None;
+  }
+}
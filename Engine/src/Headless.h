@@ -0,0 +1,22 @@
+//@group Framework
+
+#ifndef EN_HEADLESS_H
+#define EN_HEADLESS_H
+
+#include <stdint.h>
+
+namespace Engine
+{
+  // The headless backend replaces the window, input and OpenGL context with stand-ins,
+  // so the engine can run without a display or GPU. GL calls are stubbed out and counted.
+  struct HeadlessGLStats
+  {
+    uint64_t calls;
+    uint64_t drawCalls;
+  };
+
+  // Totals since the headless context was initialised. Can be called from any thread.
+  HeadlessGLStats GetHeadlessGLStats();
+}
+
+#endif
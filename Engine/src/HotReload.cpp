@@ -0,0 +1,226 @@
+//@group Renderer
+
+#include <list>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+#include "HotReload.h"
+#include "Framework.h"
+#include "ShaderUniform.h"
+#include "Renderer.h"
+#include "RenderThreadData.h"
+#include "Log.h"
+
+namespace Engine
+{
+  namespace HotReload
+  {
+    namespace impl
+    {
+      struct ShaderEntry
+      {
+        ResourceID shaderDataID;
+
+        // Shader data from earlier reloads, which programs may still be built from
+        std::vector<ResourceID> reloadIDs;
+      };
+
+      struct ReloadedShaderData
+      {
+        ResourceID          id;
+        ShaderData const *  pData;
+      };
+
+      struct TextureEntry
+      {
+        std::weak_ptr<Texture2D>  texture;
+        TextureLoader             loader;
+        IFileWatcher::WatchID     watchID;
+      };
+
+      // Lists, so the entries handed to the file watcher do not move
+      static std::list<ShaderEntry> shaders;
+      static std::list<TextureEntry> textures;
+      static std::vector<IFileWatcher::WatchID> watchIDs;
+
+      // Reloaded shader data which no program is built from any more. Filled in by the
+      // render thread, and erased from the ResourceManager in Update().
+      static std::mutex retiredMutex;
+      static std::vector<ResourceID> retired;
+
+      static void OnShaderChanged(std::string const & a_path, void * a_pUserData)
+      {
+        ShaderEntry * pEntry = static_cast<ShaderEntry *>(a_pUserData);
+        ResourceManager * pRM = ResourceManager::Instance();
+
+        ShaderData * pData = pRM->GetResource<ShaderData>(pEntry->shaderDataID);
+        if (pData == nullptr)
+        {
+          LOG_WARN("HotReload: Shader data '{}' no longer exists", pEntry->shaderDataID);
+          return;
+        }
+
+        // Always reload from the original, it knows which sources came from files
+        ShaderData * pNewData = pData->CreateReloaded();
+        if (pNewData == nullptr)
+          return;
+
+        if (!pNewData->HasSameUniforms(*pData))
+        {
+          LOG_WARN("HotReload: The uniforms in '{}' have changed. Restart to pick up the change.", a_path);
+          delete pNewData;
+          return;
+        }
+
+        LOG_INFO("HotReload: Reloading '{}'", a_path);
+
+        // The new programs point at this, so hand it to the ResourceManager to own
+        ResourceID newID = pRM->NewInternalID();
+        pRM->RegisterResource(newID, pNewData);
+        pEntry->reloadIDs.push_back(newID);
+
+        RenderState state = RenderState::Create();
+        state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
+        state.Set<RenderState::Attr::Command>(RenderState::Command::RendererProgramReload);
+
+        RENDER_SUBMIT(state, [shaderDataID = pEntry->shaderDataID, pNewData = pNewData]()
+        {
+          RenderThreadData::Instance()->ReloadPrograms(shaderDataID, pNewData);
+        });
+
+        // Once the programs have been swapped, any reloaded data they were not rebuilt
+        // from can go. That is usually the previous reload, but programs which failed to
+        // compile keep theirs, and if all failed, the new data is not used either.
+        uint32_t count = (uint32_t)pEntry->reloadIDs.size();
+        ReloadedShaderData * pCandidates = static_cast<ReloadedShaderData *>(RENDER_ALLOCATE(count * sizeof(ReloadedShaderData)));
+        for (uint32_t i = 0; i < count; i++)
+        {
+          ResourceID id = pEntry->reloadIDs[i];
+          pCandidates[i] = ReloadedShaderData{id, pRM->GetResource<ShaderData>(id)};
+        }
+
+        RENDER_SUBMIT(state, [pCandidates = pCandidates, count = count]()
+        {
+          std::lock_guard<std::mutex> lock(retiredMutex);
+          for (uint32_t i = 0; i < count; i++)
+          {
+            if (!RenderThreadData::Instance()->UsesShaderData(pCandidates[i].pData))
+              retired.push_back(pCandidates[i].id);
+          }
+        });
+      }
+
+      static void OnTextureChanged(std::string const & a_path, void * a_pUserData)
+      {
+        TextureEntry * pEntry = static_cast<TextureEntry *>(a_pUserData);
+
+        Ref<Texture2D> texture = pEntry->texture.lock();
+        if (texture == nullptr)
+        {
+          Framework::Instance()->GetFileWatcher()->Unwatch(pEntry->watchID);
+          for (auto it = textures.begin(); it != textures.end(); it++)
+          {
+            if (&*it == pEntry)
+            {
+              textures.erase(it);
+              break;
+            }
+          }
+          return;
+        }
+
+        if (!pEntry->loader(a_path, *texture))
+        {
+          LOG_WARN("HotReload: Failed to load texture '{}'", a_path);
+          return;
+        }
+
+        LOG_INFO("HotReload: Reloading '{}'", a_path);
+
+        // Replaces the render thread texture in one command
+        texture->Upload();
+      }
+    }
+
+    Dg::ErrorCode WatchShader(ResourceID a_shaderDataID)
+    {
+      ShaderData * pData = ResourceManager::Instance()->GetResource<ShaderData>(a_shaderDataID);
+      if (pData == nullptr)
+        return Dg::ErrorCode::NullObject;
+
+      IFileWatcher * pWatcher = Framework::Instance()->GetFileWatcher();
+      impl::shaders.push_back(impl::ShaderEntry{a_shaderDataID, {}});
+      impl::ShaderEntry * pEntry = &impl::shaders.back();
+
+      std::vector<IFileWatcher::WatchID> ids;
+      for (int i = 0; i < ShaderDomain_COUNT; i++)
+      {
+        std::string const & path = pData->GetShaderSource().GetPath(ShaderDomain(i));
+        if (path.empty())
+          continue;
+
+        IFileWatcher::WatchID id;
+        Dg::ErrorCode result = pWatcher->Watch(path, impl::OnShaderChanged, pEntry, id);
+        if (result != Dg::ErrorCode::None)
+        {
+          LOG_WARN("HotReload: Failed to watch '{}'", path);
+          for (IFileWatcher::WatchID added : ids)
+            pWatcher->Unwatch(added);
+          impl::shaders.pop_back();
+          return result;
+        }
+        ids.push_back(id);
+      }
+
+      impl::watchIDs.insert(impl::watchIDs.end(), ids.begin(), ids.end());
+      return Dg::ErrorCode::None;
+    }
+
+    Dg::ErrorCode WatchTexture(Ref<Texture2D> const & a_texture, std::string const & a_path, TextureLoader a_loader)
+    {
+      if (a_texture == nullptr || a_loader == nullptr)
+        return Dg::ErrorCode::NullObject;
+
+      impl::textures.push_back(impl::TextureEntry{a_texture, a_loader, 0});
+      impl::TextureEntry * pEntry = &impl::textures.back();
+
+      Dg::ErrorCode result = Framework::Instance()->GetFileWatcher()->Watch(a_path, impl::OnTextureChanged, pEntry, pEntry->watchID);
+      if (result != Dg::ErrorCode::None)
+      {
+        LOG_WARN("HotReload: Failed to watch '{}'", a_path);
+        impl::textures.pop_back();
+      }
+      return result;
+    }
+
+    void Update()
+    {
+      {
+        std::lock_guard<std::mutex> lock(impl::retiredMutex);
+        for (ResourceID id : impl::retired)
+        {
+          ResourceManager::Instance()->Erase(id);
+          for (impl::ShaderEntry & entry : impl::shaders)
+            entry.reloadIDs.erase(std::remove(entry.reloadIDs.begin(), entry.reloadIDs.end(), id), entry.reloadIDs.end());
+        }
+        impl::retired.clear();
+      }
+
+      Framework::Instance()->GetFileWatcher()->Poll();
+    }
+
+    void Clear()
+    {
+      IFileWatcher * pWatcher = Framework::Instance()->GetFileWatcher();
+      for (size_t i = 0; i < impl::watchIDs.size(); i++)
+        pWatcher->Unwatch(impl::watchIDs[i]);
+      for (impl::TextureEntry const & entry : impl::textures)
+        pWatcher->Unwatch(entry.watchID);
+
+      impl::watchIDs.clear();
+      impl::shaders.clear();
+      impl::textures.clear();
+    }
+  }
+}
@@ -0,0 +1,42 @@
+//@group Renderer
+
+#ifndef HOTRELOAD_H
+#define HOTRELOAD_H
+
+#include <string>
+
+#include "DgError.h"
+#include "Memory.h"
+#include "ResourceManager.h"
+#include "Texture.h"
+
+namespace Engine
+{
+  // Reload shaders and textures when their files change on disk. Changes are picked up
+  // once a frame, see IFileWatcher. Main thread only.
+  namespace HotReload
+  {
+    // Fills the texture from the file, with Texture2D::Set(). Return false to keep the
+    // texture as it is.
+    typedef bool (*TextureLoader)(std::string const & path, Texture2D &);
+
+    // Rebuild every program made from this shader data when one of its source files
+    // changes. Only sources loaded with StrType::Path are watched. If the new source
+    // does not compile, the old program is kept. Changes which add, remove or reorder
+    // uniforms are ignored, as materials already hold buffers laid out for the old ones.
+    // The render thread waits for the new programs to compile, so expect a hitch.
+    Dg::ErrorCode WatchShader(ResourceID shaderDataID);
+
+    // Load and upload the texture again when the file changes. The texture is only
+    // weakly held, and the file stops being watched once it is destroyed.
+    Dg::ErrorCode WatchTexture(Ref<Texture2D> const &, std::string const & path, TextureLoader);
+
+    // Runs any reloads for files which have changed
+    void Update();
+
+    // Stop watching everything
+    void Clear();
+  }
+}
+
+#endif
@@ -0,0 +1,35 @@
+//@group Interface
+
+#ifndef IFILEWATCHER_H
+#define IFILEWATCHER_H
+
+#include <stdint.h>
+#include <string>
+
+#include "DgError.h"
+
+namespace Engine
+{
+  // Calls back when files are written. Main thread only.
+  class IFileWatcher
+  {
+  public:
+
+    typedef uint32_t WatchID;
+    typedef void (*Callback)(std::string const & path, void * pUserData);
+
+    virtual ~IFileWatcher() { }
+
+    // 'callback' is run from Poll() each time the file is written. Editors which save
+    // by replacing the file are also caught.
+    virtual Dg::ErrorCode Watch(std::string const & path, Callback callback, void * pUserData, WatchID & out) = 0;
+
+    // Can be called from a callback.
+    virtual void Unwatch(WatchID) = 0;
+
+    // Runs the callbacks of files written since the last call. Does not block.
+    virtual void Poll() = 0;
+  };
+}
+
+#endif
@@ -24,6 +24,8 @@ namespace Engine
     uint16_t posY;
     uint16_t width;
     uint16_t height;
+    uint16_t texWidth;    // Size in the texture. Differs from width and height when a
+    uint16_t texHeight;   // distance field is scaled to another size.
     int16_t bearingX;
     int16_t bearingY;
   };
@@ -40,6 +42,30 @@ namespace Engine
     virtual Dg::ErrorCode GetTexture(uint16_t, Ref<Texture2D> & out) = 0;
     virtual void SetTextureDimension(uint32_t) = 0;
 
+    // Slices CommitLoad() splits glyphs into, which are rasterised in parallel on the JobPool.
+    // 0, the default, is one per JobPool thread, and 1 rasterises on the calling thread.
+    virtual void SetLoadThreadCount(uint32_t) = 0;
+
+    // Rather than rasterising everything registered in CommitLoad(), glyphs are rasterised on a
+    // worker thread the first time GetGlyphData() asks for them, which returns nullptr until
+    // they arrive. Texture pages are added as needed up to 'memoryBudget' bytes, after which
+    // the least recently used glyphs are evicted. Call before BeginLoad().
+    virtual void EnableDynamicLoading(size_t memoryBudget) = 0;
+
+    // Glyphs are stored once per font as signed distance fields rasterised at 'referenceSize',
+    // and scaled to whichever size is asked for. The texture holds the distance to the glyph 
+    // edge, 0.5 on the edge and increasing inwards, so text needs a shader which thresholds
+    // it. Call before BeginLoad().
+    virtual void EnableDistanceField(uint32_t referenceSize) = 0;
+    virtual bool IsDistanceField() const = 0;
+
+    // Call once a frame on the main thread. Uploads glyphs which have finished loading.
+    virtual void Update() = 0;
+
+    // Changes whenever glyphs are added to or evicted from the atlas. Anything holding on
+    // to glyph data should get it again when this changes.
+    virtual uint32_t GetVersion() const = 0;
+
     virtual void BeginLoad() = 0;
     virtual Dg::ErrorCode RegisterGlyph(FontID, uint32_t size, CodePoint c) = 0;
     virtual Dg::ErrorCode RegisterAllGlyphs(FontID, uint32_t size) = 0;
@@ -18,6 +18,9 @@ namespace Engine
     virtual void SwapBuffers() = 0;
     virtual void Resize(uint32_t w, uint32_t h) = 0;
 
+    // For GL functions glad does not load, eg from extensions. Returns nullptr if not found.
+    virtual void * GetProcAddress(char const * name) = 0;
+
   private:
 
   };
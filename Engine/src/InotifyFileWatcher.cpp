@@ -0,0 +1,221 @@
+//@group Framework
+
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+
+#include "IFileWatcher.h"
+#include "Framework.h"
+#include "Log.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+namespace Engine
+{
+#ifdef __linux__
+
+  // Watches the directory rather than the file. Editors often save by writing a new
+  // file and renaming it over the old one, which would end a watch on the file itself.
+  class InotifyFileWatcher : public IFileWatcher
+  {
+    struct Entry
+    {
+      WatchID     id;
+      int         wd;
+      std::string path;
+      std::string name;
+      Callback    callback;
+      void *      pUserData;
+    };
+
+  public:
+
+    InotifyFileWatcher();
+    ~InotifyFileWatcher();
+
+    Dg::ErrorCode Init();
+
+    Dg::ErrorCode Watch(std::string const & path, Callback, void * pUserData, WatchID & out) override;
+    void Unwatch(WatchID) override;
+    void Poll() override;
+
+  private:
+
+    bool IsDirectoryWatched(int wd) const;
+
+  private:
+
+    int                 m_fd;
+    WatchID             m_nextID;
+    std::vector<Entry>  m_entries;
+  };
+
+  Dg::ErrorCode Framework::InitFileWatcher()
+  {
+    // Not fatal, Watch() fails instead
+    InotifyFileWatcher * pWatcher = new InotifyFileWatcher();
+    pWatcher->Init();
+    SetFileWatcher(pWatcher);
+    return Dg::ErrorCode::None;
+  }
+
+  InotifyFileWatcher::InotifyFileWatcher()
+    : m_fd(-1)
+    , m_nextID(0)
+    , m_entries()
+  {
+
+  }
+
+  InotifyFileWatcher::~InotifyFileWatcher()
+  {
+    if (m_fd != -1)
+      close(m_fd);
+  }
+
+  Dg::ErrorCode InotifyFileWatcher::Init()
+  {
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd == -1)
+    {
+      LOG_ERROR("InotifyFileWatcher: inotify_init1() failed: {}", strerror(errno));
+      return Dg::ErrorCode::FailedToInitialise;
+    }
+    return Dg::ErrorCode::None;
+  }
+
+  Dg::ErrorCode InotifyFileWatcher::Watch(std::string const & a_path, Callback a_callback, void * a_pUserData, WatchID & a_out)
+  {
+    if (m_fd == -1 || a_callback == nullptr)
+      return Dg::ErrorCode::Failure;
+
+    std::error_code ec;
+    std::filesystem::path path = std::filesystem::absolute(a_path, ec);
+    if (ec)
+      return Dg::ErrorCode::FailedToOpenFile;
+
+    std::string dir = path.parent_path().string();
+
+    // Watching a directory twice returns the same descriptor
+    int wd = inotify_add_watch(m_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd == -1)
+    {
+      LOG_WARN("InotifyFileWatcher: Failed to watch '{}': {}", dir, strerror(errno));
+      return Dg::ErrorCode::FailedToOpenFile;
+    }
+
+    Entry entry;
+    entry.id = m_nextID++;
+    entry.wd = wd;
+    entry.path = a_path;
+    entry.name = path.filename().string();
+    entry.callback = a_callback;
+    entry.pUserData = a_pUserData;
+    m_entries.push_back(entry);
+
+    a_out = entry.id;
+    return Dg::ErrorCode::None;
+  }
+
+  void InotifyFileWatcher::Unwatch(WatchID a_id)
+  {
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+      if (m_entries[i].id != a_id)
+        continue;
+
+      int wd = m_entries[i].wd;
+      m_entries.erase(m_entries.begin() + i);
+      if (!IsDirectoryWatched(wd))
+        inotify_rm_watch(m_fd, wd);
+      return;
+    }
+  }
+
+  bool InotifyFileWatcher::IsDirectoryWatched(int a_wd) const
+  {
+    for (Entry const & entry : m_entries)
+    {
+      if (entry.wd == a_wd)
+        return true;
+    }
+    return false;
+  }
+
+  void InotifyFileWatcher::Poll()
+  {
+    if (m_fd == -1 || m_entries.empty())
+      return;
+
+    // A save can raise several events. Each watch is only called back once per poll.
+    std::vector<WatchID> changed;
+
+    alignas(struct inotify_event) char buf[4096];
+    for (;;)
+    {
+      ssize_t size = read(m_fd, buf, sizeof(buf));
+      if (size <= 0)
+        break;
+
+      for (char * ptr = buf; ptr < buf + size; )
+      {
+        struct inotify_event const * pEvent = reinterpret_cast<struct inotify_event const *>(ptr);
+        ptr += sizeof(struct inotify_event) + pEvent->len;
+
+        if (pEvent->len == 0)
+          continue;
+
+        for (Entry const & entry : m_entries)
+        {
+          if (entry.wd != pEvent->wd || entry.name != pEvent->name)
+            continue;
+          if (std::find(changed.begin(), changed.end(), entry.id) == changed.end())
+            changed.push_back(entry.id);
+        }
+      }
+    }
+
+    // Callbacks can unwatch, so look each entry up again
+    for (WatchID id : changed)
+    {
+      for (size_t i = 0; i < m_entries.size(); i++)
+      {
+        if (m_entries[i].id != id)
+          continue;
+
+        Entry entry = m_entries[i];
+        entry.callback(entry.path, entry.pUserData);
+        break;
+      }
+    }
+  }
+
+#else
+
+  // No file watching on this platform yet
+  class NullFileWatcher : public IFileWatcher
+  {
+  public:
+
+    Dg::ErrorCode Watch(std::string const &, Callback, void *, WatchID &) override
+    {
+      return Dg::ErrorCode::Failure;
+    }
+
+    void Unwatch(WatchID) override {}
+    void Poll() override {}
+  };
+
+  Dg::ErrorCode Framework::InitFileWatcher()
+  {
+    SetFileWatcher(new NullFileWatcher());
+    return Dg::ErrorCode::None;
+  }
+
+#endif
+}
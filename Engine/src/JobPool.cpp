@@ -0,0 +1,138 @@
+//@group Core
+
+#include <algorithm>
+
+#include "JobPool.h"
+#include "BSR_Assert.h"
+#include "Profiler.h"
+
+namespace Engine
+{
+  JobPool * JobPool::s_instance = nullptr;
+
+  void JobPool::Init(uint32_t a_threadCount)
+  {
+    BSR_ASSERT(s_instance == nullptr, "Trying to initialise twice!");
+
+    uint32_t threadCount = a_threadCount;
+    if (threadCount == 0)
+      threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    s_instance = new JobPool(threadCount);
+  }
+
+  void JobPool::ShutDown()
+  {
+    delete s_instance;
+    s_instance = nullptr;
+  }
+
+  JobPool * JobPool::Instance()
+  {
+    return s_instance;
+  }
+
+  JobPool::JobPool(uint32_t a_threadCount)
+    : m_stop(false)
+  {
+    for (uint32_t i = 0; i < a_threadCount; i++)
+      m_threads.push_back(std::thread([this]() { WorkerLoop(); }));
+  }
+
+  // Nothing may be running on the pool by now
+  JobPool::~JobPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      BSR_ASSERT(m_batches.empty(), "Shutting down the job pool while jobs are running!");
+      m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); i++)
+      m_threads[i].join();
+  }
+
+  uint32_t JobPool::GetConcurrency()
+  {
+    if (s_instance == nullptr)
+      return 1;
+    return uint32_t(s_instance->m_threads.size()) + 1;
+  }
+
+  void JobPool::Run(uint32_t a_count, std::function<void(uint32_t)> const & a_job)
+  {
+    if (s_instance == nullptr || s_instance->m_threads.empty() || a_count < 2)
+    {
+      for (uint32_t i = 0; i < a_count; i++)
+        a_job(i);
+      return;
+    }
+
+    Batch batch = {&a_job, a_count, 0, 0};
+    {
+      std::lock_guard<std::mutex> lock(s_instance->m_mutex);
+      s_instance->m_batches.push_back(&batch);
+    }
+    s_instance->m_wake.notify_all();
+
+    while (true)
+    {
+      uint32_t index;
+      {
+        std::lock_guard<std::mutex> lock(s_instance->m_mutex);
+        if (!s_instance->Claim(batch, index))
+          break;
+      }
+      a_job(index);
+      s_instance->Finish(batch);
+    }
+
+    // The batch lives on this stack, so wait for the workers still running its jobs
+    std::unique_lock<std::mutex> lock(s_instance->m_mutex);
+    s_instance->m_finished.wait(lock, [&batch]() { return batch.done == batch.count; });
+  }
+
+  // m_mutex must be held. Once every job of a batch is claimed it leaves the queue, so
+  // workers move on to the next.
+  bool JobPool::Claim(Batch & a_batch, uint32_t & a_index)
+  {
+    if (a_batch.next == a_batch.count)
+      return false;
+
+    a_index = a_batch.next++;
+    if (a_batch.next == a_batch.count)
+      m_batches.erase(std::find(m_batches.begin(), m_batches.end(), &a_batch));
+    return true;
+  }
+
+  void JobPool::Finish(Batch & a_batch)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    a_batch.done++;
+    if (a_batch.done == a_batch.count)
+      m_finished.notify_all();
+  }
+
+  void JobPool::WorkerLoop()
+  {
+    PROFILE_THREAD("Job");
+
+    while (true)
+    {
+      // A batch is not finished, so cannot go out of scope, until this job is
+      Batch * pBatch = nullptr;
+      uint32_t index = 0;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this]() { return m_stop || !m_batches.empty(); });
+        if (m_stop)
+          return;
+        pBatch = m_batches.front();
+        Claim(*pBatch, index);
+      }
+
+      (*pBatch->pJob)(index);
+      Finish(*pBatch);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+//@group Core
+
+#ifndef EN_JOBPOOL_H
+#define EN_JOBPOOL_H
+
+#include <stdint.h>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace Engine
+{
+  // Worker threads which are started once and shared by the engine, for work which can
+  // be split into independent jobs, eg slices of rows. Short lived threads are not started
+  // for each piece of work, so they do not each take a profiler row or a render command slot.
+  class JobPool
+  {
+    static JobPool * s_instance;
+
+    JobPool(uint32_t threadCount);
+    ~JobPool();
+
+  public:
+
+    // 0 starts one thread per hardware thread, less one for the calling thread.
+    static void Init(uint32_t threadCount = 0);
+    static void ShutDown();
+    static JobPool * Instance();
+
+    // Threads which can run jobs at once: the workers and the thread calling Run().
+    // 1 if there is no pool.
+    static uint32_t GetConcurrency();
+
+    // Runs job(0) to job(count - 1) and returns once they have all finished. The calling
+    // thread runs jobs as well, so this can be called from within a job. Without a pool,
+    // the jobs are run in order on the calling thread.
+    static void Run(uint32_t count, std::function<void(uint32_t)> const & job);
+
+  private:
+
+    struct Batch
+    {
+      std::function<void(uint32_t)> const * pJob;
+      uint32_t  count;
+      uint32_t  next;
+      uint32_t  done;
+    };
+
+    bool Claim(Batch &, uint32_t & index);
+    void Finish(Batch &);
+    void WorkerLoop();
+
+    std::mutex                m_mutex;
+    std::condition_variable   m_wake;
+    std::condition_variable   m_finished;
+    std::deque<Batch *>       m_batches; // Those with jobs left to claim
+    std::vector<std::thread>  m_threads;
+    bool                      m_stop;
+  };
+}
+
+#endif
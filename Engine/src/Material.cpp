@@ -17,9 +17,12 @@
 */
 
 
+#include <atomic>
+
 #include "Material.h"
 #include "Message.h"
 #include "Serialize.h"
+#include "Renderer.h"
 
 namespace Engine
 {
@@ -28,8 +31,12 @@ namespace Engine
   //-----------------------------------------------------------------------------------------------
   namespace impl
   {
+    // Materials can be created on any thread
+    static std::atomic<uint64_t> s_nextMaterialID(1);
+
     MaterialData::MaterialData(Ref<RendererProgram> a_prog)
       : m_prog(a_prog)
+      , m_pMaterial(nullptr)
     {
 
     }
@@ -51,12 +58,19 @@ namespace Engine
       : m_pBuf(nullptr)
       , m_bufSize(0)
       , m_materialData(a_materialData)
+      , m_id(s_nextMaterialID.fetch_add(1, std::memory_order_relaxed))
+      , m_generation(0)
+      , m_submittedGeneration(0)
     {
       BSR_ASSERT(m_materialData != nullptr);
       BSR_ASSERT(m_materialData->m_prog != nullptr);
 
       m_bufSize = m_materialData->m_prog->UniformBufferSize();
       m_pBuf = new byte[m_bufSize]{};
+
+      uint32_t uniformCount = m_materialData->m_prog->UniformCount();
+      for (uint32_t i = 0; i < uniformCount; i++)
+        m_uniformGenerations.push_back(0);
     }
 
     MaterialBase::~MaterialBase()
@@ -66,32 +80,104 @@ namespace Engine
 
     void MaterialBase::Bind()
     {
+      Sync();
       m_materialData->m_prog->Bind();
-      m_materialData->m_prog->UploadUniformBuffer(m_pBuf);
+      m_materialData->m_prog->UploadUniformBuffer(m_pBuf, Submit());
+    }
+
+    void MaterialBase::Sync()
+    {
+
+    }
+
+    UniformBufferVersion MaterialBase::Submit()
+    {
+#ifdef BSR_DEBUG
+      if (m_submitThread == std::thread::id())
+        m_submitThread = std::this_thread::get_id();
+      BSR_ASSERT(m_submitThread == std::this_thread::get_id(), "A material must only be submitted from one thread!");
+#endif
+
+      UniformBufferVersion version;
+      version.materialID = m_id;
+      version.generation = m_generation;
+      version.baseGeneration = m_submittedGeneration;
+      version.pDirty = nullptr;
+
+      if (m_submittedGeneration != 0 && m_generation != m_submittedGeneration)
+      {
+        uint32_t wordCount = (uint32_t(m_uniformGenerations.size()) + 31) / 32;
+        uint32_t * pDirty = static_cast<uint32_t *>(RENDER_ALLOCATE(wordCount * sizeof(uint32_t)));
+        memset(pDirty, 0, wordCount * sizeof(uint32_t));
+
+        for (uint32_t i = 0; i < uint32_t(m_uniformGenerations.size()); i++)
+        {
+          if (m_uniformGenerations[i] > m_submittedGeneration)
+            pDirty[i / 32] |= (1u << (i % 32));
+        }
+        version.pDirty = pDirty;
+      }
+
+      m_submittedGeneration = m_generation;
+      return version;
+    }
+
+    uint64_t MaterialBase::GetID() const
+    {
+      return m_id;
+    }
+
+    uint32_t MaterialBase::GetGeneration() const
+    {
+      return m_generation;
+    }
+
+    Ref<RendererProgram> const & MaterialBase::GetProgram() const
+    {
+      return m_materialData->m_prog;
+    }
+
+    byte const * MaterialBase::GetUniformBuffer() const
+    {
+      return m_pBuf;
     }
 
-    ShaderUniformDeclaration const* MaterialBase::FindUniform(std::string const& a_name)
+    uint32_t MaterialBase::GetUniformBufferSize() const
     {
-      ShaderUniformDeclaration const* pdecl = m_materialData->m_prog->FindUniformDeclaration(a_name);
-      BSR_ASSERT(pdecl != nullptr);
+      return m_bufSize;
+    }
+
+    uint32_t MaterialBase::FindUniform(std::string const& a_name)
+    {
+      uint32_t index = m_materialData->m_prog->FindUniformIndex(a_name);
+      BSR_ASSERT(index != INVALID_INDEX);
       
-      return pdecl;
+      return index;
+    }
+
+    ShaderUniformDeclaration const * MaterialBase::GetDeclaration(uint32_t a_index) const
+    {
+      return m_materialData->m_prog->GetUniformDeclaration(a_index);
     }
 
-    UniformBufferElementHeader MaterialBase::CreateHeader(ShaderUniformDeclaration const * a_pdecl, uint32_t a_size)
+    UniformBufferElementHeader MaterialBase::CreateHeader(uint32_t a_index, uint32_t a_size)
     {
-      uint32_t count = a_size / SizeOfShaderDataType(a_pdecl->GetType());
-      BSR_ASSERT(a_pdecl->GetCount() >= count);
+      ShaderUniformDeclaration const * pdecl = GetDeclaration(a_index);
+      uint32_t count = a_size / SizeOfShaderDataType(pdecl->GetType());
+      BSR_ASSERT(pdecl->GetCount() >= count);
       UniformBufferElementHeader header;
       header.SetSize(a_size);
       return header;
     }
 
-    void MaterialBase::WriteToBuffer(uint32_t a_offset, UniformBufferElementHeader a_header, void const * a_pBuf)
+    void MaterialBase::WriteToBuffer(uint32_t a_index, UniformBufferElementHeader a_header, void const * a_pBuf)
     {
-      void* buf = (void*)(m_pBuf + a_offset);
+      void* buf = (void*)(m_pBuf + GetDeclaration(a_index)->GetDataOffset());
       buf = a_header.Serialize(buf);
       memcpy(buf, a_pBuf, a_header.GetSize());
+
+      m_generation++;
+      m_uniformGenerations[a_index] = m_generation;
     }
   }
 
@@ -103,12 +189,12 @@ namespace Engine
     : impl::MaterialBase(a_data)
     , m_renderFlags(0)
   {
-
+    m_materialData->m_pMaterial = this;
   }
 
   Material::~Material()
   {
-
+    m_materialData->m_pMaterial = nullptr;
   }
 
   Ref<Material> Material::Create(Ref<RendererProgram> a_prog)
@@ -121,34 +207,21 @@ namespace Engine
   Ref<MaterialInstance> Material::SpawnInstance()
   {
     Ref<MaterialInstance> inst(new MaterialInstance(m_materialData));
-    inst->InitBuffer(m_pBuf);
-    m_materialInstances.push_back(inst);
+    inst->InitBuffer(*this);
     return inst;
   }
 
   void Material::SetUniform(std::string const & a_name, void const * a_pBuf, uint32_t a_size)
   {
-    ShaderUniformDeclaration const * pdecl = FindUniform(a_name);
-    UniformBufferElementHeader header = CreateHeader(pdecl, a_size);
-
-    uint32_t offset = pdecl->GetDataOffset();
-    WriteToBuffer(offset, header, a_pBuf);
-
-    for (auto pInst : m_materialInstances)
-      pInst->SetUniform(offset, a_pBuf, a_size);
+    uint32_t index = FindUniform(a_name);
+    WriteToBuffer(index, CreateHeader(index, a_size), a_pBuf);
   }
 
   void Material::SetTexture(std::string const & a_name, Ref<Texture2D> const & a_texture)
   {
-    ShaderUniformDeclaration const * pdecl = FindUniform(a_name);
-    UniformBufferElementHeader header = CreateHeader(pdecl, sizeof(RenderResourceID));
-
-    uint32_t offset = pdecl->GetDataOffset();
+    uint32_t index = FindUniform(a_name);
     RenderResourceID id = a_texture->GetID();
-    WriteToBuffer(offset, header, &id);
-
-    for (auto pInst : m_materialInstances)
-      pInst->SetUniform(offset, &id, sizeof(RenderResourceID));
+    WriteToBuffer(index, CreateHeader(index, sizeof(RenderResourceID)), &id);
   }
 
   //-----------------------------------------------------------------------------------------------
@@ -157,13 +230,15 @@ namespace Engine
 
   MaterialInstance::MaterialInstance(Ref<impl::MaterialData> a_materialData)
     : impl::MaterialBase(a_materialData)
+    , m_materialGeneration(0)
   {
 
   }
 
-  void MaterialInstance::InitBuffer(byte const* a_pBuf)
+  void MaterialInstance::InitBuffer(Material const & a_material)
   {
-    memcpy(m_pBuf, a_pBuf, m_bufSize);
+    memcpy(m_pBuf, a_material.m_pBuf, m_bufSize);
+    m_materialGeneration = a_material.m_generation;
   }
 
   MaterialInstance::~MaterialInstance()
@@ -173,34 +248,46 @@ namespace Engine
 
   void MaterialInstance::SetUniform(std::string const & a_name, void const * a_pBuf, uint32_t a_size)
   {
-    ShaderUniformDeclaration const * pdecl = FindUniform(a_name);
-    UniformBufferElementHeader header = CreateHeader(pdecl, a_size);
+    uint32_t index = FindUniform(a_name);
+    UniformBufferElementHeader header = CreateHeader(index, a_size);
     header.SetFlag(UniformBufferElementHeader::ElementLocked, true);
-
-    uint32_t offset = pdecl->GetDataOffset();
-    WriteToBuffer(offset, header, a_pBuf);
+    WriteToBuffer(index, header, a_pBuf);
   }
 
   void MaterialInstance::SetTexture(std::string const & a_name, Ref<Texture2D> const & a_texture)
   {
-    ShaderUniformDeclaration const * pdecl = FindUniform(a_name);
-    UniformBufferElementHeader header = CreateHeader(pdecl, sizeof(RenderResourceID));
+    uint32_t index = FindUniform(a_name);
+    UniformBufferElementHeader header = CreateHeader(index, sizeof(RenderResourceID));
     header.SetFlag(UniformBufferElementHeader::ElementLocked, true);
 
-    uint32_t offset = pdecl->GetDataOffset();
     RenderResourceID id = a_texture->GetID();
-    WriteToBuffer(offset, header, &id);
+    WriteToBuffer(index, header, &id);
   }
 
-  void MaterialInstance::SetUniform(uint32_t a_offset, void const* a_pBuf, uint32_t a_size)
+  void MaterialInstance::Sync()
   {
-    UniformBufferElementHeader header;
-    header.Deserialize(a_pBuf);
-
-    if (header.Is(UniformBufferElementHeader::ElementLocked))
+    Material const * pMaterial = m_materialData->m_pMaterial;
+    if (pMaterial == nullptr || pMaterial->m_generation == m_materialGeneration)
       return;
 
-    header.SetSize(a_size);
-    WriteToBuffer(a_offset, header, a_pBuf);
+    for (uint32_t i = 0; i < uint32_t(m_uniformGenerations.size()); i++)
+    {
+      if (pMaterial->m_uniformGenerations[i] <= m_materialGeneration)
+        continue;
+
+      ShaderUniformDeclaration const * pdecl = GetDeclaration(i);
+      uint32_t offset = pdecl->GetDataOffset();
+
+      UniformBufferElementHeader header;
+      header.Deserialize(m_pBuf + offset);
+      if (header.Is(UniformBufferElementHeader::ElementLocked))
+        continue;
+
+      memcpy(m_pBuf + offset, pMaterial->m_pBuf + offset, pdecl->GetDataSize());
+      m_generation++;
+      m_uniformGenerations[i] = m_generation;
+    }
+
+    m_materialGeneration = pMaterial->m_generation;
   }
-}
\ No newline at end of file
+}
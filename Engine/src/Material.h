@@ -21,6 +21,7 @@
 #define MATERIAL_H
 
 #include <string>
+#include <thread>
 
 #include "Memory.h"
 #include "MemBuffer.h"
@@ -32,6 +33,8 @@
 
 namespace Engine
 {
+  class Material;
+
   namespace impl
   {
     class MaterialData
@@ -44,6 +47,9 @@ namespace Engine
 
     public:
       Ref<RendererProgram> m_prog;
+
+      // Instances inherit values from here. Cleared when the Material is destroyed.
+      Material * m_pMaterial;
     };
 
     class MaterialBase
@@ -54,17 +60,43 @@ namespace Engine
       virtual ~MaterialBase();
       void Bind();
 
+      Ref<RendererProgram> const & GetProgram() const;
+      byte const * GetUniformBuffer() const;
+      uint32_t GetUniformBufferSize() const;
+
+      // Bring the uniform buffer up to date with anything it inherits.
+      virtual void Sync();
+
+      // Call when the uniform buffer is sent to the render thread. Marks all uniforms
+      // as clean. The dirty bits are allocated from render command memory. Draw calls
+      // can be recorded on any thread, but a material must always be submitted from the
+      // same one, as the generation it was last submitted at is not shared.
+      UniformBufferVersion Submit();
+
+      uint64_t GetID() const;
+      uint32_t GetGeneration() const;
+
     protected:
 
-      ShaderUniformDeclaration const * FindUniform(std::string const &);
-      UniformBufferElementHeader CreateHeader(ShaderUniformDeclaration const*, uint32_t size);
-      void WriteToBuffer(uint32_t offset, UniformBufferElementHeader header, void const * buffer);
+      uint32_t FindUniform(std::string const &);
+      UniformBufferElementHeader CreateHeader(uint32_t index, uint32_t size);
+      void WriteToBuffer(uint32_t index, UniformBufferElementHeader header, void const * buffer);
+      ShaderUniformDeclaration const * GetDeclaration(uint32_t index) const;
       
     protected:
 
       Ref<impl::MaterialData> m_materialData;
       uint32_t                m_bufSize;
       byte*                   m_pBuf;
+
+      uint64_t                    m_id;
+      uint32_t                    m_generation;
+      uint32_t                    m_submittedGeneration;
+      Dg::DynamicArray<uint32_t>  m_uniformGenerations; // Generation each uniform was last written
+
+#ifdef BSR_DEBUG
+      std::thread::id             m_submitThread;
+#endif
     };
   }
 
@@ -77,14 +109,17 @@ namespace Engine
     void SetUniform(std::string const& uniform, void const* data, uint32_t size);
     void SetTexture(std::string const& name, Ref<Texture2D> const&);
 
+    // Pull any uniforms changed on the Material which have not been set on this instance.
+    void Sync() override;
+
   private: //Accessed by Material
 
     MaterialInstance(Ref<impl::MaterialData>);
-    void InitBuffer(byte const *);
-    void SetUniform(uint32_t offset, void const* data, uint32_t size);
+    void InitBuffer(Material const &);
 
   private:
 
+    uint32_t m_materialGeneration; // Generation of the Material last synced with
   };
 
   class Material : public impl::MaterialBase
@@ -101,8 +136,9 @@ namespace Engine
     void SetTexture(std::string const& name, Ref<Texture2D> const&);
 
   private:
+    friend class MaterialInstance;
+
     //Dg::Map_AVL<std::string, ResourceID>  m_textureBindings;
-    Dg::DynamicArray<Ref<MaterialInstance>> m_materialInstances;
     uint32_t m_renderFlags;
   };
 
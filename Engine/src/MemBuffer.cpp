@@ -1,6 +1,7 @@
 //@group Core
 
 #include "MemBuffer.h"
+#include "Options.h"
 
 //--------------------------------------------------------------------------------------------
 // MemBufferDynamic
@@ -128,4 +129,161 @@ void MemBuffer::clear()
 size_t MemBuffer::size() const
 {
   return m_cursor;
-}
\ No newline at end of file
+}
+//--------------------------------------------------------------------------------------------
+// MemBufferChunked
+//--------------------------------------------------------------------------------------------
+MemBufferChunked::MemBufferChunked()
+  : MemBufferChunked(s_defaultPageSize, s_defaultAlignment)
+{
+
+}
+
+MemBufferChunked::MemBufferChunked(size_t a_pageSize)
+  : MemBufferChunked(a_pageSize, s_defaultAlignment)
+{
+
+}
+
+MemBufferChunked::MemBufferChunked(size_t a_pageSize, size_t a_alignment)
+  : m_pageSize(a_pageSize)
+  , m_alignment(a_alignment)
+  , m_used(0)
+  , m_capacity(0)
+  , m_lastPeak(0)
+  , m_quietPeak(0)
+  , m_quietCount(0)
+  , m_pHead(nullptr)
+  , m_pCurrent(nullptr)
+{
+  BSR_ASSERT(a_alignment <= s_defaultAlignment, "MemBufferChunked: unsupported alignment");
+}
+
+MemBufferChunked::~MemBufferChunked()
+{
+  Page * pPage = m_pHead;
+  while (pPage != nullptr)
+  {
+    Page * pNext = pPage->pNext;
+    free(pPage);
+    pPage = pNext;
+  }
+}
+
+Engine::byte * MemBufferChunked::PageData(Page * a_pPage)
+{
+  return reinterpret_cast<Engine::byte *>(a_pPage) + s_pageHeaderSize;
+}
+
+MemBufferChunked::Page * MemBufferChunked::NewPage(size_t a_minSize)
+{
+  size_t size = a_minSize > m_pageSize ? a_minSize : m_pageSize;
+  Page * pPage = static_cast<Page *>(malloc(s_pageHeaderSize + size));
+  if (pPage == nullptr)
+    throw std::exception("MemBufferChunked failed to allocate!");
+
+  pPage->pNext = nullptr;
+  pPage->size = size;
+  pPage->cursor = 0;
+  m_capacity += size;
+  return pPage;
+}
+
+void* MemBufferChunked::Allocate(size_t a_size)
+{
+  size_t size = Dg::ForwardAlign<size_t>(a_size, m_alignment);
+
+  if (m_pCurrent == nullptr)
+  {
+    m_pHead = NewPage(size);
+    m_pCurrent = m_pHead;
+  }
+
+  while (m_pCurrent->cursor + size > m_pCurrent->size)
+  {
+    Page * pNext = m_pCurrent->pNext;
+    if (pNext == nullptr || pNext->size < size)
+    {
+      Page * pPage = NewPage(size);
+      pPage->pNext = pNext;
+      m_pCurrent->pNext = pPage;
+      pNext = pPage;
+    }
+    m_pCurrent = pNext;
+    m_pCurrent->cursor = 0;
+  }
+
+  void * mem = PageData(m_pCurrent) + m_pCurrent->cursor;
+  m_pCurrent->cursor += size;
+  m_used += size;
+  return mem;
+}
+
+void MemBufferChunked::clear()
+{
+  m_lastPeak = m_used;
+
+  if (m_used * 2 < m_capacity)
+  {
+    m_quietCount++;
+    if (m_used > m_quietPeak)
+      m_quietPeak = m_used;
+  }
+  else
+  {
+    m_quietCount = 0;
+    m_quietPeak = 0;
+  }
+
+  if (m_quietCount >= MEMBUFFER_SHRINK_DELAY)
+  {
+    Shrink();
+    m_quietCount = 0;
+    m_quietPeak = 0;
+  }
+
+  m_used = 0;
+  m_pCurrent = m_pHead;
+  if (m_pHead != nullptr)
+    m_pHead->cursor = 0;
+}
+
+// Keep enough pages to hold the peak usage seen while quiet
+void MemBufferChunked::Shrink()
+{
+  if (m_pHead == nullptr)
+    return;
+
+  Page * pLast = m_pHead;
+  size_t kept = pLast->size;
+  while (kept < m_quietPeak && pLast->pNext != nullptr)
+  {
+    pLast = pLast->pNext;
+    kept += pLast->size;
+  }
+
+  Page * pPage = pLast->pNext;
+  pLast->pNext = nullptr;
+  while (pPage != nullptr)
+  {
+    Page * pNext = pPage->pNext;
+    m_capacity -= pPage->size;
+    free(pPage);
+    pPage = pNext;
+  }
+}
+
+size_t MemBufferChunked::size() const
+{
+  return m_used;
+}
+
+size_t MemBufferChunked::capacity() const
+{
+  return m_capacity;
+}
+
+size_t MemBufferChunked::peak() const
+{
+  return m_lastPeak;
+}
@@ -70,4 +70,78 @@ private:
   Engine::byte *  m_memblock;
 };
 
+// A bump allocator made up of linked pages. Grows by adding pages when full. Pages are
+// kept across clear() but, if usage stays well under capacity for MEMBUFFER_SHRINK_DELAY
+// clears in a row, pages above the recent peak usage are released.
+class MemBufferChunked
+{
+  static size_t const s_defaultPageSize = 64 * 1024;
+  static size_t const s_defaultAlignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+private:
+
+  MemBufferChunked(MemBufferChunked const&) = delete;
+  MemBufferChunked& operator=(MemBufferChunked const&) = delete;
+
+public:
+
+  MemBufferChunked();
+  MemBufferChunked(size_t pageSize);
+  MemBufferChunked(size_t pageSize, size_t alignment);
+  ~MemBufferChunked();
+
+  void* Allocate(size_t a_size);
+  void clear();
+
+  // Bytes allocated since the last clear()
+  size_t size() const;
+
+  // Bytes held in pages
+  size_t capacity() const;
+
+  // Bytes allocated before the last clear()
+  size_t peak() const;
+
+  // Visit pages in allocation order. Allocations do not straddle pages.
+  // Signature: void(Engine::byte * data, size_t bytesUsed)
+  template<typename Fn>
+  void ForEachPage(Fn a_fn) const
+  {
+    for (Page * pPage = m_pHead; pPage != nullptr; pPage = pPage->pNext)
+    {
+      a_fn(PageData(pPage), pPage->cursor);
+      if (pPage == m_pCurrent)
+        break;
+    }
+  }
+
+private:
+
+  // Data follows the header
+  struct Page
+  {
+    Page *  pNext;
+    size_t  size;
+    size_t  cursor;
+  };
+
+  static size_t const s_pageHeaderSize = (sizeof(Page) + s_defaultAlignment - 1) & ~(s_defaultAlignment - 1);
+
+  static Engine::byte * PageData(Page *);
+  Page * NewPage(size_t minSize);
+  void Shrink();
+
+private:
+
+  size_t    m_pageSize;
+  size_t    m_alignment;
+  size_t    m_used;
+  size_t    m_capacity;
+  size_t    m_lastPeak;
+  size_t    m_quietPeak;
+  uint32_t  m_quietCount;
+  Page *    m_pHead;
+  Page *    m_pCurrent;
+};
+
 #endif
\ No newline at end of file
@@ -1,9 +1,11 @@
 //@group Memory
 
-#include <mutex>
-#include "MemBuffer.h"
+#include <atomic>
+#include <cstdlib>
+#include "DgMath.h"
 #include "Memory.h"
 #include "Options.h"
+#include "Utils.h"
 
 namespace Engine
 {
@@ -11,19 +13,123 @@ namespace Engine
   {
     namespace TRef
     {
-      static std::mutex mutex;
-      static MemBuffer buf(TEMP_BUFFER_SIZE);
+      // Each thread carves allocations out of its own slab, so the only shared state
+      // touched per allocation is when a thread needs a new slab.
+      struct Slab
+      {
+        byte *    pCursor;
+        byte *    pEnd;
+        uint32_t  frame;
+      };
+
+      static size_t const s_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+      static byte * memblock = static_cast<byte *>(malloc(TEMP_BUFFER_SIZE));
+      static std::atomic<size_t> cursor(0);
+      static std::atomic<uint32_t> frame(0);
+      static thread_local Slab slab = {nullptr, nullptr, 0xFFFFFFFF};
+
+      // Only touched by the thread calling TBUFClear()
+      static TBUFStats stats = {};
+
+      // Blocks handed out once the temp buffer is full. Each is prefixed with a header
+      // linking it into a list, which is freed in TBUFClear().
+      struct Overflow
+      {
+        Overflow * pNext;
+      };
+
+      static size_t const s_overflowHeaderSize = Dg::ForwardAlign<size_t>(sizeof(Overflow), s_alignment);
+      static std::atomic<Overflow *> overflow(nullptr);
+      static std::atomic<uint32_t> overflowWarnedFrame(0xFFFFFFFF);
+
+      static byte * ReserveOverflow(size_t a_size)
+      {
+        uint32_t currentFrame = frame.load(std::memory_order_relaxed);
+        if (overflowWarnedFrame.exchange(currentFrame, std::memory_order_relaxed) != currentFrame)
+          LOG_WARN("Temp buffer out of memory! Falling back to the heap. Increase TEMP_BUFFER_SIZE.");
+
+        byte * pBlock = static_cast<byte *>(malloc(s_overflowHeaderSize + a_size));
+        if (pBlock == nullptr)
+        {
+          LOG_CRITICAL("Failed to allocate {} bytes for the temp buffer.", a_size);
+          abort();
+        }
+
+        Overflow * pHeader = reinterpret_cast<Overflow *>(pBlock);
+        pHeader->pNext = overflow.load(std::memory_order_relaxed);
+        while (!overflow.compare_exchange_weak(pHeader->pNext, pHeader, std::memory_order_release, std::memory_order_relaxed));
+
+        return pBlock + s_overflowHeaderSize;
+      }
+
+      static byte * Reserve(size_t a_size)
+      {
+        size_t offset = cursor.fetch_add(a_size, std::memory_order_relaxed);
+        if (offset + a_size > TEMP_BUFFER_SIZE)
+          return ReserveOverflow(a_size);
+        return memblock + offset;
+      }
     }
   }
 
   void TBUFClear()
   {
-    impl::TRef::buf.clear();
+    using namespace impl::TRef;
+
+    size_t used = cursor.exchange(0, std::memory_order_relaxed);
+
+    Overflow * pOverflow = overflow.exchange(nullptr, std::memory_order_acquire);
+    while (pOverflow != nullptr)
+    {
+      Overflow * pNext = pOverflow->pNext;
+      free(pOverflow);
+      pOverflow = pNext;
+    }
+
+    stats.capacity = TEMP_BUFFER_SIZE;
+    stats.lastFrameBytes = used;
+    stats.totalBytes += used;
+    stats.frames++;
+    if (used > stats.highWaterMark)
+      stats.highWaterMark = used;
+
+    // Threads will see the new frame number on their next allocation and drop their slab
+    frame.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  TBUFStats TBUFGetStats()
+  {
+    return impl::TRef::stats;
   }
 
   void* TBUFAlloc(size_t a_size)
   {
-    std::lock_guard<std::mutex> lock(impl::TRef::mutex);
-    return impl::TRef::buf.Allocate(a_size);
+    using namespace impl::TRef;
+
+    size_t size = Dg::ForwardAlign<size_t>(a_size, s_alignment);
+
+    uint32_t currentFrame = frame.load(std::memory_order_relaxed);
+    if (slab.frame != currentFrame)
+    {
+      slab.pCursor = nullptr;
+      slab.pEnd = nullptr;
+      slab.frame = currentFrame;
+    }
+
+    if (size > static_cast<size_t>(slab.pEnd - slab.pCursor))
+    {
+      // Large allocations get their own block rather than throwing away the rest of the slab
+      if (size > TEMP_BUFFER_SLAB_SIZE / 4)
+        return Reserve(size);
+
+      byte * pSlab = Reserve(TEMP_BUFFER_SLAB_SIZE);
+      slab.pCursor = pSlab;
+      slab.pEnd = pSlab + TEMP_BUFFER_SLAB_SIZE;
+    }
+
+    void * result = slab.pCursor;
+    slab.pCursor += size;
+    return result;
   }
-}
\ No newline at end of file
+}
@@ -19,9 +19,24 @@ namespace Engine
   //clear each frame.
   void* TBUFAlloc(size_t);
 
-  //Clear the tempory buffer
+  //Clear the tempory buffer. Call once per frame, from one thread.
   void TBUFClear();
 
+  //Usage of the tempory buffer, in bytes. Each thread reserves memory in slabs, so these
+  //count reserved rather than requested memory. Once the buffer is full, allocations fall
+  //back to the heap until the next TBUFClear(), so usage can exceed capacity.
+  struct TBUFStats
+  {
+    size_t    capacity;
+    size_t    lastFrameBytes;
+    size_t    highWaterMark;
+    uint64_t  totalBytes;
+    uint64_t  frames;
+  };
+
+  //Stats are updated in TBUFClear()
+  TBUFStats TBUFGetStats();
+
   //A wrapper which constructs and stores objects on the tempory buffer. Objects must be
   //trivially destructable.
   template<typename T>
@@ -79,7 +79,12 @@ namespace Engine
 
   uint32_t Message::GetCategory() const
   {
-    return GetID() >> ID_SHIFT;
+    return GetCategory(GetID());
+  }
+
+  uint32_t Message::GetCategory(uint32_t a_messageID)
+  {
+    return a_messageID >> ID_SHIFT;
   }
 
   MESSAGE_LIST
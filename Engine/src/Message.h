@@ -41,6 +41,7 @@ namespace Engine
     bool QueryFlag(Flag a_flag) const;
     void SetFlag(Flag a_flag, bool);
     uint32_t GetCategory() const;
+    static uint32_t GetCategory(uint32_t messageID);
 
     // All these defined in the macro (user do NOT implement)
     virtual uint32_t GetID() const = 0;
@@ -1,13 +1,92 @@
 //@group Messages
 
+#include <new>
+#include <thread>
+
 #include "Message.h"
 #include "MessageBus.h"
 #include "System.h"
 #include "SystemStack.h"
+#include "BSR_Assert.h"
+#include "Profiler.h"
 #include "options.h"
 
 namespace Engine
 {
+  //------------------------------------------------------------------------------------
+  // Helpers
+  //------------------------------------------------------------------------------------
+  static size_t AlignForward(size_t a_val, size_t a_alignment)
+  {
+    return (a_val + a_alignment - 1) & ~(a_alignment - 1);
+  }
+
+  namespace impl
+  {
+    static std::atomic<uint64_t> s_nextBusID(0);
+    static std::atomic<uint64_t> s_liveBusID(0);
+
+    // The staging segment this thread posts into. Tagged with the id of the bus it
+    // belongs to in case the bus is shut down and created again. Handed back to the
+    // bus when the thread exits.
+    struct ThreadStaging
+    {
+      ~ThreadStaging()
+      {
+        if (pInUse != nullptr && s_liveBusID.load() == busID)
+          pInUse->store(false);
+      }
+
+      uint64_t            busID;
+      void *              pStaging;
+      std::atomic<bool> * pInUse;
+    };
+
+    static thread_local ThreadStaging t_staging = {0, nullptr, nullptr};
+  }
+
+  //------------------------------------------------------------------------------------
+  // Queue
+  //------------------------------------------------------------------------------------
+  MessageBus::Queue::Queue()
+    : buf(MESSAGE_BUS_PAGE_SIZE, s_alignment)
+    , count(0)
+  {
+
+  }
+
+  void * MessageBus::Queue::Allocate(size_t a_size)
+  {
+    size_t entrySize = AlignForward(s_entryHeaderSize + a_size, s_alignment);
+    byte * pEntry = static_cast<byte *>(buf.Allocate(entrySize));
+    *reinterpret_cast<size_t *>(pEntry) = entrySize;
+    count.fetch_add(1, std::memory_order_relaxed);
+
+    return pEntry + s_entryHeaderSize;
+  }
+
+  // Pages are kept for the next cycle
+  void MessageBus::Queue::Clear()
+  {
+    buf.clear();
+    count.store(0, std::memory_order_relaxed);
+  }
+
+  //------------------------------------------------------------------------------------
+  // Staging
+  //------------------------------------------------------------------------------------
+  MessageBus::Staging::Staging()
+    : busy(false)
+    , inUse(true)
+    , pNext(nullptr)
+    , queues()
+  {
+
+  }
+
+  //------------------------------------------------------------------------------------
+  // MessageBus
+  //------------------------------------------------------------------------------------
   MessageBus * MessageBus::s_instance = nullptr;
 
   void MessageBus::Init()
@@ -27,64 +106,135 @@ namespace Engine
   }
 
   MessageBus::MessageBus()
-    : m_writeBuffer(0)
+    : m_id(++impl::s_nextBusID)
+    , m_epoch(0)
+    , m_pStagings(nullptr)
   {
+    impl::s_liveBusID.store(m_id);
+  }
 
+  MessageBus::~MessageBus()
+  {
+    impl::s_liveBusID.store(0);
+
+    Staging * pStaging = m_pStagings.load();
+    while (pStaging != nullptr)
+    {
+      Staging * pNext = pStaging->pNext;
+      delete pStaging;
+      pStaging = pNext;
+    }
+  }
+
+  MessageBus::Staging * MessageBus::GetStaging()
+  {
+    if (impl::t_staging.busID == m_id)
+      return static_cast<Staging *>(impl::t_staging.pStaging);
+
+    // First post from this thread. Take over the staging of a thread which has exited,
+    // so short lived threads do not each leave one behind. Stagings are only deleted
+    // with the bus, so walking the list is safe. Any messages still in it are kept.
+    Staging * pStaging = nullptr;
+    for (Staging * pFree = m_pStagings.load(); pFree != nullptr; pFree = pFree->pNext)
+    {
+      bool inUse = false;
+      if (pFree->inUse.compare_exchange_strong(inUse, true))
+      {
+        pStaging = pFree;
+        break;
+      }
+    }
+
+    // Otherwise push a new staging onto the list
+    if (pStaging == nullptr)
+    {
+      pStaging = new Staging();
+      Staging * pHead = m_pStagings.load();
+      do
+      {
+        pStaging->pNext = pHead;
+      } while (!m_pStagings.compare_exchange_weak(pHead, pStaging));
+    }
+
+    impl::t_staging.busID = m_id;
+    impl::t_staging.pStaging = pStaging;
+    impl::t_staging.pInUse = &pStaging->inUse;
+    return pStaging;
   }
 
   size_t MessageBus::MessageCount()
   {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_messageQueue[m_writeBuffer].size();
+    size_t count = 0;
+    uint32_t writeQueue = m_epoch.load() & 1;
+    for (Staging * pStaging = m_pStagings.load(); pStaging != nullptr; pStaging = pStaging->pNext)
+      count += pStaging->queues[writeQueue].count.load(std::memory_order_relaxed);
+    return count;
   }
 
   void * MessageBus::_ReserveAndRegister(size_t a_msgSize)
   {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    void * buf = m_buf[m_writeBuffer].Allocate(a_msgSize);
-    m_messageQueue[m_writeBuffer].push_back(static_cast<Message *>(buf));
+    Staging * pStaging = GetStaging();
+
+    pStaging->busy.store(true);
+    void * buf = pStaging->queues[m_epoch.load() & 1].Allocate(a_msgSize);
+    pStaging->busy.store(false);
+
     return buf;
   }
 
   void MessageBus::Register(TRef<Message> const & a_message)
   {
-    size_t sze = a_message->Size();
-    void * buf = nullptr;
-    {
-      std::unique_lock<std::mutex> lock(m_mutex);
-      buf = m_buf[m_writeBuffer].Allocate(sze);
-      m_messageQueue[m_writeBuffer].push_back(static_cast<Message *>(buf));
-    }
+    Staging * pStaging = GetStaging();
+
+    // The dispatcher bumps the epoch and then waits for 'busy' to drop, so it will
+    // never read a queue we are still writing to.
+    pStaging->busy.store(true);
+    void * buf = pStaging->queues[m_epoch.load() & 1].Allocate(a_message->Size());
     a_message->Clone(buf);
+    pStaging->busy.store(false);
   }
 
   void MessageBus::DispatchMessages(SystemStack & a_systemStack, uint32_t a_cycles)
   {
+    PROFILE_SCOPE("DispatchMessages");
+
     if (a_cycles == 0)
       a_cycles = 0xFFFFFFFF;
 
     for (uint32_t c = 0; c < a_cycles; c++)
     {
-      int readBuffer = m_writeBuffer;
-      m_writeBuffer = (m_writeBuffer + 1) & 1;
+      uint32_t readQueue = m_epoch.fetch_add(1) & 1;
+      Staging * pStagings = m_pStagings.load();
 
-      if (m_messageQueue[readBuffer].size() == 0)
+      // Wait for any posts which started before the epoch changed
+      size_t count = 0;
+      for (Staging * pStaging = pStagings; pStaging != nullptr; pStaging = pStaging->pNext)
+      {
+        while (pStaging->busy.load())
+          std::this_thread::yield();
+        count += pStaging->queues[readQueue].count.load(std::memory_order_relaxed);
+      }
+
+      if (count == 0)
         break;
 
-      for (size_t i = 0; i < m_messageQueue[readBuffer].size(); i++)
+      for (Staging * pStaging = pStagings; pStaging != nullptr; pStaging = pStaging->pNext)
       {
-        Message * pMsg = m_messageQueue[readBuffer][i];
-        auto it = a_systemStack.begin();
-        for (; it != a_systemStack.end(); it++)
-        {
-          it->second->HandleMessage(pMsg);
-          if (pMsg->QueryFlag(Message::Flag::Handled))
-            break;
-        }
+        pStaging->queues[readQueue].ForEach([&a_systemStack](Message * a_pMsg)
+          {
+            // Handlers may push or pop systems. The stack holds those changes until
+            // EndDispatch(), so the subscriber list and the systems in it stay valid.
+            a_systemStack.BeginDispatch();
+            for (System * pSystem : a_systemStack.GetSubscribers(a_pMsg->GetID()))
+            {
+              pSystem->HandleMessage(a_pMsg);
+              if (a_pMsg->QueryFlag(Message::Flag::Handled))
+                break;
+            }
+            a_systemStack.EndDispatch();
+          });
+        pStaging->queues[readQueue].Clear();
       }
-
-      m_messageQueue[readBuffer].clear();
-      m_buf[readBuffer].clear();
     }
   }
-}
+}
\ No newline at end of file
@@ -4,12 +4,11 @@
 #define EN_MESSAGEBUS_H
 
 #include <stdint.h>
-#include <mutex>
+#include <atomic>
 
-#include "MemBuffer.h"
 #include "Message.h"
-#include "PODArray.h"
 #include "Memory.h"
+#include "MemBuffer.h"
 
 #define POST(msg) ::Engine::MessageBus::Instance()->Register(msg)
 #define EMPLACE_POST(...) CALL_OVERLOAD(EMPLACE_POST, __VA_ARGS__)
@@ -39,6 +38,7 @@ namespace Engine
     static MessageBus * s_instance;
 
     MessageBus();
+    ~MessageBus();
 
   public:
 
@@ -46,11 +46,13 @@ namespace Engine
     static void ShutDown();
     static MessageBus * Instance();
 
-    // Allocate a message directly on the MessageBus memory heap. Access through macro above
+    // Allocate a message directly on the MessageBus memory heap. Access through macro above.
+    // The message must be fully constructed before the next call to DispatchMessages(),
+    // so from worker threads prefer POST.
     void * _ReserveAndRegister(size_t MsgSize);
 
     // Add message to the queue to be processed at a later time.
-    // Can be used from any thread.
+    // Can be used from any thread, and does not lock.
     void Register(TRef<Message> const &);
 
     // Since dispatching messages may generate more messages, we add an upper limit of how 
@@ -61,10 +63,55 @@ namespace Engine
 
   private:
 
-    std::mutex              m_mutex;
-    int                     m_writeBuffer;
-    PODArray<Message*>      m_messageQueue[2];
-    MemBuffer               m_buf[2];
+    // Messages posted from one thread, for one dispatch cycle
+    struct Queue
+    {
+      Queue();
+
+      void * Allocate(size_t);
+      void Clear();
+
+      template<typename Fn>
+      void ForEach(Fn a_fn)
+      {
+        buf.ForEachPage([&a_fn](byte * a_pData, size_t a_used)
+          {
+            size_t offset = 0;
+            while (offset < a_used)
+            {
+              a_fn(reinterpret_cast<Message *>(a_pData + offset + s_entryHeaderSize));
+              offset += *reinterpret_cast<size_t *>(a_pData + offset);
+            }
+          });
+      }
+
+      MemBufferChunked    buf;
+      std::atomic<size_t> count;
+    };
+
+    // Each thread which posts messages owns one of these. Messages are written to
+    // queues[epoch & 1], and the 'busy' flag is raised while a thread is writing.
+    // When a thread exits, 'inUse' is cleared and the next new thread takes it over.
+    struct Staging
+    {
+      Staging();
+
+      std::atomic<bool> busy;
+      std::atomic<bool> inUse;
+      Staging *         pNext;
+      Queue             queues[2];
+    };
+
+    static size_t const s_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+    static size_t const s_entryHeaderSize = s_alignment;
+
+    Staging * GetStaging();
+
+  private:
+
+    uint64_t const          m_id;
+    std::atomic<uint32_t>   m_epoch;
+    std::atomic<Staging *>  m_pStagings;
   };
 }
 
@@ -75,4 +75,9 @@ namespace Engine
   {
     glViewport(0, 0, w, h);
   }
+
+  void * OpenGLContext::GetProcAddress(char const * a_name)
+  {
+    return SDL_GL_GetProcAddress(a_name);
+  }
 }
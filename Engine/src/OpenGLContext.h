@@ -24,6 +24,7 @@ namespace Engine
     void SetSDLWindow(SDL_Window *);
     void SwapBuffers() override;
     void Resize(uint32_t w, uint32_t h) override;
+    void * GetProcAddress(char const * name) override;
 
   private:
 
@@ -8,7 +8,27 @@
 //----------------------------------------------------------------------------
 // Switches
 //----------------------------------------------------------------------------
+// Compile in the PROFILE_* macros. The profiler still has to be enabled at runtime.
+#define ENABLE_PROFILER
 
+// Gather the loose uniforms of a shader into a std140 block, filled from a ring of
+// persistently mapped uniform buffers. Otherwise each uniform is set with glUniform*.
+#define ENABLE_MATERIAL_UNIFORM_BLOCKS
+
+// The GUI font atlas rasterises glyphs on a worker thread as they are first drawn, rather
+// than rasterising every glyph in the font at startup.
+#define ENABLE_DYNAMIC_FONT_ATLAS
+
+// The GUI font atlas holds one set of distance field glyphs per font, which are scaled to
+// every text size, instead of a bitmap set per size. Small text is a little softer.
+//#define ENABLE_DISTANCE_FIELD_FONTS
+
+// Save linked shader programs to disk and load them on the next run instead of compiling.
+#define ENABLE_PROGRAM_BINARY_CACHE
+
+// Check for changed shader and texture files once a frame. A shader reload stalls the
+// render thread while the new program compiles, so this is for development. See HotReload.h
+//#define ENABLE_HOT_RELOAD
 
 //----------------------------------------------------------------------------
 // Constants
@@ -19,15 +39,91 @@
 #define LOG_OUTPUT_FILE "log-output.txt"
 #define CRASH_REPORT_FILE "crash-report.txt"
 
+// Worker threads in the JobPool. 0 is one per hardware thread, less one for the main thread.
+#define JOB_POOL_THREAD_COUNT 0
+
 // Renderer...
 #define TEMP_BUFFER_SIZE (16 * 1024 * 1024)
-#define RENDER_COMMAND_BUFFER_SIZE (1 * 1024 * 1024)
-#define RENDER_COMMAND_BUFFER_MEM_POOL (64 * 1024 * 1024)
+// Threads reserve temp buffer memory in slabs of this size
+#define TEMP_BUFFER_SLAB_SIZE (64 * 1024)
+// Render command buffers grow a page at a time
+#define RENDER_COMMAND_BUFFER_PAGE_SIZE (256 * 1024)
+#define RENDER_COMMAND_BUFFER_MEM_PAGE_SIZE (1 * 1024 * 1024)
+
+// How many frames the main thread can get ahead of the render thread
+#define RENDER_FRAMES_IN_FLIGHT 2
+
+// How many frames the GPU can fall behind the render thread. The render thread
+// waits on a fence at the end of each frame to hold it to this.
+#define RENDER_GPU_FRAMES_IN_FLIGHT 1
+
+// A streaming vertex buffer has a region for every frame which may be in use, from
+// the main thread writing it to the GPU reading from it.
+#define STREAMING_BUFFER_REGION_COUNT (RENDER_FRAMES_IN_FLIGHT + RENDER_GPU_FRAMES_IN_FLIGHT + 1)
+
+// Number of threads, other than the main thread, which can submit draw calls into their
+// own buffer. Any more share a single locked buffer.
+#define RENDER_MAX_RECORDING_THREADS 32
+
+// Size of each buffer in the material uniform block ring. There is one per frame in flight.
+#define MATERIAL_UNIFORM_BUFFER_SIZE (1 * 1024 * 1024)
+
+// Where linked program binaries are cached
+#define PROGRAM_BINARY_CACHE_DIR "shader-cache"
+
+// Threads the driver may use to compile shaders, with KHR_parallel_shader_compile.
+// 0xFFFFFFFF lets the driver choose.
+#define SHADER_COMPILER_THREADS 0xFFFFFFFF
+
+// Features a ShaderPermutations can switch on and off. Each variant's feature mask
+// goes in the low bits of its RenderState Material key.
+#define SHADER_MAX_FEATURES 8
+
+// Messages...
+// Each posting thread bump allocates messages from pages of this size
+#define MESSAGE_BUS_PAGE_SIZE (64 * 1024)
+
+// Memory...
+// Number of consecutive clears with low usage before a chunked buffer releases pages
+#define MEMBUFFER_SHRINK_DELAY 120
+
+// Profiler...
+#define PROFILER_EVENT_COUNT (64 * 1024)
+#define PROFILER_MAX_THREADS 64
+// GPU timer queries in flight. Results are read back a few frames late.
+#define PROFILER_GPU_QUERY_COUNT 8
+
+// Threads...
+// How many times a waiting thread yields before going to sleep
+#define THREAD_SIGNAL_SPIN_COUNT 64
+
+// Textures...
+// Where upscaled textures are cached
+#define TEXTURE_CACHE_DIR "texture-cache"
+// Texture processing only adds another slice for every this many rows
+#define TEXTURE_MIN_ROWS_PER_SLICE 32
 
 // Fonts and text...
 #define FONTATLAS_DEFAULT_TEXTURE_DIMENSION 1024
+// Texture memory a dynamic font atlas can use before it evicts the least recently used glyphs
+#define FONTATLAS_DYNAMIC_MEMORY_BUDGET (4 * 1024 * 1024)
+// Empty pixels left after each glyph in a dynamic atlas, so filtering does not bleed
+// neighbouring glyphs in
+#define FONTATLAS_GLYPH_PADDING 1
+// Size distance field glyphs are rasterised at, and how many pixels the field
+// extends past the glyph edge at that size
+#define FONTATLAS_SDF_REFERENCE_SIZE 48
+#define FONTATLAS_SDF_SPREAD 6
+// Font atlases only add another slice of glyphs to rasterise in parallel for every this many glyphs
+#define FONTATLAS_MIN_GLYPHS_PER_LOAD_THREAD 64
 #define MAX_TEXT_CHARACTERS 65536
 
+// GUI...
+// Boxes, outline edges and glyphs the GUI can draw per frame
+#define GUI_MAX_INSTANCES_PER_FRAME (64 * 1024)
+// The GUI flushes its draw calls if more than this are queued
+#define GUI_INSTANCE_BATCH_SIZE (8 * 1024)
+
 //----------------------------------------------------------------------------
 // Logging
 //----------------------------------------------------------------------------
@@ -0,0 +1,183 @@
+//@group Core
+
+#include <chrono>
+#include <fstream>
+
+#include "Profiler.h"
+#include "BSR_Assert.h"
+
+namespace Engine
+{
+  namespace impl
+  {
+    namespace Profiler
+    {
+      // Thread names are kept so the trace can label each row. The last two rows are the
+      // GPU, and one shared by any threads past the limit.
+      static uint32_t const s_overflowThreadID = PROFILER_MAX_THREADS - 2;
+      static std::atomic<uint32_t> threadCount(0);
+      static char const * threadNames[PROFILER_MAX_THREADS] = {};
+      static thread_local uint32_t t_threadID = PROFILER_MAX_THREADS;
+
+      static uint64_t NowMicroseconds()
+      {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+      }
+    }
+  }
+
+  //------------------------------------------------------------------------------------
+  // Profiler
+  //------------------------------------------------------------------------------------
+  Profiler * Profiler::s_instance = nullptr;
+
+  void Profiler::Init()
+  {
+    BSR_ASSERT(s_instance == nullptr, "Trying to initialise twice!");
+    s_instance = new Profiler();
+  }
+
+  void Profiler::ShutDown()
+  {
+    delete s_instance;
+    s_instance = nullptr;
+  }
+
+  Profiler * Profiler::Instance()
+  {
+    return s_instance;
+  }
+
+  Profiler::Profiler()
+    : m_enabled(false)
+    , m_head(0)
+    , m_epoch(impl::Profiler::NowMicroseconds())
+    , m_pEvents(new Event[PROFILER_EVENT_COUNT]())
+  {
+
+  }
+
+  Profiler::~Profiler()
+  {
+    delete[] m_pEvents;
+  }
+
+  uint32_t Profiler::GetThreadID()
+  {
+    if (impl::Profiler::t_threadID == PROFILER_MAX_THREADS)
+    {
+      uint32_t id = impl::Profiler::threadCount.fetch_add(1);
+      if (id > impl::Profiler::s_overflowThreadID)
+        id = impl::Profiler::s_overflowThreadID;
+      impl::Profiler::t_threadID = id;
+    }
+    return impl::Profiler::t_threadID;
+  }
+
+  uint32_t Profiler::GetGPUThreadID()
+  {
+    return PROFILER_MAX_THREADS - 1;
+  }
+
+  void Profiler::SetThreadName(char const * a_name)
+  {
+    uint32_t id = GetThreadID();
+    if (id != impl::Profiler::s_overflowThreadID)
+      impl::Profiler::threadNames[id] = a_name;
+  }
+
+  void Profiler::Enable(bool a_enable)
+  {
+    m_enabled.store(a_enable, std::memory_order_relaxed);
+  }
+
+  bool Profiler::IsEnabled() const
+  {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+
+  uint64_t Profiler::Now() const
+  {
+    return impl::Profiler::NowMicroseconds() - m_epoch;
+  }
+
+  void Profiler::Record(char const * a_name, uint64_t a_tag, uint64_t a_start, uint64_t a_end, uint32_t a_threadID)
+  {
+    uint64_t index = m_head.fetch_add(1, std::memory_order_relaxed) % PROFILER_EVENT_COUNT;
+    Event & event = m_pEvents[index];
+    event.name = a_name;
+    event.tag = a_tag;
+    event.start = a_start;
+    event.duration = a_end - a_start;
+    event.threadID = a_threadID;
+  }
+
+  Dg::ErrorCode Profiler::WriteChromeTrace(std::string const & a_filePath) const
+  {
+    std::ofstream ofs(a_filePath);
+    if (!ofs.good())
+      return Dg::ErrorCode::FailedToOpenFile;
+
+    char const * separator = "\n";
+    ofs << "{\"traceEvents\": [";
+
+    uint32_t threadCount = impl::Profiler::threadCount.load();
+    for (uint32_t i = 0; i < PROFILER_MAX_THREADS; i++)
+    {
+      char const * name = impl::Profiler::threadNames[i];
+      if (i == GetGPUThreadID())
+        name = "GPU";
+      else if (i >= threadCount)
+        continue;
+      else if (i == impl::Profiler::s_overflowThreadID)
+        name = "Other threads";
+
+      ofs << separator << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << i
+          << ", \"args\": {\"name\": \"" << (name == nullptr ? "Thread" : name) << "\"}}";
+      separator = ",\n";
+    }
+
+    uint64_t head = m_head.load();
+    uint64_t count = head < PROFILER_EVENT_COUNT ? head : PROFILER_EVENT_COUNT;
+    for (uint64_t i = head - count; i < head; i++)
+    {
+      Event const & event = m_pEvents[i % PROFILER_EVENT_COUNT];
+      if (event.name == nullptr)
+        continue;
+
+      ofs << separator << "{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << event.threadID
+          << ", \"ts\": " << event.start << ", \"dur\": " << event.duration;
+      if (event.tag != NoTag)
+        ofs << ", \"args\": {\"tag\": " << event.tag << "}";
+      ofs << "}";
+      separator = ",\n";
+    }
+
+    ofs << "\n]}\n";
+    return ofs.good() ? Dg::ErrorCode::None : Dg::ErrorCode::Failure;
+  }
+
+  //------------------------------------------------------------------------------------
+  // ProfileScope
+  //------------------------------------------------------------------------------------
+  ProfileScope::ProfileScope(char const * a_name, uint64_t a_tag)
+    : m_name(a_name)
+    , m_tag(a_tag)
+    , m_start(0)
+  {
+    Profiler * pProfiler = Profiler::Instance();
+    if (pProfiler != nullptr && pProfiler->IsEnabled())
+      m_start = pProfiler->Now() + 1; // 0 marks 'not recording'
+  }
+
+  ProfileScope::~ProfileScope()
+  {
+    if (m_start == 0)
+      return;
+
+    Profiler * pProfiler = Profiler::Instance();
+    if (pProfiler != nullptr)
+      pProfiler->Record(m_name, m_tag, m_start - 1, pProfiler->Now(), Profiler::GetThreadID());
+  }
+}
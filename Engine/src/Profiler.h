@@ -0,0 +1,100 @@
+//@group Core
+
+#ifndef EN_PROFILER_H
+#define EN_PROFILER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+#include "DgError.h"
+#include "Options.h"
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT2(a, b) a ## b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(name) ::Engine::ProfileScope PROFILE_CONCAT(_profileScope, __LINE__)(name)
+#define PROFILE_SCOPE_TAGGED(name, tag) ::Engine::ProfileScope PROFILE_CONCAT(_profileScope, __LINE__)(name, tag)
+#define PROFILE_THREAD(name) ::Engine::Profiler::SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_SCOPE_TAGGED(name, tag)
+#define PROFILE_THREAD(name)
+#endif
+
+namespace Engine
+{
+  // Records timed events from any thread into a ring buffer, which can be written out in
+  // the Chrome trace format (load in chrome://tracing). Recording does not lock. Only the
+  // last PROFILER_EVENT_COUNT events are kept.
+  class Profiler
+  {
+    static Profiler * s_instance;
+
+    Profiler();
+    ~Profiler();
+
+  public:
+
+    static uint64_t const NoTag = 0xFFFFFFFFFFFFFFFFull;
+
+    static void Init();
+    static void ShutDown();
+    static Profiler * Instance();
+
+    // Name the calling thread in the trace. Threads past PROFILER_MAX_THREADS - 2 share
+    // one row, which keeps its own name.
+    static void SetThreadName(char const *);
+    static uint32_t GetThreadID();
+
+    // Events from the GPU are given their own row in the trace
+    static uint32_t GetGPUThreadID();
+
+    void Enable(bool);
+    bool IsEnabled() const;
+
+    // Microseconds since Init()
+    uint64_t Now() const;
+
+    // 'name' must outlive the profiler, eg a string literal.
+    void Record(char const * name, uint64_t tag, uint64_t start, uint64_t end, uint32_t threadID);
+
+    // Best not to record while writing out, or a few events may be torn.
+    Dg::ErrorCode WriteChromeTrace(std::string const & filePath) const;
+
+  private:
+
+    struct Event
+    {
+      char const *  name;
+      uint64_t      tag;
+      uint64_t      start;
+      uint64_t      duration;
+      uint32_t      threadID;
+    };
+
+    std::atomic<bool>     m_enabled;
+    std::atomic<uint64_t> m_head;
+    uint64_t              m_epoch;
+    Event *               m_pEvents;
+  };
+
+  class ProfileScope
+  {
+  public:
+
+    ProfileScope(char const * name, uint64_t tag = Profiler::NoTag);
+    ~ProfileScope();
+
+  private:
+
+    ProfileScope(ProfileScope const &) = delete;
+    ProfileScope & operator=(ProfileScope const &) = delete;
+
+    char const *  m_name;
+    uint64_t      m_tag;
+    uint64_t      m_start;
+  };
+}
+
+#endif
@@ -20,6 +20,8 @@
 #include "RT_Buffer.h"
 #include "RT_RendererAPI.h"
 #include "RT_BindingPoint.h"
+#include "Log.h"
+#include "DgMath.h"
 #include <glad/glad.h>
 
 namespace Engine
@@ -63,10 +65,7 @@ namespace Engine
     , m_usage(a_usage)
   {
     glCreateBuffers(1, &m_rendererID);
-    glNamedBufferData(m_rendererID, m_size, a_data, OpenGLUsage(m_usage));
-
-    if ((a_flags & BF_Mapped) != 0)
-      m_pMappedPointer = glMapNamedBuffer(m_rendererID, GL_WRITE_ONLY);
+    Allocate(a_data, a_flags);
   }
 
   RT_BufferBase::RT_BufferBase(uint32_t a_size, BufferUsage a_usage, uint32_t a_flags)
@@ -76,10 +75,24 @@ namespace Engine
     , m_usage(a_usage)
   {
     glCreateBuffers(1, &m_rendererID);
-    glNamedBufferData(m_rendererID, m_size, nullptr, OpenGLUsage(m_usage));
+    Allocate(nullptr, a_flags);
+  }
 
-    if ((a_flags & BF_Mapped) != 0)
-      m_pMappedPointer = glMapNamedBuffer(m_rendererID, GL_WRITE_ONLY);
+  void RT_BufferBase::Allocate(void * a_data, uint32_t a_flags)
+  {
+    if ((a_flags & BF_Mapped) == 0)
+    {
+      glNamedBufferData(m_rendererID, m_size, a_data, OpenGLUsage(m_usage));
+      return;
+    }
+
+    // Mapped buffers stay mapped for their lifetime, so they can be written to while
+    // the GPU reads from them. SetData() still works on them.
+    GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glNamedBufferStorage(m_rendererID, m_size, a_data, mapFlags | GL_DYNAMIC_STORAGE_BIT);
+    m_pMappedPointer = glMapNamedBufferRange(m_rendererID, 0, m_size, mapFlags);
+    if (m_pMappedPointer == nullptr)
+      LOG_ERROR("RT_BufferBase: Failed to map buffer '{}'!", m_rendererID);
   }
 
   RT_BufferBase::~RT_BufferBase()
@@ -168,26 +181,150 @@ namespace Engine
     return BufferType::Uniform;
   }
 
-  RT_UniformBuffer::RT_UniformBuffer(void * a_data, uint32_t a_size, BufferUsage a_usage)
-    : RT_BufferBase(a_data, a_size, a_usage)
+  RT_UniformBuffer::RT_UniformBuffer(void * a_data, uint32_t a_size, uint32_t a_flags, BufferUsage a_usage)
+    : RT_BufferBase(a_data, a_size, a_usage, a_flags)
   {
 
   }
 
-  RT_UniformBuffer::RT_UniformBuffer(uint32_t a_size, BufferUsage a_usage)
-    : RT_BufferBase(a_size, a_usage)
+  RT_UniformBuffer::RT_UniformBuffer(uint32_t a_size, uint32_t a_flags, BufferUsage a_usage)
+    : RT_BufferBase(a_size, a_usage, a_flags)
   {
 
   }
 
-  RT_UniformBuffer * RT_UniformBuffer::Create(void * a_data, uint32_t a_size, BufferUsage a_usage)
+  RT_UniformBuffer * RT_UniformBuffer::Create(void * a_data, uint32_t a_size, uint32_t a_flags, BufferUsage a_usage)
+  {
+    return new RT_UniformBuffer(a_data, a_size, a_flags, a_usage);
+  }
+
+  RT_UniformBuffer * RT_UniformBuffer::Create(uint32_t a_size, uint32_t a_flags, BufferUsage a_usage)
   {
-    return new RT_UniformBuffer(a_data, a_size, a_usage);
+    return new RT_UniformBuffer(a_size, a_flags, a_usage);
   }
 
-  RT_UniformBuffer * RT_UniformBuffer::Create(uint32_t a_size, BufferUsage a_usage)
+  //------------------------------------------------------------------------------------------------
+  // Uniform Buffer Ring
+  //------------------------------------------------------------------------------------------------
+
+  RT_UniformBufferRing::RT_UniformBufferRing()
+    : m_bound{0, 0, 0, 0}
+    , m_epoch(1)
+    , m_current(0)
+    , m_cursor(0)
+    , m_bufferSize(0)
+    , m_alignment(1)
   {
-    return new RT_UniformBuffer(a_size, a_usage);
+
+  }
+
+  RT_UniformBufferRing::~RT_UniformBufferRing()
+  {
+    Destroy();
+  }
+
+  bool RT_UniformBufferRing::Init(uint32_t a_bufferSize, uint32_t a_bufferCount)
+  {
+    Destroy();
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_alignment = alignment > 0 ? uint32_t(alignment) : 256;
+    m_bufferSize = a_bufferSize;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    for (uint32_t i = 0; i < a_bufferCount; i++)
+    {
+      Buffer buffer = {0, nullptr, nullptr};
+      glCreateBuffers(1, &buffer.rendererID);
+      glNamedBufferStorage(buffer.rendererID, m_bufferSize, nullptr, flags);
+      buffer.pMapped = static_cast<byte *>(glMapNamedBufferRange(buffer.rendererID, 0, m_bufferSize, flags));
+      m_buffers.push_back(buffer);
+
+      if (buffer.pMapped == nullptr)
+      {
+        LOG_ERROR("RT_UniformBufferRing::Init(): Failed to map uniform buffer!");
+        Destroy();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void RT_UniformBufferRing::Destroy()
+  {
+    for (Buffer & buffer : m_buffers)
+    {
+      if (buffer.fence != nullptr)
+        glDeleteSync(static_cast<GLsync>(buffer.fence));
+      if (buffer.pMapped != nullptr)
+        glUnmapNamedBuffer(buffer.rendererID);
+      glDeleteBuffers(1, &buffer.rendererID);
+    }
+    m_buffers.clear();
+    m_current = 0;
+    m_cursor = 0;
+  }
+
+  byte * RT_UniformBufferRing::Allocate(uint32_t a_size, uint32_t & a_offset)
+  {
+    if (m_buffers.empty() || a_size > m_bufferSize)
+      return nullptr;
+
+    uint32_t offset = Dg::ForwardAlign<uint32_t>(m_cursor, m_alignment);
+    if (offset + a_size > m_bufferSize)
+    {
+      NextBuffer();
+      offset = 0;
+    }
+
+    a_offset = offset;
+    m_cursor = offset + a_size;
+    return m_buffers[m_current].pMapped + offset;
+  }
+
+  void RT_UniformBufferRing::BindRange(uint32_t a_bindingIndex, uint32_t a_offset, uint32_t a_size)
+  {
+    if (m_bound.bindingIndex == a_bindingIndex && m_bound.epoch == m_epoch
+      && m_bound.offset == a_offset && m_bound.size == a_size)
+      return;
+
+    m_bound = {a_bindingIndex, m_epoch, a_offset, a_size};
+    glBindBufferRange(GL_UNIFORM_BUFFER, a_bindingIndex, m_buffers[m_current].rendererID, a_offset, a_size);
+  }
+
+  uint64_t RT_UniformBufferRing::GetEpoch() const
+  {
+    return m_epoch;
+  }
+
+  void RT_UniformBufferRing::EndFrame()
+  {
+    if (m_buffers.empty() || m_cursor == 0)
+      return;
+    NextBuffer();
+  }
+
+  void RT_UniformBufferRing::NextBuffer()
+  {
+    Buffer & current = m_buffers[m_current];
+    current.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_current = (m_current + 1) % uint32_t(m_buffers.size());
+    m_cursor = 0;
+    m_epoch++;
+
+    Buffer & next = m_buffers[m_current];
+    if (next.fence == nullptr)
+      return;
+
+    // Only stalls if the GPU is more than a ring behind
+    GLsync fence = static_cast<GLsync>(next.fence);
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (result == GL_TIMEOUT_EXPIRED)
+      result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    glDeleteSync(fence);
+    next.fence = nullptr;
   }
 
   //------------------------------------------------------------------------------------------------
@@ -22,6 +22,7 @@
 #include "Buffer.h"
 #include "RT_RendererAPI.h"
 #include "RT_BindingPoint.h"
+#include "DgDynamicArray.h"
 
 namespace Engine
 {
@@ -67,6 +68,8 @@ namespace Engine
   protected:
     RendererID m_rendererID;
   private:
+    void Allocate(void * data, uint32_t flags);
+
     void * m_pMappedPointer;
     uint32_t m_size;
     BufferUsage m_usage;
@@ -120,15 +123,73 @@ namespace Engine
   {
     BufferType GetType() const override;
 
-    RT_UniformBuffer(void * data, uint32_t size, BufferUsage usage);
-    RT_UniformBuffer(uint32_t size, BufferUsage usage);
+    RT_UniformBuffer(void * data, uint32_t size, uint32_t flags, BufferUsage usage);
+    RT_UniformBuffer(uint32_t size, uint32_t flags, BufferUsage usage);
 
   public:
 
     void Bind(RT_BindingPoint const & a_bp);
 
-    static RT_UniformBuffer * Create(void * data, uint32_t size, BufferUsage usage = BufferUsage::Dynamic);
-    static RT_UniformBuffer * Create(uint32_t size, BufferUsage usage = BufferUsage::Dynamic);
+    static RT_UniformBuffer * Create(void * data, uint32_t size, uint32_t flags, BufferUsage usage = BufferUsage::Dynamic);
+    static RT_UniformBuffer * Create(uint32_t size, uint32_t flags, BufferUsage usage = BufferUsage::Dynamic);
+  };
+
+  //------------------------------------------------------------------------------------------------
+  // Uniform Buffer Ring
+  //------------------------------------------------------------------------------------------------
+
+  // A ring of persistently mapped uniform buffers, to stream small blocks of uniform data.
+  // Each frame sub-allocates from the current buffer. A fence is placed when we move on
+  // from a buffer, and waited on before it is written to again.
+  class RT_UniformBufferRing
+  {
+  public:
+
+    RT_UniformBufferRing();
+    ~RT_UniformBufferRing();
+
+    bool Init(uint32_t bufferSize, uint32_t bufferCount);
+    void Destroy();
+
+    // Returns nullptr if size is larger than a buffer.
+    byte * Allocate(uint32_t size, uint32_t & offset);
+
+    // Bind a range from the current buffer. Does nothing if the range is already bound.
+    void BindRange(uint32_t bindingIndex, uint32_t offset, uint32_t size);
+
+    // Changes each time the ring moves on to the next buffer. Ranges allocated 
+    // in an earlier epoch may have been overwritten.
+    uint64_t GetEpoch() const;
+
+    // Move on to the next buffer. Call once per frame.
+    void EndFrame();
+
+  private:
+
+    void NextBuffer();
+
+    struct Buffer
+    {
+      RendererID  rendererID;
+      byte *      pMapped;
+      void *      fence;
+    };
+
+    struct BoundRange
+    {
+      uint32_t bindingIndex;
+      uint64_t epoch;
+      uint32_t offset;
+      uint32_t size;
+    };
+
+    Dg::DynamicArray<Buffer> m_buffers;
+    BoundRange m_bound;
+    uint64_t m_epoch;
+    uint32_t m_current;
+    uint32_t m_cursor;
+    uint32_t m_bufferSize;
+    uint32_t m_alignment;
   };
 
   //------------------------------------------------------------------------------------------------
@@ -0,0 +1,179 @@
+//@group Renderer/RenderThread
+
+#include <fstream>
+#include <vector>
+#include <filesystem>
+#include <cstdio>
+
+#include "RT_ProgramCache.h"
+#include "Options.h"
+#include "Log.h"
+
+#include "glad/glad.h"
+
+namespace Engine
+{
+  namespace ProgramCache
+  {
+    static uint32_t const s_Magic = 0x42535250; // 'BSRP'
+    static uint32_t const s_Version = 1;
+
+    struct FileHeader
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint64_t key;
+      uint32_t format;
+      uint32_t length;
+    };
+
+    //------------------------------------------------------------------------------------------------
+    // Helpful functions
+    //------------------------------------------------------------------------------------------------
+
+    // FNV-1a
+    static uint64_t Hash(uint64_t a_hash, void const * a_pData, size_t a_size)
+    {
+      unsigned char const * pBytes = static_cast<unsigned char const *>(a_pData);
+      for (size_t i = 0; i < a_size; i++)
+      {
+        a_hash ^= pBytes[i];
+        a_hash *= 0x100000001B3ULL;
+      }
+      return a_hash;
+    }
+
+    static uint64_t Hash(uint64_t a_hash, std::string const & a_str)
+    {
+      // Include the length so moving text between strings changes the hash
+      uint64_t size = a_str.size();
+      a_hash = Hash(a_hash, &size, sizeof(size));
+      return Hash(a_hash, a_str.data(), a_str.size());
+    }
+
+    static std::filesystem::path GetPath(uint64_t a_key)
+    {
+      char name[32] = {};
+      snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(a_key));
+      return std::filesystem::path(PROGRAM_BINARY_CACHE_DIR) / name;
+    }
+
+    //------------------------------------------------------------------------------------------------
+    // ProgramCache
+    //------------------------------------------------------------------------------------------------
+
+    bool IsEnabled()
+    {
+#ifdef ENABLE_PROGRAM_BINARY_CACHE
+      return RendererAPI::GetCapabilities().programBinaryFormats > 0;
+#else
+      return false;
+#endif
+    }
+
+    uint64_t GetKey(ShaderSource const & a_src)
+    {
+      RenderAPICapabilities const & caps = RendererAPI::GetCapabilities();
+
+      uint64_t hash = 0xCBF29CE484222325ULL;
+      hash = Hash(hash, &s_Version, sizeof(s_Version));
+      hash = Hash(hash, caps.vendor);
+      hash = Hash(hash, caps.renderer);
+      hash = Hash(hash, caps.version);
+      for (int i = 0; i < ShaderDomain_COUNT; i++)
+        hash = Hash(hash, a_src.Get(static_cast<ShaderDomain>(i)));
+      return hash;
+    }
+
+    bool Load(uint64_t a_key, RendererID a_program)
+    {
+      std::ifstream ifs(GetPath(a_key), std::ios::binary);
+      if (!ifs.good())
+        return false;
+
+      FileHeader header = {};
+      if (!ifs.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || header.magic != s_Magic
+        || header.version != s_Version
+        || header.key != a_key
+        || header.length == 0)
+      {
+        LOG_WARN("ProgramCache: Ignoring invalid cache file '{}'", GetPath(a_key).string());
+        return false;
+      }
+
+      std::vector<char> binary(header.length);
+      if (!ifs.read(binary.data(), binary.size()))
+      {
+        LOG_WARN("ProgramCache: Cache file '{}' is truncated", GetPath(a_key).string());
+        return false;
+      }
+
+      glProgramBinary(a_program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+      // The driver can reject a binary at any time, eg after an update which does not
+      // change the version string.
+      GLint isLinked = 0;
+      glGetProgramiv(a_program, GL_LINK_STATUS, &isLinked);
+      if (isLinked == GL_FALSE)
+      {
+        LOG_INFO("ProgramCache: Driver rejected the cached binary '{}'", GetPath(a_key).string());
+        return false;
+      }
+
+      return true;
+    }
+
+    void Save(uint64_t a_key, RendererID a_program)
+    {
+      GLint length = 0;
+      glGetProgramiv(a_program, GL_PROGRAM_BINARY_LENGTH, &length);
+      if (length <= 0)
+        return;
+
+      std::vector<char> binary(length);
+      GLenum format = 0;
+      glGetProgramBinary(a_program, length, &length, &format, binary.data());
+      if (length <= 0)
+        return;
+
+      std::error_code ec;
+      std::filesystem::create_directories(PROGRAM_BINARY_CACHE_DIR, ec);
+      if (ec)
+      {
+        LOG_WARN("ProgramCache: Failed to create directory '{}': {}", PROGRAM_BINARY_CACHE_DIR, ec.message());
+        return;
+      }
+
+      FileHeader header = {};
+      header.magic = s_Magic;
+      header.version = s_Version;
+      header.key = a_key;
+      header.format = format;
+      header.length = static_cast<uint32_t>(length);
+
+      // Write to a temporary file first so a crash can never leave a half written binary
+      std::filesystem::path path = GetPath(a_key);
+      std::filesystem::path tempPath = path;
+      tempPath += ".tmp";
+      {
+        std::ofstream ofs(tempPath, std::ios::binary | std::ios::trunc);
+        if (!ofs.write(reinterpret_cast<char const *>(&header), sizeof(header))
+          || !ofs.write(binary.data(), length))
+        {
+          LOG_WARN("ProgramCache: Failed to write '{}'", tempPath.string());
+          ofs.close();
+          std::filesystem::remove(tempPath, ec);
+          return;
+        }
+      }
+
+      std::filesystem::rename(tempPath, path, ec);
+      if (ec)
+      {
+        LOG_WARN("ProgramCache: Failed to write '{}': {}", path.string(), ec.message());
+        std::filesystem::remove(tempPath, ec);
+      }
+    }
+  }
+}
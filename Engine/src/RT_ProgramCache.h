@@ -0,0 +1,35 @@
+//@group Renderer/RenderThread
+
+#ifndef RT_PROGRAMCACHE_H
+#define RT_PROGRAMCACHE_H
+
+#include <stdint.h>
+
+#include "RT_RendererAPI.h"
+#include "ShaderSource.h"
+
+namespace Engine
+{
+  // Linked program binaries are saved to PROGRAM_BINARY_CACHE_DIR, so the next run can
+  // skip compiling and linking. Binaries are keyed by a hash of the shader source and the
+  // driver vendor, renderer and version strings, so a driver update invalidates them.
+  // Render thread only.
+  namespace ProgramCache
+  {
+    // False if the cache is switched off, or the driver has no binary formats.
+    bool IsEnabled();
+
+    uint64_t GetKey(ShaderSource const &);
+
+    // Loads the binary for 'key' into a newly created 'program'. Returns false on a miss,
+    // or if the driver rejects the binary. The program must then be deleted and recreated,
+    // as a rejected glProgramBinary leaves it unlinked.
+    bool Load(uint64_t key, RendererID program);
+
+    // Saves a linked program. Call glProgramParameteri(GL_PROGRAM_BINARY_RETRIEVABLE_HINT)
+    // on the program before linking.
+    void Save(uint64_t key, RendererID program);
+  }
+}
+
+#endif
@@ -20,10 +20,169 @@
 #include "Log.h"
 #include "BSR_Assert.h"
 #include "Framework.h"
+#include "Profiler.h"
+#include "Options.h"
+#include <atomic>
+#include <cstring>
 #include <glad/glad.h>
 
+#define STATE_CACHE_TEXTURE_UNITS 32
+
 namespace Engine
 {
+  //-----------------------------------------------------------------------------------------------
+  // GPU timers
+  //-----------------------------------------------------------------------------------------------
+  namespace impl
+  {
+    namespace GPUTimer
+    {
+      // A ring of GL_TIME_ELAPSED queries. Results are collected once available, so they 
+      // arrive a few frames late. Queries cannot be nested.
+      struct Query
+      {
+        GLuint        id;
+        char const *  name;
+        uint64_t      cpuStart;
+        bool          pending;
+      };
+
+      static Query queries[PROFILER_GPU_QUERY_COUNT];
+      static uint32_t next = 0;
+      static Query * pActive = nullptr;
+
+      static void Collect(Query & a_query)
+      {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(a_query.id, GL_QUERY_RESULT, &elapsed);
+        a_query.pending = false;
+
+        Profiler * pProfiler = Profiler::Instance();
+        if (pProfiler != nullptr)
+          pProfiler->Record(a_query.name, Profiler::NoTag, a_query.cpuStart, a_query.cpuStart + elapsed / 1000, Profiler::GetGPUThreadID());
+      }
+
+      static void Poll()
+      {
+        for (uint32_t i = 0; i < PROFILER_GPU_QUERY_COUNT; i++)
+        {
+          Query & query = queries[i];
+          if (!query.pending || &query == pActive)
+            continue;
+
+          GLint available = 0;
+          glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+          if (available != 0)
+            Collect(query);
+        }
+      }
+    }
+  }
+
+  //-----------------------------------------------------------------------------------------------
+  // Frame fences
+  //-----------------------------------------------------------------------------------------------
+  namespace impl
+  {
+    namespace FrameFence
+    {
+      // A fence is placed at the end of each frame. Once the render thread is more than
+      // RENDER_GPU_FRAMES_IN_FLIGHT frames ahead of the GPU, it waits on the oldest.
+      static GLsync fences[RENDER_GPU_FRAMES_IN_FLIGHT + 1] = {};
+      static uint32_t current = 0;
+
+      static void Wait(GLsync & a_fence)
+      {
+        if (a_fence == nullptr)
+          return;
+
+        GLenum result = glClientWaitSync(a_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+          result = glClientWaitSync(a_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        glDeleteSync(a_fence);
+        a_fence = nullptr;
+      }
+
+      static void Clear()
+      {
+        for (GLsync & fence : fences)
+        {
+          if (fence != nullptr)
+            glDeleteSync(fence);
+          fence = nullptr;
+        }
+        current = 0;
+      }
+    }
+  }
+
+  //-----------------------------------------------------------------------------------------------
+  // State cache
+  //-----------------------------------------------------------------------------------------------
+  namespace impl
+  {
+    namespace StateCache
+    {
+      // Features can be in an unknown state before they are first set
+      enum : int8_t
+      {
+        Unknown = -1,
+        Disabled = 0,
+        Enabled = 1
+      };
+
+      static RendererID program = INVALID_RENDERER_ID;
+      static RendererID vertexArray = INVALID_RENDERER_ID;
+      static RendererID textures[STATE_CACHE_TEXTURE_UNITS];
+      static int sissorBox[4];
+      static bool sissorBoxValid = false;
+      static int8_t features[static_cast<size_t>(RenderFeature::COUNT)];
+
+      static RenderAPIStats frameStats = {};
+      static std::atomic<uint32_t> lastBindsIssued(0);
+      static std::atomic<uint32_t> lastBindsElided(0);
+
+      static void Reset()
+      {
+        program = INVALID_RENDERER_ID;
+        vertexArray = INVALID_RENDERER_ID;
+        for (size_t i = 0; i < STATE_CACHE_TEXTURE_UNITS; i++)
+          textures[i] = INVALID_RENDERER_ID;
+        sissorBoxValid = false;
+        for (size_t i = 0; i < static_cast<size_t>(RenderFeature::COUNT); i++)
+          features[i] = Unknown;
+        frameStats = {};
+      }
+
+      // Returns true if the call should be issued
+      static bool Update(RendererID & a_current, RendererID a_new)
+      {
+        if (a_current == a_new)
+        {
+          frameStats.bindsElided++;
+          return false;
+        }
+        a_current = a_new;
+        frameStats.bindsIssued++;
+        return true;
+      }
+
+      static bool UpdateFeature(RenderFeature a_feature, bool a_enable)
+      {
+        int8_t & current = features[static_cast<size_t>(a_feature)];
+        int8_t val = a_enable ? Enabled : Disabled;
+        if (current == val)
+        {
+          frameStats.bindsElided++;
+          return false;
+        }
+        current = val;
+        frameStats.bindsIssued++;
+        return true;
+      }
+    }
+  }
+
   static void OpenGLLogMessage(GLenum a_source, GLenum a_type, GLuint a_id, GLenum a_severity, 
                                GLsizei a_length, const GLchar* a_message, const void* a_userParam)
   {
@@ -56,6 +215,43 @@ namespace Engine
     return s_Values[static_cast<size_t>(a_type)];
   }
 
+  //-----------------------------------------------------------------------------------------------
+  // Extensions
+  //-----------------------------------------------------------------------------------------------
+  typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+  static bool HasExtension(char const * a_name)
+  {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+      char const * pExt = (char const *)glGetStringi(GL_EXTENSIONS, i);
+      if (pExt != nullptr && strcmp(pExt, a_name) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  static void InitParallelShaderCompile(RenderAPICapabilities & a_caps)
+  {
+    char const * pFnName = nullptr;
+    if (HasExtension("GL_KHR_parallel_shader_compile"))
+      pFnName = "glMaxShaderCompilerThreadsKHR";
+    else if (HasExtension("GL_ARB_parallel_shader_compile"))
+      pFnName = "glMaxShaderCompilerThreadsARB";
+
+    if (pFnName == nullptr)
+      return;
+
+    a_caps.parallelShaderCompile = true;
+
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC pFn = 
+      (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)Framework::Instance()->GetGraphicsContext()->GetProcAddress(pFnName);
+    if (pFn != nullptr)
+      pFn(SHADER_COMPILER_THREADS);
+  }
+
   RenderAPICapabilities::RenderAPICapabilities()
     : vendor()
     , renderer()
@@ -73,21 +269,30 @@ namespace Engine
     , maxGeometryShaderStorageBlocks(-1)
     , maxShaderStorageBlockSize(-1)
     , maxShaderStorageBufferBindings(-1)
+    , programBinaryFormats(0)
+    , parallelShaderCompile(false)
   {
 
   }
 
   void RendererAPI::Init()
   {
+    impl::StateCache::Reset();
+
+    for (uint32_t i = 0; i < PROFILER_GPU_QUERY_COUNT; i++)
+    {
+      glGenQueries(1, &impl::GPUTimer::queries[i].id);
+      impl::GPUTimer::queries[i].pending = false;
+    }
+
     glDebugMessageCallback(OpenGLLogMessage, nullptr);
     glEnable(GL_DEBUG_OUTPUT);
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 
     unsigned int vao;
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    BindVertexArray(vao);
 
-    glEnable(GL_DEPTH_TEST);
     //glEnable(GL_CULL_FACE);
     //glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
     glFrontFace(GL_CCW);
@@ -116,6 +321,9 @@ namespace Engine
     glGetIntegerv(GL_MAX_FRAGMENT_SHADER_STORAGE_BLOCKS, &caps.maxFragmentShaderStorageBlocks);
     glGetIntegerv(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &caps.maxShaderStorageBlockSize);
     glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &caps.maxShaderStorageBufferBindings);
+
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &caps.programBinaryFormats);
+    InitParallelShaderCompile(caps);
     
     GLenum error = glGetError();
     while (error != GL_NO_ERROR)
@@ -130,6 +338,123 @@ namespace Engine
 
   void RendererAPI::ShutDown()
   {
+    impl::StateCache::Reset();
+
+    for (uint32_t i = 0; i < PROFILER_GPU_QUERY_COUNT; i++)
+      glDeleteQueries(1, &impl::GPUTimer::queries[i].id);
+    impl::GPUTimer::pActive = nullptr;
+
+    impl::FrameFence::Clear();
+  }
+
+  void RendererAPI::BeginGPUTimer(char const * a_name)
+  {
+    BSR_ASSERT(impl::GPUTimer::pActive == nullptr, "GPU timers cannot be nested!");
+
+    Profiler * pProfiler = Profiler::Instance();
+    if (pProfiler == nullptr || !pProfiler->IsEnabled())
+      return;
+
+    impl::GPUTimer::Query & query = impl::GPUTimer::queries[impl::GPUTimer::next];
+    if (query.pending)
+    {
+      // The GPU is far behind. Skip rather than stall.
+      GLint available = 0;
+      glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (available == 0)
+        return;
+      impl::GPUTimer::Collect(query);
+    }
+
+    query.name = a_name;
+    query.cpuStart = pProfiler->Now();
+    query.pending = true;
+    glBeginQuery(GL_TIME_ELAPSED, query.id);
+
+    impl::GPUTimer::pActive = &query;
+    impl::GPUTimer::next = (impl::GPUTimer::next + 1) % PROFILER_GPU_QUERY_COUNT;
+  }
+
+  void RendererAPI::EndGPUTimer()
+  {
+    if (impl::GPUTimer::pActive == nullptr)
+      return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    impl::GPUTimer::pActive = nullptr;
+  }
+
+  void RendererAPI::EndFrame()
+  {
+    impl::GPUTimer::Poll();
+
+    impl::FrameFence::fences[impl::FrameFence::current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    impl::FrameFence::current = (impl::FrameFence::current + 1) % (RENDER_GPU_FRAMES_IN_FLIGHT + 1);
+    impl::FrameFence::Wait(impl::FrameFence::fences[impl::FrameFence::current]);
+
+    impl::StateCache::lastBindsIssued = impl::StateCache::frameStats.bindsIssued;
+    impl::StateCache::lastBindsElided = impl::StateCache::frameStats.bindsElided;
+    impl::StateCache::frameStats = {};
+  }
+
+  RenderAPIStats RendererAPI::GetFrameStats()
+  {
+    RenderAPIStats stats;
+    stats.bindsIssued = impl::StateCache::lastBindsIssued;
+    stats.bindsElided = impl::StateCache::lastBindsElided;
+    return stats;
+  }
+
+  void RendererAPI::BindProgram(RendererID a_id)
+  {
+    if (impl::StateCache::Update(impl::StateCache::program, a_id))
+      glUseProgram(a_id);
+  }
+
+  void RendererAPI::BindVertexArray(RendererID a_id)
+  {
+    if (impl::StateCache::Update(impl::StateCache::vertexArray, a_id))
+      glBindVertexArray(a_id);
+  }
+
+  void RendererAPI::BindTexture(uint32_t a_unit, RendererID a_id)
+  {
+    if (a_unit >= STATE_CACHE_TEXTURE_UNITS)
+    {
+      impl::StateCache::frameStats.bindsIssued++;
+      glBindTextureUnit(a_unit, a_id);
+      return;
+    }
+
+    if (impl::StateCache::Update(impl::StateCache::textures[a_unit], a_id))
+      glBindTextureUnit(a_unit, a_id);
+  }
+
+  void RendererAPI::InvalidateProgram(RendererID a_id)
+  {
+    if (impl::StateCache::program == a_id)
+      impl::StateCache::program = INVALID_RENDERER_ID;
+  }
+
+  void RendererAPI::InvalidateVertexArray(RendererID a_id)
+  {
+    if (impl::StateCache::vertexArray == a_id)
+      impl::StateCache::vertexArray = INVALID_RENDERER_ID;
+  }
+
+  void RendererAPI::InvalidateTexture(RendererID a_id)
+  {
+    for (size_t i = 0; i < STATE_CACHE_TEXTURE_UNITS; i++)
+    {
+      if (impl::StateCache::textures[i] == a_id)
+        impl::StateCache::textures[i] = INVALID_RENDERER_ID;
+    }
+  }
+
+  void RendererAPI::InvalidateTextureUnit(uint32_t a_unit)
+  {
+    if (a_unit < STATE_CACHE_TEXTURE_UNITS)
+      impl::StateCache::textures[a_unit] = INVALID_RENDERER_ID;
   }
 
   void RendererAPI::LoadRequiredAssets()
@@ -152,9 +477,13 @@ namespace Engine
     glClearColor(r, g, b, a);
   }
 
-  void RendererAPI::DrawIndexed(RenderMode a_mode, IndexDataType a_dataType, uint32_t a_instanceCount, uint32_t a_elementCount)
+  void RendererAPI::DrawIndexed(RenderMode a_mode, IndexDataType a_dataType, uint32_t a_instanceCount, uint32_t a_elementCount,
+                                uint32_t a_baseVertex, uint32_t a_baseInstance)
   {
-    if (a_instanceCount < 2)
+    if (a_baseVertex != 0 || a_baseInstance != 0)
+      glDrawElementsInstancedBaseVertexBaseInstance(GetOpenGLMode(a_mode), a_elementCount, GetOpenGLIndexDataType(a_dataType), nullptr,
+                                                    a_instanceCount == 0 ? 1 : a_instanceCount, GLint(a_baseVertex), a_baseInstance);
+    else if (a_instanceCount < 2)
       glDrawElements(GetOpenGLMode(a_mode), a_elementCount, GetOpenGLIndexDataType(a_dataType), nullptr);
     else
       glDrawElementsInstanced(GetOpenGLMode(a_mode), a_elementCount, GetOpenGLIndexDataType(a_dataType), nullptr, a_instanceCount);
@@ -170,13 +499,31 @@ namespace Engine
 
     int wh, ww;
     Framework::Instance()->GetWindow()->GetDimensions(ww, wh);
-    glScissor(x, wh - y - h, w, h);
+
+    int box[4] = {x, wh - y - h, w, h};
+    int * current = impl::StateCache::sissorBox;
+    if (impl::StateCache::sissorBoxValid
+      && current[0] == box[0] && current[1] == box[1] && current[2] == box[2] && current[3] == box[3])
+    {
+      impl::StateCache::frameStats.bindsElided++;
+      return;
+    }
+
+    for (int i = 0; i < 4; i++)
+      current[i] = box[i];
+    impl::StateCache::sissorBoxValid = true;
+    impl::StateCache::frameStats.bindsIssued++;
+
+    glScissor(box[0], box[1], box[2], box[3]);
   }
 
   void RendererAPI::Enable(RenderFeature a_feature)
   {
     BSR_ASSERT(a_feature != RenderFeature::COUNT);
 
+    if (!impl::StateCache::UpdateFeature(a_feature, true))
+      return;
+
     switch (a_feature)
     {
       case RenderFeature::Sissor:
@@ -196,6 +543,9 @@ namespace Engine
   {
     BSR_ASSERT(a_feature != RenderFeature::COUNT);
 
+    if (!impl::StateCache::UpdateFeature(a_feature, false))
+      return;
+
     switch (a_feature)
     {
       case RenderFeature::Sissor:
@@ -52,6 +52,20 @@ namespace Engine
     int maxGeometryShaderStorageBlocks;
     int maxShaderStorageBlockSize;
     int maxShaderStorageBufferBindings;
+
+    // Number of formats glGetProgramBinary can return. Zero if binaries are not supported.
+    int programBinaryFormats;
+
+    // KHR_parallel_shader_compile or ARB_parallel_shader_compile. Programs can be polled 
+    // with GL_COMPLETION_STATUS_KHR and compile on driver threads.
+    bool parallelShaderCompile;
+  };
+
+  // Counts the state changes which pass through the RendererAPI state cache.
+  struct RenderAPIStats
+  {
+    uint32_t bindsIssued;
+    uint32_t bindsElided;
   };
 
   class RendererAPI
@@ -62,13 +76,39 @@ namespace Engine
     static void Init();
     static void ShutDown();
 
+    // Render thread. Call at the end of each frame to publish the frame stats. Also fences
+    // the frame, and waits if the GPU is more than RENDER_GPU_FRAMES_IN_FLIGHT frames behind.
+    static void EndFrame();
+
+    // The stats of the last completed frame. Can be called from any thread.
+    static RenderAPIStats GetFrameStats();
+
+    // Render thread. Time GPU work with a GL_TIME_ELAPSED query and send the result to the
+    // Profiler once it is ready. Does nothing if the profiler is off. Cannot be nested.
+    // 'name' must outlive the profiler, eg a string literal.
+    static void BeginGPUTimer(char const * name);
+    static void EndGPUTimer();
+
+    // The RendererAPI keeps track of the currently bound objects and drops
+    // any calls which would not change the GL state.
+    static void BindProgram(RendererID);
+    static void BindVertexArray(RendererID);
+    static void BindTexture(uint32_t unit, RendererID);
+
+    // Let the cache know an object has been deleted or bound outside of the RendererAPI.
+    static void InvalidateProgram(RendererID);
+    static void InvalidateVertexArray(RendererID);
+    static void InvalidateTexture(RendererID);
+    static void InvalidateTextureUnit(uint32_t unit);
+
     static void Clear();
     static void Clear(float r, float g, float b, float a);
     static void SetClearColor(float r, float g, float b, float a);
     static void SetSissorBox(int x, int y, int w, int h);
     static void Enable(RenderFeature);
     static void Disable(RenderFeature);
-    static void DrawIndexed(RenderMode, IndexDataType, uint32_t instanceCount, uint32_t elementCount);
+    static void DrawIndexed(RenderMode, IndexDataType, uint32_t instanceCount, uint32_t elementCount,
+                            uint32_t baseVertex = 0, uint32_t baseInstance = 0);
 
     static void LoadRequiredAssets();
 
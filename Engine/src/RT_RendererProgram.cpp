@@ -19,6 +19,7 @@
 //#include <fstream>
 
 #include "RT_RendererProgram.h"
+#include "RT_ProgramCache.h"
 #include "RT_Texture.h"
 #include "RenderThreadData.h"
 #include "DgError.h"
@@ -31,6 +32,10 @@
 
 #include "glad/glad.h"
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 //TODO Parse uniform blocks, shader storage blocks
 
 namespace Engine
@@ -46,24 +51,35 @@ namespace Engine
   //
   //}
 
-  RT_RendererProgram::RT_RendererProgram(ResourceID a_shaderDataID)
+  RT_RendererProgram::RT_RendererProgram(ShaderData const * a_pShaderData, ResourceID a_shaderDataID, RenderResourceID a_fallbackID)
     : m_rendererID(0)
+    , m_status(Status::Compiling)
+    , m_fallbackID(a_fallbackID)
+    , m_shaderDataID(a_shaderDataID)
+    , m_shaders()
+    , m_cacheKey(0)
+    , m_saveToCache(false)
+    , m_pShaderData(a_pShaderData)
+    , m_materialID(0)
+    , m_materialGeneration(0)
+    , m_blockEpoch(0)
+    , m_blockOffset(0)
   {
-    m_pShaderData = ResourceManager::Instance()->GetResource<ShaderData>(a_shaderDataID);
     if (m_pShaderData == nullptr)
     {
       LOG_WARN("RT_RendererProgram failed to find shader data resource!");
       throw;
     }
 
-    if (!CompileAndUploadShader())
+    if (!BeginCompile())
       throw;
-
-    ResolveUniforms();
   }
 
   RT_RendererProgram::~RT_RendererProgram()
   {
+    for (RendererID id : m_shaders)
+      glDeleteShader(id);
+    RendererAPI::InvalidateProgram(m_rendererID);
     glDeleteProgram(m_rendererID);
     m_rendererID = 0;
     m_uniformLocations.clear();
@@ -71,21 +87,27 @@ namespace Engine
 
   void RT_RendererProgram::Bind() const
   {
-    glUseProgram(m_rendererID);
+    RendererAPI::BindProgram(m_rendererID);
   }
 
   void RT_RendererProgram::Unbind() const
   {
-    glUseProgram(0);
+    RendererAPI::BindProgram(0);
   }
 
-  RT_RendererProgram * RT_RendererProgram::Create(ResourceID a_shaderDataID)
+  RT_RendererProgram * RT_RendererProgram::Create(ResourceID a_shaderDataID, RenderResourceID a_fallbackID)
+  {
+    ShaderData const * pShaderData = ResourceManager::Instance()->GetResource<ShaderData>(a_shaderDataID);
+    return Create(pShaderData, a_shaderDataID, a_fallbackID);
+  }
+
+  RT_RendererProgram * RT_RendererProgram::Create(ShaderData const * a_pShaderData, ResourceID a_shaderDataID, RenderResourceID a_fallbackID)
   {
     RT_RendererProgram * pResult = nullptr;
 
     try
     {
-      pResult = new RT_RendererProgram(a_shaderDataID);
+      pResult = new RT_RendererProgram(a_pShaderData, a_shaderDataID, a_fallbackID);
     }
     catch (...)
     {
@@ -95,15 +117,76 @@ namespace Engine
     return pResult;
   }
 
-  bool RT_RendererProgram::CompileAndUploadShader()
+  bool RT_RendererProgram::IsReady()
+  {
+    if (m_status != Status::Compiling)
+      return m_status == Status::Ready;
+
+    if (RendererAPI::GetCapabilities().parallelShaderCompile)
+    {
+      GLint isComplete = GL_FALSE;
+      glGetProgramiv(m_rendererID, GL_COMPLETION_STATUS_KHR, &isComplete);
+      if (isComplete == GL_FALSE)
+        return false;
+    }
+
+    m_status = FinishCompile() ? Status::Ready : Status::Failed;
+    return m_status == Status::Ready;
+  }
+
+  bool RT_RendererProgram::WaitUntilReady()
+  {
+    if (m_status == Status::Compiling)
+      m_status = FinishCompile() ? Status::Ready : Status::Failed;
+    return m_status == Status::Ready;
+  }
+
+  RT_RendererProgram::Status RT_RendererProgram::GetStatus() const
+  {
+    return m_status;
+  }
+
+  RenderResourceID RT_RendererProgram::GetFallbackID() const
+  {
+    return m_fallbackID;
+  }
+
+  ResourceID RT_RendererProgram::GetShaderDataID() const
+  {
+    return m_shaderDataID;
+  }
+
+  ShaderData const * RT_RendererProgram::GetShaderData() const
+  {
+    return m_pShaderData;
+  }
+
+  bool RT_RendererProgram::BeginCompile()
   {
     if (m_pShaderData == nullptr)
       return false;
 
-    bool result = true;
-    Dg::DynamicArray<GLuint> shaderRendererIDs;
+    bool useCache = ProgramCache::IsEnabled();
 
     GLuint program = glCreateProgram();
+    if (useCache)
+    {
+      m_cacheKey = ProgramCache::GetKey(m_pShaderData->GetShaderSource());
+      if (ProgramCache::Load(m_cacheKey, program))
+      {
+        m_rendererID = program;
+        return true;
+      }
+
+      // Start again with a clean program, a rejected binary can leave it unusable
+      glDeleteProgram(program);
+      program = glCreateProgram();
+      glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+      m_saveToCache = true;
+    }
+
+    // Nothing is queried here. Asking for the compile status would make the driver 
+    // finish the work before we can do anything else.
     for (int i = 0; i < ShaderDomain_COUNT; i++)
     {
       GLenum type = ShaderDomainToOpenGLType(ShaderDomain(i));
@@ -116,64 +199,72 @@ namespace Engine
       GLuint shaderRendererID = glCreateShader(type);
       GLchar const * sourceCstr = (GLchar const *)source.c_str();
       glShaderSource(shaderRendererID, 1, &sourceCstr, 0);
-
       glCompileShader(shaderRendererID);
 
+      m_shaders.push_back(shaderRendererID);
+      glAttachShader(program, shaderRendererID);
+    }
+
+    glLinkProgram(program);
+    m_rendererID = program;
+
+    return true;
+  }
+
+  bool RT_RendererProgram::FinishCompile()
+  {
+    bool result = true;
+
+    for (RendererID id : m_shaders)
+    {
       GLint isCompiled = 0;
-      glGetShaderiv(shaderRendererID, GL_COMPILE_STATUS, &isCompiled);
+      glGetShaderiv(id, GL_COMPILE_STATUS, &isCompiled);
       if (isCompiled == GL_FALSE)
       {
         GLint maxLength = 0;
-        glGetShaderiv(shaderRendererID, GL_INFO_LOG_LENGTH, &maxLength);
+        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &maxLength);
 
         // The maxLength includes the NULL character
-        std::vector<GLchar> infoLog(maxLength);
-        glGetShaderInfoLog(shaderRendererID, maxLength, &maxLength, &infoLog[0]);
+        std::vector<GLchar> infoLog(maxLength + 1);
+        glGetShaderInfoLog(id, maxLength, &maxLength, &infoLog[0]);
 
         LOG_ERROR("Shader compilation failed:\n{0}", &infoLog[0]);
-
-        // We don't need the shader anymore.
-        glDeleteShader(shaderRendererID);
-
-        BSR_ASSERT(false, "Failed");
         result = false;
       }
-
-      shaderRendererIDs.push_back(shaderRendererID);
-      glAttachShader(program, shaderRendererID);
     }
 
-    // Link our program
-    glLinkProgram(program);
-
     // Note the different functions here: glGetProgram* instead of glGetShader*.
     GLint isLinked = 0;
-    glGetProgramiv(program, GL_LINK_STATUS, (int*)&isLinked);
-    if (isLinked == GL_FALSE)
+    glGetProgramiv(m_rendererID, GL_LINK_STATUS, (int*)&isLinked);
+    if (result && isLinked == GL_FALSE)
     {
       GLint maxLength = 0;
-      glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+      glGetProgramiv(m_rendererID, GL_INFO_LOG_LENGTH, &maxLength);
 
       // The maxLength includes the NULL character
-      std::vector<GLchar> infoLog(maxLength);
-      glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
+      std::vector<GLchar> infoLog(maxLength + 1);
+      glGetProgramInfoLog(m_rendererID, maxLength, &maxLength, &infoLog[0]);
       LOG_ERROR("Shader compilation failed:\n{0}", &infoLog[0]);
-
-      // We don't need the program anymore.
-      glDeleteProgram(program);
-      // Don't leak shaders either.
-      for (auto id : shaderRendererIDs)
-        glDeleteShader(id);
       result = false;
     }
 
-    // Always detach shaders after a successful link.
-    for (auto id : shaderRendererIDs)
-      glDetachShader(program, id);
+    // Always detach shaders after a link. We don't need them anymore.
+    for (RendererID id : m_shaders)
+    {
+      glDetachShader(m_rendererID, id);
+      glDeleteShader(id);
+    }
+    m_shaders.clear();
 
-    m_rendererID = program;
+    if (!result)
+      return false;
 
-    return result;
+    if (m_saveToCache)
+      ProgramCache::Save(m_cacheKey, m_rendererID);
+
+    BindUniformBlock();
+    ResolveUniforms();
+    return true;
   }
 
   void RT_RendererProgram::ResolveUniforms()
@@ -181,7 +272,7 @@ namespace Engine
     if (m_pShaderData == nullptr)
       return;
 
-    glUseProgram(m_rendererID);
+    Bind();
 
     int32_t sampler = 0;
     Index ind = 0;
@@ -210,6 +301,10 @@ namespace Engine
           delete[] samplers;
         }
       }
+      else if (it->IsInBlock())
+      {
+        m_uniformLocations.push_back(-1);
+      }
       else
       {
         m_uniformLocations.push_back(GetUniformLocation(it->GetName()));
@@ -218,6 +313,49 @@ namespace Engine
     }
   }
 
+  void RT_RendererProgram::BindUniformBlock()
+  {
+    if (m_pShaderData == nullptr || m_pShaderData->GetUniformBlockSize() == 0)
+      return;
+
+    GLuint index = glGetUniformBlockIndex(m_rendererID, ShaderData::UniformBlockName());
+    if (index == GL_INVALID_INDEX)
+    {
+      // Every uniform in the block may have been optimised out
+      LOG_WARN("Could not find uniform block '{}' in shader", ShaderData::UniformBlockName());
+      return;
+    }
+
+    glUniformBlockBinding(m_rendererID, index, RenderThreadData::Instance()->materialBindingPoint.Address());
+  }
+
+  bool RT_RendererProgram::UploadUniformBlock(byte const * a_pbuf, bool a_reuse)
+  {
+    uint32_t size = m_pShaderData->GetUniformBlockSize();
+    RenderThreadData * pData = RenderThreadData::Instance();
+
+    // The last block we wrote is still good until the ring moves on
+    if (a_reuse && m_blockEpoch == pData->materialUniforms.GetEpoch())
+    {
+      pData->materialUniforms.BindRange(pData->materialBindingPoint.Address(), m_blockOffset, size);
+      return true;
+    }
+
+    uint32_t offset = 0;
+    byte * pBlock = pData->materialUniforms.Allocate(size, offset);
+    if (pBlock == nullptr)
+    {
+      LOG_WARN("RT_RendererProgram::UploadUniformBlock(): Failed to allocate {} bytes from the uniform ring!", size);
+      return false;
+    }
+
+    m_pShaderData->PackUniformBlock(a_pbuf, pBlock);
+    pData->materialUniforms.BindRange(pData->materialBindingPoint.Address(), offset, size);
+    m_blockEpoch = pData->materialUniforms.GetEpoch();
+    m_blockOffset = offset;
+    return true;
+  }
+
   int32_t RT_RendererProgram::GetUniformLocation(std::string const& a_name) const
   {
     int32_t result = glGetUniformLocation(m_rendererID, a_name.c_str());
@@ -243,14 +381,49 @@ namespace Engine
 
   void RT_RendererProgram::UploadUniformBuffer(byte const* a_pbuf)
   {
-    if (m_pShaderData == nullptr || a_pbuf == nullptr)
+    UniformBufferVersion version = {};
+    UploadUniformBuffer(a_pbuf, version);
+  }
+
+  void RT_RendererProgram::UploadUniformBuffer(byte const* a_pbuf, UniformBufferVersion const & a_version)
+  {
+    if (m_pShaderData == nullptr || a_pbuf == nullptr || m_status != Status::Ready)
       return;
 
     Bind();
 
+    bool sameMaterial = a_version.materialID != 0 && a_version.materialID == m_materialID;
+    bool upToDate = sameMaterial && a_version.generation == m_materialGeneration;
+    bool partial = sameMaterial && a_version.pDirty != nullptr && a_version.baseGeneration == m_materialGeneration;
+
+    bool uploaded = true;
+    if (m_pShaderData->GetUniformBlockSize() != 0)
+      uploaded = UploadUniformBlock(a_pbuf, upToDate);
+
+    m_materialID = uploaded ? a_version.materialID : 0;
+    m_materialGeneration = a_version.generation;
+
+    UploadUniforms(a_pbuf, upToDate, partial ? a_version.pDirty : nullptr);
+  }
+
+  void RT_RendererProgram::UploadUniforms(byte const * a_pbuf, bool a_upToDate, uint32_t const * a_pDirty)
+  {
     for (uint32_t i = 0; i < (uint32_t)m_pShaderData->GetUniforms().size(); i++)
     {
       ShaderUniformDeclaration const * pdecl = &m_pShaderData->GetUniforms()[i];
+      if (pdecl->IsInBlock())
+        continue;
+
+      // Loose uniforms keep their values in the program. Texture units are shared 
+      // between programs so are always bound, the RendererAPI drops redundant binds.
+      if (pdecl->GetType() != ShaderDataType::TEXTURE2D)
+      {
+        if (a_upToDate)
+          continue;
+        if (a_pDirty != nullptr && (a_pDirty[i / 32] & (1u << (i % 32))) == 0)
+          continue;
+      }
+
       uint32_t offset = pdecl->GetDataOffset();
       UniformBufferElementHeader header;
       void const * buf = header.Deserialize(a_pbuf + offset);
@@ -338,7 +511,7 @@ namespace Engine
 
   void RT_RendererProgram::UploadUniform(std::string const& a_name, void const* a_pbuf, uint32_t a_size)
   {
-    if (m_pShaderData == nullptr || a_pbuf == nullptr)
+    if (m_pShaderData == nullptr || a_pbuf == nullptr || m_status != Status::Ready)
       return;
 
     uint32_t index = m_pShaderData->FindUniformIndex(a_name);
@@ -349,9 +522,18 @@ namespace Engine
     }
 
     ShaderUniformDeclaration const * pdecl = &m_pShaderData->GetUniforms()[index];
+    if (pdecl->IsInBlock())
+    {
+      LOG_WARN("Uniform '{}' is in the material uniform block. Set it through a Material.", a_name.c_str());
+      return;
+    }
+
     uint32_t elementSize = SizeOfShaderDataType(pdecl->GetType());
     uint32_t count = a_size / elementSize;
 
+    // The program no longer matches any material version
+    m_materialID = 0;
+
     Bind();
     UploadUniform(index, a_pbuf, count);
   }
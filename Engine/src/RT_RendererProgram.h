@@ -27,6 +27,8 @@
 #include "RT_RendererAPI.h"
 #include "ShaderSource.h"
 #include "ResourceManager.h"
+#include "RendererProgram.h"
+#include "RenderResource.h"
 
 namespace Engine
 {
@@ -37,13 +39,39 @@ namespace Engine
     typedef uint32_t Index;
 
     //RT_RendererProgram();
-    RT_RendererProgram(ResourceID shaderDataID);
+    RT_RendererProgram(ShaderData const *, ResourceID shaderDataID, RenderResourceID fallbackID);
 
   public:
 
+    enum class Status
+    {
+      Compiling,
+      Ready,
+      Failed
+    };
+
     ~RT_RendererProgram();
 
-    static RT_RendererProgram * Create(ResourceID shaderDataID);
+    // Compiling and linking is started here, but the result is not asked for until the 
+    // program is first needed. 'fallbackID' is drawn with in the meantime, and must use
+    // the same uniform layout.
+    static RT_RendererProgram * Create(ResourceID shaderDataID, RenderResourceID fallbackID = INVALID_RENDER_RESOURE_ID);
+
+    // Build the program from other shader data, eg reloaded from disk, but still report 
+    // 'shaderDataID' from GetShaderDataID().
+    static RT_RendererProgram * Create(ShaderData const *, ResourceID shaderDataID, RenderResourceID fallbackID);
+
+    // Returns false while the program is still compiling, or if it failed. With
+    // KHR_parallel_shader_compile this never blocks. Otherwise the first call waits
+    // for the driver to finish.
+    bool IsReady();
+    Status GetStatus() const;
+    RenderResourceID GetFallbackID() const;
+    ResourceID GetShaderDataID() const;
+    ShaderData const * GetShaderData() const;
+
+    // As IsReady(), but waits for the driver if it is still compiling.
+    bool WaitUntilReady();
 
     void Bind() const;
     void Unbind() const;
@@ -56,10 +84,18 @@ namespace Engine
     */
     void UploadUniformBuffer(byte const* data);
 
+    // Skips the upload if this program already has this version of the material.
+    // If only some uniforms have changed since the version it has, only those are sent.
+    void UploadUniformBuffer(byte const* data, UniformBufferVersion const &);
+
   private:
 
-    bool CompileAndUploadShader();
+    bool BeginCompile();
+    bool FinishCompile();
     void ResolveUniforms();
+    void BindUniformBlock();
+    bool UploadUniformBlock(byte const * data, bool reuse);
+    void UploadUniforms(byte const * data, bool upToDate, uint32_t const * pDirty);
 
     //bool Bind(ShaderDomain, std::string const & name, RT_BindingPoint const &);
 
@@ -72,10 +108,26 @@ namespace Engine
   private:
 
     RendererID m_rendererID;
+    Status m_status;
+    RenderResourceID m_fallbackID;
+    ResourceID m_shaderDataID;
+
+    // Shaders attached to the program until the link finishes
+    std::vector<RendererID> m_shaders;
+    uint64_t m_cacheKey;
+    bool m_saveToCache;
 
     std::string m_name;
     ShaderData const * m_pShaderData;
     std::vector<int32_t> m_uniformLocations;
+
+    // The material version last uploaded
+    uint64_t m_materialID;
+    uint32_t m_materialGeneration;
+
+    // Where the uniform block was last written in the ring
+    uint64_t m_blockEpoch;
+    uint32_t m_blockOffset;
   };
 }
 
@@ -38,9 +38,36 @@ namespace Engine
     }
   }
 
-  RT_Texture2D::RT_Texture2D(TextureData const & a_data)
+  static GLenum GetGLFormat(TexturePixelType a_val)
+  {
+    switch (a_val)
+    {
+      case TexturePixelType::R8:    return GL_RED;
+      case TexturePixelType::RG8:   return GL_RG;
+      case TexturePixelType::RGB8:  return GL_RGB;
+      default:                      return GL_RGBA;
+    }
+  }
+
+  static GLint GetGLInternalFormat(TexturePixelType a_val)
+  {
+    switch (a_val)
+    {
+      case TexturePixelType::R8:    return GL_R8;
+      case TexturePixelType::RG8:   return GL_RG8;
+      case TexturePixelType::RGB8:  return GL_RGB8;
+      case TexturePixelType::RGBA8: return GL_RGBA8;
+      default:
+      {
+        BSR_ASSERT(false, "Pixel type not yet implemented!");
+        return GL_RGBA8;
+      }
+    }
+  }
+
+  RT_Texture2D::RT_Texture2D(TextureData const * a_pLevels, uint32_t a_levelCount)
     : m_rendererID(0)
-    , m_attrs(a_data.attrs)
+    , m_attrs(a_pLevels[0].attrs)
   {
     glCreateTextures(GL_TEXTURE_2D, 1, &m_rendererID);
     glBindTexture(GL_TEXTURE_2D, m_rendererID);
@@ -55,54 +82,55 @@ namespace Engine
     else
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GetGL(m_attrs.GetFilter()));
 
-    switch (m_attrs.GetPixelType())
+    // Small mip levels are not 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < a_levelCount; i++)
     {
-      case TexturePixelType::R8:
-      {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, a_data.width, a_data.height, 0, GL_RED, GL_UNSIGNED_BYTE, a_data.pPixels);
-        break;
-      }
-      case TexturePixelType::RG8:
-      {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, a_data.width, a_data.height, 0, GL_RG, GL_UNSIGNED_BYTE, a_data.pPixels);
-        break;
-      }
-      case TexturePixelType::RGB8:
-      {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, a_data.width, a_data.height, 0, GL_RGB, GL_UNSIGNED_BYTE, a_data.pPixels);
-        break;
-      }
-      case TexturePixelType::RGBA8:
-      {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, a_data.width, a_data.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, a_data.pPixels);
-        break;
-      }
-      default:
-      {
-        BSR_ASSERT(false, "Pixel type not yet implemented!");
-      }
+      TextureData const & level = a_pLevels[i];
+      glTexImage2D(GL_TEXTURE_2D, GLint(i), GetGLInternalFormat(m_attrs.GetPixelType()), level.width, level.height, 0,
+        GetGLFormat(m_attrs.GetPixelType()), GL_UNSIGNED_BYTE, level.pPixels);
     }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     if (m_attrs.IsMipmapped())
-      glGenerateMipmap(GL_TEXTURE_2D);
+    {
+      if (a_levelCount > 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(a_levelCount - 1));
+      else
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
 
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    // We have just bound to the active texture unit without going through the RendererAPI
+    RendererAPI::InvalidateTextureUnit(0);
   }
 
   RT_Texture2D::~RT_Texture2D()
   {
-    GLuint count = 1;
-    glDeleteTextures(m_rendererID, &count);
+    RendererAPI::InvalidateTexture(m_rendererID);
+    glDeleteTextures(1, &m_rendererID);
     m_rendererID = 0;
   }
 
-  RT_Texture2D * RT_Texture2D::Create(TextureData const & a_data)
+  RT_Texture2D * RT_Texture2D::Create(TextureData const * a_pLevels, uint32_t a_levelCount)
   {
-    return new RT_Texture2D(a_data);
+    return new RT_Texture2D(a_pLevels, a_levelCount);
   }
 
   void RT_Texture2D::Bind(uint32_t a_slot)
   {
-    glBindTextureUnit(a_slot, m_rendererID);
+    RendererAPI::BindTexture(a_slot, m_rendererID);
+  }
+
+  void RT_Texture2D::SetSubData(uint32_t a_x, uint32_t a_y, uint32_t a_width, uint32_t a_height, void const * a_pPixels)
+  {
+    // Rows of a sub region are tightly packed, so need not be 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTextureSubImage2D(m_rendererID, 0, a_x, a_y, a_width, a_height, GetGLFormat(m_attrs.GetPixelType()), GL_UNSIGNED_BYTE, a_pPixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (m_attrs.IsMipmapped())
+      glGenerateTextureMipmap(m_rendererID);
   }
 }
\ No newline at end of file
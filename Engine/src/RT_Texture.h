@@ -10,14 +10,16 @@ namespace Engine
 {
   class RT_Texture2D
   {
-    RT_Texture2D(TextureData const & a_data);
+    RT_Texture2D(TextureData const * a_pLevels, uint32_t a_levelCount);
   public:
 
     ~RT_Texture2D();
 
-    static RT_Texture2D * Create(TextureData const &);
+    // If the texture is mipmapped, and only level 0 is given, the driver generates the rest.
+    static RT_Texture2D * Create(TextureData const * pLevels, uint32_t levelCount = 1);
 
     void Bind(uint32_t slot = 0);
+    void SetSubData(uint32_t x, uint32_t y, uint32_t width, uint32_t height, void const * pPixels);
 
   private:
     RendererID    m_rendererID;
@@ -35,6 +35,7 @@ namespace Engine
 
   RT_VertexArray::~RT_VertexArray()
   {
+    RendererAPI::InvalidateVertexArray(m_rendererID);
     glDeleteVertexArrays(1, &m_rendererID);
   }
 
@@ -45,12 +46,12 @@ namespace Engine
 
   void RT_VertexArray::Bind() const
   {
-    glBindVertexArray(m_rendererID);
+    RendererAPI::BindVertexArray(m_rendererID);
   }
 
   void RT_VertexArray::Unbind() const
   {
-    glBindVertexArray(0);
+    RendererAPI::BindVertexArray(0);
   }
 
   void RT_VertexArray::SetVertexAttributeDivisor(uint32_t a_attrIndex, uint32_t a_divisor)
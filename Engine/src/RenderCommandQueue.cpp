@@ -16,48 +16,257 @@
   Copyright 2017-2019 Frank Hart <frankhart010@gmail.com>
 */
 
+#include <utility>
+#include <algorithm>
+#include <vector>
+
 #include "RenderCommandQueue.h"
 #include "Log.h"
+#include "BSR_Assert.h"
+#include "Profiler.h"
 
 namespace Engine
 {
-  RenderCommandQueue::Buffer::Buffer(size_t a_size)
-    : buf(a_size)
+  namespace impl
+  {
+    static std::atomic<uint64_t> s_nextQueueID(0);
+
+    // Ids of the queues which have not been destroyed, so an exiting thread knows 
+    // whether it can still hand its slots back.
+    static std::mutex s_liveQueuesMutex;
+    static std::vector<uint64_t> s_liveQueues;
+
+    // The slots this thread records into, one for each queue it has recorded into.
+    // Released back to their queues when the thread exits.
+    struct ThreadRecorder
+    {
+      struct Entry
+      {
+        uint64_t  queueID;
+        int       slot;
+        std::atomic<RenderCommandQueue::SlotState> * pSlotState; // nullptr for the main thread and overflow slots
+      };
+
+      ~ThreadRecorder()
+      {
+        std::lock_guard<std::mutex> lock(s_liveQueuesMutex);
+        for (auto const & entry : entries)
+        {
+          if (entry.pSlotState == nullptr)
+            continue;
+          if (std::find(s_liveQueues.begin(), s_liveQueues.end(), entry.queueID) != s_liveQueues.end())
+            entry.pSlotState->store(RenderCommandQueue::SlotState::Released);
+        }
+      }
+
+      Entry * Find(uint64_t a_queueID)
+      {
+        for (auto & entry : entries)
+        {
+          if (entry.queueID == a_queueID)
+            return &entry;
+        }
+        return nullptr;
+      }
+
+      std::vector<Entry> entries;
+    };
+
+    static thread_local ThreadRecorder t_recorder;
+  }
+
+  RenderCommandQueue::ThreadBuffer::ThreadBuffer()
+    : buf(s_cmdBufPageSize)
+    , mem(s_memBufPageSize)
+    , merged(0)
   {
 
   }
 
+  void RenderCommandQueue::ThreadBuffer::Clear()
+  {
+    buf.clear();
+    mem.clear();
+    allocs.clear();
+    merged = 0;
+  }
+
+  RenderCommandQueue::Buffer::Buffer()
+    : buf(s_cmdBufPageSize)
+    , mem(s_memBufPageSize)
+    , threadBuffers{}
+  {
+
+  }
+
+  RenderCommandQueue::Buffer::~Buffer()
+  {
+    for (int i = 0; i < s_threadBufferCount; i++)
+      delete threadBuffers[i];
+  }
+
   void RenderCommandQueue::Buffer::Clear()
   {
     buf.clear();
+    mem.clear();
     allocs.clear();
+    groups.clear();
+
+    for (int i = 0; i < s_threadBufferCount; i++)
+    {
+      if (threadBuffers[i] != nullptr)
+        threadBuffers[i]->Clear();
+    }
   }
 
   RenderCommandQueue::RenderCommandQueue()
-    : m_commandBuffer{Buffer(s_cmdBufSize), Buffer(s_cmdBufSize)}
-    , m_mem{MemBuffer(s_memBufSize), MemBuffer(s_memBufSize)}
+    : m_commandBuffer()
     , m_writeIndex(0)
+    , m_readIndex(0)
+    , m_frameStats{}
+    , m_id(++impl::s_nextQueueID)
+    , m_mainThread(std::this_thread::get_id())
   {
+    for (int i = 0; i < RENDER_MAX_RECORDING_THREADS; i++)
+      m_slotState[i].store(SlotState::Free);
 
+    std::lock_guard<std::mutex> lock(impl::s_liveQueuesMutex);
+    impl::s_liveQueues.push_back(m_id);
   }
 
   RenderCommandQueue::~RenderCommandQueue()
   {
+    std::lock_guard<std::mutex> lock(impl::s_liveQueuesMutex);
+    impl::s_liveQueues.erase(std::find(impl::s_liveQueues.begin(), impl::s_liveQueues.end(), m_id));
+  }
 
+  bool RenderCommandQueue::ClaimSlot(int a_slot)
+  {
+    SlotState state = SlotState::Free;
+    return m_slotState[a_slot].compare_exchange_strong(state, SlotState::Taken);
+  }
+
+  int RenderCommandQueue::ClaimFreeSlot()
+  {
+    for (int slot = RENDER_MAX_RECORDING_THREADS - 1; slot >= 0; slot--)
+    {
+      if (ClaimSlot(slot))
+        return slot;
+    }
+
+    LOG_WARN("Too many threads recording render commands! Falling back to a shared buffer.");
+    return s_overflowSlot;
+  }
+
+  bool RenderCommandQueue::SetThreadSlot(int a_slot)
+  {
+    BSR_ASSERT(std::this_thread::get_id() != m_mainThread, "The main thread does not record into a slot");
+
+    impl::ThreadRecorder::Entry const * pEntry = impl::t_recorder.Find(m_id);
+    if (pEntry != nullptr)
+    {
+      if (pEntry->slot == a_slot)
+        return true;
+      LOG_ERROR("This thread already records into render command slot {}.", pEntry->slot);
+      return false;
+    }
+
+    bool result = a_slot >= 0 && a_slot < RENDER_MAX_RECORDING_THREADS && ClaimSlot(a_slot);
+    if (!result)
+      LOG_ERROR("Render command slot {} is out of range or taken. Falling back to a shared buffer.", a_slot);
+
+    SetRecorderSlot(result ? a_slot : s_overflowSlot);
+    return result;
+  }
+
+  // Entries of queues which have been destroyed are dropped here, so threads which
+  // outlive many queues do not collect them.
+  void RenderCommandQueue::SetRecorderSlot(int a_slot)
+  {
+    auto & entries = impl::t_recorder.entries;
+    {
+      std::lock_guard<std::mutex> lock(impl::s_liveQueuesMutex);
+      entries.erase(std::remove_if(entries.begin(), entries.end(), [](impl::ThreadRecorder::Entry const & a_entry)
+        {
+          return std::find(impl::s_liveQueues.begin(), impl::s_liveQueues.end(), a_entry.queueID) == impl::s_liveQueues.end();
+        }), entries.end());
+    }
+
+    std::atomic<SlotState> * pSlotState = nullptr;
+    if (a_slot != s_mainThreadSlot && a_slot != s_overflowSlot)
+      pSlotState = &m_slotState[a_slot];
+    entries.push_back(impl::ThreadRecorder::Entry{m_id, a_slot, pSlotState});
+  }
+
+  int RenderCommandQueue::GetThreadSlot()
+  {
+    impl::ThreadRecorder::Entry const * pEntry = impl::t_recorder.Find(m_id);
+    if (pEntry != nullptr)
+      return pEntry->slot;
+
+    int slot = s_mainThreadSlot;
+    if (std::this_thread::get_id() != m_mainThread)
+      slot = ClaimFreeSlot();
+    SetRecorderSlot(slot);
+    return slot;
+  }
+
+  // Only the thread owning the slot touches its buffer, so creating it here is safe. The
+  // overflow buffer is shared, so callers must hold m_overflowMutex.
+  RenderCommandQueue::ThreadBuffer & RenderCommandQueue::GetThreadBuffer(int a_slot)
+  {
+    Buffer & cmdBuf = m_commandBuffer[m_writeIndex];
+    if (cmdBuf.threadBuffers[a_slot] == nullptr)
+      cmdBuf.threadBuffers[a_slot] = new ThreadBuffer();
+    return *cmdBuf.threadBuffers[a_slot];
+  }
+
+  bool RenderCommandQueue::IsMainThread()
+  {
+    return GetThreadSlot() == s_mainThreadSlot;
   }
 
   void * RenderCommandQueue::Allocate(uint32_t a_size)
   {
-    return m_mem[m_writeIndex].Allocate(a_size);
+    int slot = GetThreadSlot();
+    if (slot == s_mainThreadSlot)
+      return m_commandBuffer[m_writeIndex].mem.Allocate(a_size);
+
+    std::unique_lock<std::mutex> lock(m_overflowMutex, std::defer_lock);
+    if (slot == s_overflowSlot)
+      lock.lock();
+    return GetThreadBuffer(slot).mem.Allocate(a_size);
   }
 
-  //Main thread (producer)...
+  //Producers...
   void* RenderCommandQueue::AllocateForCommand(RenderState a_state, 
                                                RenderCommandFn a_fn, 
-                                               uint32_t a_size)
+                                               uint32_t a_size,
+                                               Group::IDType a_group)
   {
-    void* ptr = m_commandBuffer[m_writeIndex].buf.Allocate(sizeof(RenderState) + sizeof(RenderCommandFn) + a_size);
-    m_commandBuffer[m_writeIndex].allocs.push_back(ptr);
+    size_t size = sizeof(RenderState) + sizeof(RenderCommandFn) + a_size;
+    void * ptr = nullptr;
+
+    int slot = GetThreadSlot();
+    if (slot == s_mainThreadSlot)
+    {
+      ptr = m_commandBuffer[m_writeIndex].buf.Allocate(size);
+      m_commandBuffer[m_writeIndex].allocs.push_back(ptr);
+      m_commandBuffer[m_writeIndex].groups.push_back(a_group);
+    }
+    else
+    {
+      BSR_ASSERT(a_state.Get<RenderState::Attr::Type>() == RenderState::Type::DrawCall
+        && a_group == Group::NONE, "Only ungrouped draw calls can be recorded off the main thread");
+
+      std::unique_lock<std::mutex> lock(m_overflowMutex, std::defer_lock);
+      if (slot == s_overflowSlot)
+        lock.lock();
+
+      ThreadBuffer & threadBuf = GetThreadBuffer(slot);
+      ptr = threadBuf.buf.Allocate(size);
+      threadBuf.allocs.push_back(ptr);
+    }
 
     *static_cast<RenderState*>(ptr) = a_state;
     ptr = static_cast<void*>(static_cast<byte*>(ptr) + sizeof(RenderState));
@@ -68,18 +277,69 @@ namespace Engine
     return ptr;
   }
 
+  // The merged commands are left in their thread buffers; only pointers are moved into 
+  // the command stream. They are released when the buffer is next cleared.
+  void RenderCommandQueue::MergeThreadCommands()
+  {
+    Buffer & cmdBuf = m_commandBuffer[m_writeIndex];
+
+    m_mergeCommands.clear();
+    m_mergeItems.clear();
+    for (int i = 0; i < s_threadBufferCount; i++)
+    {
+      ThreadBuffer * pThreadBuf = cmdBuf.threadBuffers[i];
+      if (pThreadBuf == nullptr)
+        continue;
+
+      for (uint32_t c = pThreadBuf->merged; c < (uint32_t)pThreadBuf->allocs.size(); c++)
+      {
+        void * ptr = pThreadBuf->allocs[c];
+        SortItem item = {static_cast<RenderState const *>(ptr)->GetKey(), (uint32_t)m_mergeCommands.size()};
+        m_mergeItems.push_back(item);
+        m_mergeCommands.push_back(ptr);
+      }
+      pThreadBuf->merged = (uint32_t)pThreadBuf->allocs.size();
+    }
+
+    // Everything recorded by threads which have exited has been taken, so their slots
+    // can go to new threads.
+    for (int i = 0; i < RENDER_MAX_RECORDING_THREADS; i++)
+    {
+      SlotState state = SlotState::Released;
+      m_slotState[i].compare_exchange_strong(state, SlotState::Free);
+    }
+
+    uint32_t count = (uint32_t)m_mergeItems.size();
+    if (count == 0)
+      return;
+
+    if (m_mergeTemp.mem_block_size() < count)
+      m_mergeTemp.resize(count);
+
+    SortItem const * pSorted = RadixSort(m_mergeItems.data(), m_mergeTemp.data(), count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      cmdBuf.allocs.push_back(m_mergeCommands[pSorted[i].index]);
+      cmdBuf.groups.push_back(Group::NONE);
+    }
+  }
+
   //Render thread (consumer)...
   //The render thread could just repeat this...
   void RenderCommandQueue::Execute()
   {
     Sort();
 
-    int readInd = (m_writeIndex + 1) & 1;
+    int readInd = m_readIndex;
     for (size_t i = 0; i < m_sortedCommands.size(); i++)
     {
       uint32_t ind = m_sortedCommands[i];
 
       void * ptr = m_commandBuffer[readInd].allocs[ind];
+      RenderState const * pState = static_cast<RenderState const *>(ptr);
+      PROFILE_SCOPE_TAGGED(pState->Get<RenderState::Attr::Type>() == RenderState::Type::Command 
+        ? RenderState::CommandToString(pState->Get<RenderState::Attr::Command>()) : "DrawCall", pState->GetKey());
+
       ptr = static_cast<void*>(static_cast<byte*>(ptr) + sizeof(RenderState));
 
       RenderCommandFn function = *(RenderCommandFn*)ptr;
@@ -87,35 +347,138 @@ namespace Engine
 
       function(ptr);
     }
+
+    m_readIndex = (m_readIndex + 1) % s_bufferCount;
   }
 
   void RenderCommandQueue::Swap()
   {
-    m_writeIndex = (m_writeIndex + 1) & 1;
-    m_commandBuffer[m_writeIndex].Clear();
-    m_mem[m_writeIndex].clear();
-  }
+    Buffer const & written = m_commandBuffer[m_writeIndex];
+    m_frameStats.commandCount = written.allocs.size();
+    m_frameStats.commandBytes = written.buf.size();
+    m_frameStats.commandCapacity = written.buf.capacity();
+    m_frameStats.dataBytes = written.mem.size();
+    m_frameStats.dataCapacity = written.mem.capacity();
 
-  void RenderCommandQueue::PushCriterion(Ref<RenderSortCriterion> a_crit)
-  {
-    m_sortCriterion.push_back(a_crit);
+    for (int i = 0; i < s_threadBufferCount; i++)
+    {
+      ThreadBuffer const * pThreadBuf = written.threadBuffers[i];
+      if (pThreadBuf == nullptr)
+        continue;
+
+      BSR_ASSERT(pThreadBuf->merged == pThreadBuf->allocs.size(), "Render commands recorded on a thread were never merged!");
+      m_frameStats.commandBytes += pThreadBuf->buf.size();
+      m_frameStats.commandCapacity += pThreadBuf->buf.capacity();
+      m_frameStats.dataBytes += pThreadBuf->mem.size();
+      m_frameStats.dataCapacity += pThreadBuf->mem.capacity();
+    }
+
+    m_writeIndex = (m_writeIndex + 1) % s_bufferCount;
+    m_commandBuffer[m_writeIndex].Clear();
   }
 
-  void RenderCommandQueue::ClearCriterion()
+  RenderCommandQueue::FrameStats RenderCommandQueue::GetFrameStats() const
   {
-    m_sortCriterion.clear();
+    return m_frameStats;
   }
 
   void RenderCommandQueue::Sort()
   {
-    //No sort for now...
+    PROFILE_SCOPE("SortRenderCommands");
+
+    Buffer & cmdBuf = m_commandBuffer[m_readIndex];
+    uint32_t count = (uint32_t)cmdBuf.allocs.size();
+
     m_sortedCommands.clear();
-    int readInd = (m_writeIndex + 1) & 1;
-    for (uint32_t i = 0; i < (uint32_t)m_commandBuffer[readInd].allocs.size(); i++)
+    m_sortableSegs.clear();
+
+    // Draw calls are self contained, so a run of them can be reordered freely. Any other
+    // command might change the render state and so ends the run. Draw calls inside a
+    // group keep their submission order.
+    SubArray seg = {0, 0};
+    for (uint32_t i = 0; i < count; i++)
     {
       m_sortedCommands.push_back(i);
+
+      RenderState const * pState = static_cast<RenderState const *>(cmdBuf.allocs[i]);
+      if (pState->Get<RenderState::Attr::Type>() == RenderState::Type::DrawCall
+        && cmdBuf.groups[i] == Group::NONE)
+      {
+        if (seg.count == 0)
+          seg.index = i;
+        seg.count++;
+        continue;
+      }
+
+      if (seg.count > 1)
+        m_sortableSegs.push_back(seg);
+      seg.count = 0;
     }
 
-    m_sortableSegs.clear();
+    if (seg.count > 1)
+      m_sortableSegs.push_back(seg);
+
+    for (size_t i = 0; i < m_sortableSegs.size(); i++)
+      RadixSort(cmdBuf, m_sortableSegs[i]);
+  }
+
+  void RenderCommandQueue::RadixSort(Buffer & a_cmdBuf, SubArray const & a_seg)
+  {
+    m_sortItems.clear();
+    for (uint32_t i = 0; i < a_seg.count; i++)
+    {
+      uint32_t ind = m_sortedCommands[a_seg.index + i];
+      RenderState const * pState = static_cast<RenderState const *>(a_cmdBuf.allocs[ind]);
+
+      SortItem item = {pState->GetKey(), ind};
+      m_sortItems.push_back(item);
+    }
+
+    if (m_sortTemp.mem_block_size() < a_seg.count)
+      m_sortTemp.resize(a_seg.count);
+
+    SortItem const * pSorted = RadixSort(m_sortItems.data(), m_sortTemp.data(), a_seg.count);
+    for (uint32_t i = 0; i < a_seg.count; i++)
+      m_sortedCommands[a_seg.index + i] = pSorted[i].index;
+  }
+
+  // Stable LSD radix sort on the 64-bit state, one byte per pass. A pass is skipped if
+  // every key shares the same digit, which is common as most draw calls in a run only
+  // differ in a few fields. Returns whichever of the two arrays holds the result.
+  RenderCommandQueue::SortItem * RenderCommandQueue::RadixSort(SortItem * a_pItems, SortItem * a_pTemp, uint32_t a_count)
+  {
+    uint32_t const passes = sizeof(uint64_t);
+    uint32_t histogram[passes][256] = {};
+
+    for (uint32_t i = 0; i < a_count; i++)
+    {
+      for (uint32_t p = 0; p < passes; p++)
+        histogram[p][(a_pItems[i].key >> (p * 8)) & 0xFF]++;
+    }
+
+    SortItem * pSrc = a_pItems;
+    SortItem * pDst = a_pTemp;
+
+    for (uint32_t p = 0; p < passes; p++)
+    {
+      uint32_t shift = p * 8;
+      if (histogram[p][(pSrc[0].key >> shift) & 0xFF] == a_count)
+        continue;
+
+      uint32_t offsets[256];
+      uint32_t total = 0;
+      for (uint32_t b = 0; b < 256; b++)
+      {
+        offsets[b] = total;
+        total += histogram[p][b];
+      }
+
+      for (uint32_t i = 0; i < a_count; i++)
+        pDst[offsets[(pSrc[i].key >> shift) & 0xFF]++] = pSrc[i];
+
+      std::swap(pSrc, pDst);
+    }
+
+    return pSrc;
   }
-}
\ No newline at end of file
+}
@@ -21,40 +21,81 @@
 
 #include "Memory.h"
 #include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
 
 #include "DgDynamicArray.h"
 #include "PODArray.h"
 #include "RenderState.h"
+#include "Group.h"
 #include "MemBuffer.h"
 #include "options.h"
 
 namespace Engine
 {
-  class RenderSortCriterion
-  {
-
-  };
-
   typedef void(*RenderCommandFn)(void*);
 
+  namespace impl
+  {
+    struct ThreadRecorder;
+  }
+
   class RenderCommandQueue
   {
-    static size_t const s_cmdBufSize = RENDER_COMMAND_BUFFER_SIZE;
-    static size_t const s_memBufSize = RENDER_COMMAND_BUFFER_MEM_POOL;
+    friend struct impl::ThreadRecorder;
+
+    static size_t const s_cmdBufPageSize = RENDER_COMMAND_BUFFER_PAGE_SIZE;
+    static size_t const s_memBufPageSize = RENDER_COMMAND_BUFFER_MEM_PAGE_SIZE;
+
+    // One buffer being written, the rest queued up for the render thread
+    static int const s_bufferCount = RENDER_FRAMES_IN_FLIGHT + 1;
+
+  public:
+
+    // One frame of commands. Sizes are in bytes.
+    struct FrameStats
+    {
+      size_t commandCount;
+      size_t commandBytes;
+      size_t commandCapacity;
+      size_t dataBytes;
+      size_t dataCapacity;
+    };
 
   public:
 
     RenderCommandQueue();
     ~RenderCommandQueue();
 
-    //Main thread...
-    void * AllocateForCommand(RenderState, RenderCommandFn, uint32_t size);
+    //Any thread. Commands from the main thread (the thread which created the queue) go
+    //straight into the command stream. Other threads record into their own buffers
+    //and may only submit draw calls, without a group.
+    void * AllocateForCommand(RenderState, RenderCommandFn, uint32_t size, Group::IDType group = Group::NONE);
     void* Allocate(uint32_t size);
-    void PushCriterion(Ref<RenderSortCriterion>);
-    void ClearCriterion();
-
-    //Render thread
+    bool IsMainThread();
+
+    //Any thread other than the main thread, before it first records. Threads which do not
+    //call this claim a free slot, counting down from the top, when they first record. As
+    //merged draw calls with equal state are ordered by slot, give each worker a fixed slot
+    //(its index in the worker pool, say) if the order must be the same from run to run.
+    //Returns false if the slot is out of range or taken, in which case the thread shares
+    //a locked overflow buffer with any others that could not get a slot.
+    bool SetThreadSlot(int slot);
+
+    //Main thread. Moves draw calls recorded on other threads into the command stream at
+    //this point, sorted by state. Ties are ordered by slot, then submission. Slots of
+    //threads which have exited are freed once their commands have been taken.
+    //Threads must not be recording while this, or Swap(), is called.
+    void MergeThreadCommands();
+
+    //Main thread. Move on to the next buffer. The RenderThread makes sure it is free.
     void Swap();
+
+    //Main thread. Stats for the last buffer passed to Swap().
+    FrameStats GetFrameStats() const;
+
+    //Render thread. Execute the next queued buffer.
     void Sort();
     void Execute();
 
@@ -66,22 +107,75 @@ namespace Engine
       uint32_t count;
     };
 
+    struct SortItem
+    {
+      uint64_t key;
+      uint32_t index;
+    };
+
+    // Commands recorded by one thread other than the main thread
+    struct ThreadBuffer
+    {
+      ThreadBuffer();
+      void Clear();
+
+      MemBufferChunked        buf;
+      MemBufferChunked        mem;
+      PODArray<void*>         allocs;
+      uint32_t                merged;
+    };
+
     struct Buffer
     {
-      Buffer(size_t memBufSize);
+      Buffer();
+      ~Buffer();
       void Clear();
 
-      MemBuffer       buf;
-      PODArray<void*> allocs;
+      MemBufferChunked        buf;
+      MemBufferChunked        mem;
+      PODArray<void*>         allocs;
+      PODArray<Group::IDType> groups;
+      ThreadBuffer *          threadBuffers[RENDER_MAX_RECORDING_THREADS + 1];
+    };
+
+    // A slot is released when its thread exits, and only freed for another thread once
+    // MergeThreadCommands() has taken what was recorded into it.
+    enum class SlotState
+    {
+      Free,
+      Taken,
+      Released
     };
 
+    static int const s_mainThreadSlot = -1;
+    static int const s_overflowSlot = RENDER_MAX_RECORDING_THREADS;
+    static int const s_threadBufferCount = RENDER_MAX_RECORDING_THREADS + 1;
+
+    bool ClaimSlot(int slot);
+    int ClaimFreeSlot();
+    void SetRecorderSlot(int slot);
+    int GetThreadSlot();
+    ThreadBuffer & GetThreadBuffer(int slot);
+    void RadixSort(Buffer &, SubArray const &);
+    static SortItem * RadixSort(SortItem * pItems, SortItem * pTemp, uint32_t count);
+
     PODArray<uint32_t>  m_sortedCommands;
+    PODArray<SortItem>  m_sortItems;
+    PODArray<SortItem>  m_sortTemp;
     int                 m_writeIndex;
-    Buffer              m_commandBuffer[2];
-    MemBuffer           m_mem[2];
-
-    Dg::DynamicArray<Ref<RenderSortCriterion>> m_sortCriterion;
-    PODArray<SubArray>                         m_sortableSegs;
+    int                 m_readIndex;
+    Buffer              m_commandBuffer[s_bufferCount];
+    FrameStats          m_frameStats;
+
+    uint64_t const          m_id;
+    std::thread::id const   m_mainThread;
+    std::atomic<SlotState>  m_slotState[RENDER_MAX_RECORDING_THREADS];
+    std::mutex              m_overflowMutex;
+    PODArray<void*>         m_mergeCommands;
+    PODArray<SortItem>      m_mergeItems;
+    PODArray<SortItem>      m_mergeTemp;
+
+    PODArray<SubArray>      m_sortableSegs;
 
   };
 }
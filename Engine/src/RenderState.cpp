@@ -29,6 +29,32 @@ namespace Engine
     return Dg::GetSubInt<uint64_t>(m_data, bitBegin, bitCount);
   }
 
+  uint64_t RenderState::GetKey() const
+  {
+    if (Get<Attr::Type>() != Type::DrawCall || Get<Attr::Translucency>() == Translucency::None)
+      return m_data;
+
+    uint64_t depth = Dg::Mask<uint64_t, 0, Count::Depth>::value - Get<Attr::Depth>();
+
+    uint64_t key = m_data & ~Dg::Mask<uint64_t, 0, Begin::Translucency>::value;
+    key |= depth << (Begin::Translucency - Count::Depth);
+    key |= Get<Attr::Material>() << Count::VAO;
+    key |= Get<Attr::VAO>();
+    return key;
+  }
+
+  char const * RenderState::CommandToString(uint64_t a_command)
+  {
+    switch (a_command)
+    {
+#undef ITEM
+#define ITEM(x) case Command::x: return #x;
+      RENDER_STATE_COMMANDS
+#undef ITEM
+    }
+    return "Unknown";
+  }
+
   uint64_t RenderState::ComputeNormalizedDepth(float a_min, float a_max, float a_val)
   {
     float val = a_val - a_min;
@@ -17,6 +17,49 @@
  ITEM(VAO)\
  ITEM(Material)\
 
+#define RENDER_STATE_COMMANDS \
+ ITEM(None)\
+ ITEM(Resize)\
+ ITEM(SwapWindow)\
+ ITEM(SetClearColor)\
+ ITEM(SetSissor)\
+ ITEM(EnableDepthTest)\
+ ITEM(DisableDepthTest)\
+ ITEM(EnableFeature)\
+ ITEM(DisableFeature)\
+ ITEM(Clear)\
+ ITEM(Draw)\
+ ITEM(BufferCreate)\
+ ITEM(BufferDelete)\
+ ITEM(BufferSetData)\
+ ITEM(BufferBind)\
+ ITEM(BufferSetLayout)\
+ ITEM(Buffer_END)\
+ ITEM(VertexArray)\
+ ITEM(VertexArrayCreate)\
+ ITEM(VertexArrayDelete)\
+ ITEM(VertexArrayBind)\
+ ITEM(VertexArrayUnbind)\
+ ITEM(VertexArrayAddVertexBuffer)\
+ ITEM(VertexArraySetIndexBuffer)\
+ ITEM(VertexArray_END)\
+ ITEM(IndexedBufferBind)\
+ ITEM(BindingPointCreate)\
+ ITEM(BindingPointDelete)\
+ ITEM(RendererProgramCreate)\
+ ITEM(RendererProgramDelete)\
+ ITEM(RendererProgramInit)\
+ ITEM(RendererProgramDestroy)\
+ ITEM(RendererProgramBind)\
+ ITEM(RendererProgramUnbind)\
+ ITEM(RendererProgramUploadUniform)\
+ ITEM(RendererProgramReload)\
+ ITEM(MaterialBind)\
+ ITEM(TextureCreate)\
+ ITEM(TextureDelete)\
+ ITEM(TextureBindToSlot)\
+ ITEM(TextureSetSubData)\
+
 namespace Engine
 {
   class RenderState
@@ -58,10 +101,12 @@ namespace Engine
         Command       = 0,
         Group         = Count::Command, //internal
 
-        Material      = 0,
-        VAO           = Count::Material,
-        Depth         = VAO + Count::VAO,
-        Translucency  = Depth + Count::Depth,
+        // Opaque draw calls are grouped by material, then vertex array, so state changes
+        // are shared. GetKey() moves depth above these for translucent draw calls.
+        Depth         = 0,
+        VAO           = Depth + Count::Depth,
+        Material      = VAO + Count::VAO,
+        Translucency  = Material + Count::Material,
         Type          = Translucency + Count::Translucency,
         System         = Type + Count::Type,
       };
@@ -82,53 +127,10 @@ namespace Engine
     {
       enum : uint64_t
       {
-        None,
-
-        Resize,
-        SwapWindow,
-        SetClearColor,
-        SetSissor,
-        EnableDepthTest,
-        DisableDepthTest,
-        EnableFeature,
-        DisableFeature,
-        Clear,
-        Draw,
-
-        BufferCreate,
-        BufferDelete,
-        BufferSetData,
-        BufferBind,
-        BufferSetLayout,
-        Buffer_END,
-
-        VertexArray,
-        VertexArrayCreate,
-        VertexArrayDelete,
-        VertexArrayBind,
-        VertexArrayUnbind,
-        VertexArrayAddVertexBuffer,
-        VertexArraySetIndexBuffer,
-        VertexArray_END,
-
-        IndexedBufferBind,
-
-        BindingPointCreate,
-        BindingPointDelete,
-
-        RendererProgramCreate,
-        RendererProgramDelete,
-        RendererProgramInit,
-        RendererProgramDestroy,
-        RendererProgramBind,
-        RendererProgramUnbind,
-        RendererProgramUploadUniform,
-
-        MaterialBind,
-
-        TextureCreate,
-        TextureDelete,
-        TextureBindToSlot,
+#undef ITEM
+#define ITEM(x) x,
+        RENDER_STATE_COMMANDS
+#undef ITEM
       };
     };
 
@@ -198,6 +200,11 @@ namespace Engine
     uint64_t Get(AttrInt) const;
 
     static uint64_t ComputeNormalizedDepth(float a_min, float a_max, float a_val);
+    static char const * CommandToString(uint64_t command);
+
+    // Used as the key when sorting render commands. The packed state, except for translucent
+    // draw calls, which are ordered back to front (larger depths first) before anything else.
+    uint64_t GetKey() const;
 
   private:
 
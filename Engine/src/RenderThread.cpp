@@ -7,6 +7,8 @@
 #include "RenderThreadData.h"
 #include "RT_BindingPoint.h"
 #include "Renderer.h"
+#include "Options.h"
+#include "Profiler.h"
 
 namespace Engine
 {
@@ -15,6 +17,8 @@ namespace Engine
   //-----------------------------------------------------------------------------------------------
   static void RenderThreadWorker()
   {
+    PROFILE_THREAD("Render");
+
     if (Framework::Instance()->GetGraphicsContext()->Init() != Dg::ErrorCode::None)
     {
       LOG_ERROR("Unable to set rendering context!");
@@ -24,12 +28,25 @@ namespace Engine
 
     RendererAPI::Init();
     RT_BindingPoint::Init();
-    RenderThreadData::Init();
+    if (!RenderThreadData::Init())
+    {
+      LOG_ERROR("Unable to initialise the render thread data!");
+      RenderThreadData::ShutDown();
+      RendererAPI::ShutDown();
+      Framework::Instance()->GetGraphicsContext()->ShutDown();
+      RenderThread::Instance()->RenderThreadInitFailed();
+      return;
+    }
+
     RenderThread::Instance()->RenderThreadInitFinished();
 
-    while (!RenderThread::Instance()->ShouldExit())
+    while (RenderThread::Instance()->WaitForFrame())
     {
+      RendererAPI::BeginGPUTimer("GPUFrame");
       Renderer::Instance()->ExecuteRenderCommands();
+      RendererAPI::EndGPUTimer();
+      RenderThreadData::Instance()->materialUniforms.EndFrame();
+      RendererAPI::EndFrame();
       RenderThread::Instance()->RenderThreadFrameFinished();
     }
     RenderThreadData::ShutDown();
@@ -47,7 +64,10 @@ namespace Engine
   RenderThread * RenderThread::s_instance = nullptr;
 
   RenderThread::RenderThread()
-    : m_renderDone(false)
+    : m_mainWaitTime(0)
+    , m_renderWaitTime(0)
+    , m_framesSubmitted(0)
+    , m_framesCompleted(0)
     , m_returnCode(ReturnCode::None)
     , m_shouldStop(false)
   {
@@ -76,50 +96,55 @@ namespace Engine
 
   bool RenderThread::Start()
   {
-    m_renderDone = false;
     m_renderThread = std::thread(RenderThreadWorker);
 
-    while (!m_renderDone)
-      std::this_thread::yield();
+    m_mainSignal.Wait([this]() { return m_returnCode != ReturnCode::None; });
 
-    return m_returnCode == ReturnCode::Ready;
+    if (m_returnCode == ReturnCode::Fail)
+    {
+      m_renderThread.join();
+      return false;
+    }
+    return true;
   }
 
   void RenderThread::Stop()
   {
-    while (!m_renderDone)
-      std::this_thread::yield();
+    if (!m_renderThread.joinable())
+      return;
 
+    Sync();
     m_shouldStop = true;
-    m_renderDone = false;
-
+    m_renderSignal.Notify();
     m_renderThread.join();
   }
 
   void RenderThread::Sync()
   {
-    while (!m_renderDone)
-      std::this_thread::yield();
+    m_mainSignal.Wait([this]() { return m_framesCompleted == m_framesSubmitted; });
   }
 
-  void RenderThread::Continue()
+  void RenderThread::SubmitFrame()
   {
-    m_renderDone = false;
+    m_framesSubmitted++;
+    m_renderSignal.Notify();
+
+    m_mainWaitTime = m_mainSignal.Wait([this]()
+      {
+        return m_framesSubmitted - m_framesCompleted <= RENDER_FRAMES_IN_FLIGHT;
+      });
   }
 
   void RenderThread::RenderThreadInitFinished()
   {
     m_returnCode = ReturnCode::Ready;
-    m_renderDone = true;
-
-    while (m_renderDone)
-      std::this_thread::yield();
+    m_mainSignal.Notify();
   }
 
   void RenderThread::RenderThreadInitFailed()
   {
     m_returnCode = ReturnCode::Fail;
-    m_renderDone = true;
+    m_mainSignal.Notify();
   }
 
   void RenderThread::RenderThreadShutDownFinished()
@@ -129,13 +154,25 @@ namespace Engine
 
   void RenderThread::RenderThreadFrameFinished()
   {
-    m_renderDone = true;
-    while (m_renderDone)
-      std::this_thread::yield();
+    m_framesCompleted++;
+    m_mainSignal.Notify();
+  }
+
+  bool RenderThread::WaitForFrame()
+  {
+    m_renderWaitTime = m_renderSignal.Wait([this]()
+      {
+        return m_framesCompleted != m_framesSubmitted || m_shouldStop;
+      });
+
+    return m_framesCompleted != m_framesSubmitted;
   }
 
-  bool RenderThread::ShouldExit()
+  RenderThread::WaitStats RenderThread::GetWaitStats() const
   {
-    return m_shouldStop;
+    WaitStats stats;
+    stats.mainThread = m_mainWaitTime;
+    stats.renderThread = m_renderWaitTime;
+    return stats;
   }
 }
\ No newline at end of file
@@ -4,6 +4,9 @@
 
 #include <thread>
 #include <atomic>
+#include <stdint.h>
+
+#include "ThreadSignal.h"
 
 namespace Engine
 {
@@ -24,24 +27,43 @@ namespace Engine
 
   public:
 
+    // Time each thread spent blocked on the other, in microseconds.
+    struct WaitStats
+    {
+      uint64_t mainThread;   //Last frame submitted
+      uint64_t renderThread; //Last frame executed
+    };
+
     static bool Init();
     static void ShutDown();
     static RenderThread * Instance();
 
     //Main
-    void Sync(); //Sync with the render thread. On return, the render thread will be waiting.
-    void Continue(); //Release the render thread after a Sync()
+    void Sync(); //Sync with the render thread. On return, all submitted frames have been executed.
+
+    //Hand the current frame over to the render thread. On return, the render thread will
+    //be at most RENDER_FRAMES_IN_FLIGHT frames behind, so the next command buffer is free.
+    void SubmitFrame();
 
     //Render thread
     void RenderThreadInitFinished();
     void RenderThreadInitFailed();
     void RenderThreadShutDownFinished();
     void RenderThreadFrameFinished();
-    bool ShouldExit();
+    bool WaitForFrame(); //Returns false if the render thread should exit.
+
+    WaitStats GetWaitStats() const;
 
   private:
 
-    std::atomic<bool> m_renderDone;
+    ThreadSignal m_mainSignal;   //The main thread waits on this
+    ThreadSignal m_renderSignal; //The render thread waits on this
+
+    std::atomic<uint64_t> m_mainWaitTime;
+    std::atomic<uint64_t> m_renderWaitTime;
+
+    std::atomic<uint64_t> m_framesSubmitted;
+    std::atomic<uint64_t> m_framesCompleted;
     std::atomic<ReturnCode> m_returnCode;
     std::atomic<bool> m_shouldStop;
 
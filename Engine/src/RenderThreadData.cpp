@@ -2,6 +2,8 @@
 
 #include "RenderThreadData.h"
 #include "BSR_Assert.h"
+#include "Options.h"
+#include "Log.h"
 
 namespace Engine
 {
@@ -23,6 +25,21 @@ namespace Engine
   {
     BSR_ASSERT(s_instance == nullptr, "RenderThreadData already intialised!");
     s_instance = new RenderThreadData();
+
+#ifdef ENABLE_MATERIAL_UNIFORM_BLOCKS
+    if (!s_instance->materialBindingPoint.Capture(StorageBlockType::Uniform, ShaderDomain::Vertex))
+    {
+      LOG_ERROR("RenderThreadData::Init(): Failed to capture a binding point for material uniforms!");
+      return false;
+    }
+
+    if (!s_instance->materialUniforms.Init(MATERIAL_UNIFORM_BUFFER_SIZE, RENDER_FRAMES_IN_FLIGHT + 1))
+    {
+      LOG_ERROR("RenderThreadData::Init(): Failed to create the material uniform ring!");
+      return false;
+    }
+#endif
+
     return true;
   }
 
@@ -36,4 +53,54 @@ namespace Engine
   {
     return s_instance;
   }
+
+  RT_RendererProgram * RenderThreadData::GetProgram(RenderResourceID a_id)
+  {
+    RT_RendererProgram ** ppRP = rendererPrograms.at(a_id);
+    if (ppRP == nullptr || *ppRP == nullptr)
+      return nullptr;
+
+    if ((*ppRP)->IsReady())
+      return *ppRP;
+
+    if ((*ppRP)->GetFallbackID() == INVALID_RENDER_RESOURE_ID)
+      return nullptr;
+
+    RT_RendererProgram ** ppFallback = rendererPrograms.at((*ppRP)->GetFallbackID());
+    if (ppFallback == nullptr || *ppFallback == nullptr || !(*ppFallback)->IsReady())
+      return nullptr;
+
+    return *ppFallback;
+  }
+
+  void RenderThreadData::ReloadPrograms(ResourceID a_shaderDataID, ShaderData const * a_pNewData)
+  {
+    for (auto kv : rendererPrograms)
+    {
+      RT_RendererProgram * pOld = kv.second;
+      if (pOld == nullptr || pOld->GetShaderDataID() != a_shaderDataID)
+        continue;
+
+      RT_RendererProgram * pNew = RT_RendererProgram::Create(a_pNewData, a_shaderDataID, pOld->GetFallbackID());
+      if (pNew == nullptr || !pNew->WaitUntilReady())
+      {
+        LOG_WARN("RenderThreadData::ReloadPrograms(): Failed to compile program '{}', keeping the old one.", kv.first);
+        delete pNew;
+        continue;
+      }
+
+      *rendererPrograms.at(kv.first) = pNew;
+      delete pOld;
+    }
+  }
+
+  bool RenderThreadData::UsesShaderData(ShaderData const * a_pData)
+  {
+    for (auto kv : rendererPrograms)
+    {
+      if (kv.second != nullptr && kv.second->GetShaderData() == a_pData)
+        return true;
+    }
+    return false;
+  }
 }
\ No newline at end of file
@@ -26,6 +26,17 @@ namespace Engine
     static void ShutDown();
     static RenderThreadData* Instance();
 
+    // The program to draw with: the program itself once it has compiled, otherwise its 
+    // fallback if that is ready. nullptr if neither is, and the draw should be skipped.
+    RT_RendererProgram * GetProgram(RenderResourceID);
+
+    // Rebuild every program made from 'shaderDataID' with 'pNewData'. Each is compiled
+    // before it replaces the old one, and programs which fail to compile are kept.
+    void ReloadPrograms(ResourceID shaderDataID, ShaderData const * pNewData);
+
+    // True if any program was built from this shader data.
+    bool UsesShaderData(ShaderData const *);
+
   public:
 
     Dg::OpenHashMap<RenderResourceID, RT_VertexArray*>          VAOs;
@@ -36,6 +47,14 @@ namespace Engine
     Dg::OpenHashMap<RenderResourceID, RT_BindingPoint*>         bindingPoints;
     Dg::OpenHashMap<RenderResourceID, RT_Texture2D*>            textures;
     Dg::OpenHashMap<RenderResourceID, RT_RendererProgram*>      rendererPrograms;
+
+    // False if the last RendererProgram::Bind() found neither the program nor its fallback
+    // ready. Draw commands which rely on that binding are skipped until the next Bind().
+    bool                  boundProgramReady = true;
+
+    // Material uniform blocks are streamed through this ring, see ShaderData::LayoutUniformBlock()
+    RT_UniformBufferRing  materialUniforms;
+    RT_BindingPoint       materialBindingPoint;
   };
 }
 
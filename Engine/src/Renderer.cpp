@@ -24,6 +24,9 @@
 #include "RT_RendererAPI.h"
 #include "RenderThread.h"
 #include "Memory.h"
+#include "Material.h"
+#include "RenderThreadData.h"
+#include "Profiler.h"
 
 namespace Engine
 {
@@ -62,6 +65,7 @@ namespace Engine
   }
 
   Renderer::Renderer()
+    : m_frameIndex(0)
   {
     
   }
@@ -71,7 +75,8 @@ namespace Engine
 
   }
 
-  void Renderer::DrawIndexed(Ref<VertexArray> const & a_va, RenderMode a_mode, uint32_t a_instanceCount, uint32_t a_elementCount)
+  void Renderer::DrawIndexed(Ref<VertexArray> const & a_va, RenderMode a_mode, uint32_t a_instanceCount, uint32_t a_elementCount,
+                             uint32_t a_baseVertex, uint32_t a_baseInstance)
   {
     BSR_ASSERT(a_va.get() != nullptr);
     Engine::RenderState state = Engine::RenderState::Create();
@@ -80,9 +85,53 @@ namespace Engine
 
     uint32_t count = a_elementCount == 0 ? a_va->GetIndexBuffer()->ElementCount() : a_elementCount;
 
-    RENDER_SUBMIT(state, [a_mode, dataType = a_va->GetIndexBuffer()->DataType(), a_instanceCount, count]()
+    RENDER_SUBMIT(state, [a_mode, dataType = a_va->GetIndexBuffer()->DataType(), a_instanceCount, count, a_baseVertex, a_baseInstance]()
       {
-        RendererAPI::DrawIndexed(a_mode, dataType, a_instanceCount, count);
+        // The bound program is still compiling, with nothing to stand in for it
+        if (!RenderThreadData::Instance()->boundProgramReady)
+          return;
+        RendererAPI::DrawIndexed(a_mode, dataType, a_instanceCount, count, a_baseVertex, a_baseInstance);
+      });
+  }
+
+  void Renderer::DrawIndexed(RenderState a_state, Ref<VertexArray> const & a_va, Ref<impl::MaterialBase> const & a_material,
+                             RenderMode a_mode, uint32_t a_instanceCount, uint32_t a_elementCount,
+                             uint32_t a_baseVertex, uint32_t a_baseInstance)
+  {
+    BSR_ASSERT(a_va.get() != nullptr);
+    BSR_ASSERT(a_material.get() != nullptr);
+
+    RenderResourceID progID = a_material->GetProgram()->GetID();
+    a_state.Set<RenderState::Attr::Type>(RenderState::Type::DrawCall);
+    a_state.Set<RenderState::Attr::VAO>(a_va->GetID());
+    a_state.Set<RenderState::Attr::Material>(a_material->GetProgram()->GetSortKey());
+
+    uint32_t count = a_elementCount == 0 ? a_va->GetIndexBuffer()->ElementCount() : a_elementCount;
+
+    a_material->Sync();
+    byte * buf = (byte*)RENDER_ALLOCATE(a_material->GetUniformBufferSize());
+    memcpy(buf, a_material->GetUniformBuffer(), a_material->GetUniformBufferSize());
+    UniformBufferVersion version = a_material->Submit();
+
+    RENDER_SUBMIT(a_state, [progID, vaoID = a_va->GetID(), buf, version, a_mode, dataType = a_va->GetIndexBuffer()->DataType(), 
+                            a_instanceCount, count, a_baseVertex, a_baseInstance]()
+      {
+        RT_VertexArray ** ppVA = RenderThreadData::Instance()->VAOs.at(vaoID);
+        if (RenderThreadData::Instance()->rendererPrograms.at(progID) == nullptr || ppVA == nullptr)
+        {
+          LOG_WARN("Renderer::DrawIndexed: Program '{}' or vertex array '{}' does not exist!", progID, vaoID);
+          return;
+        }
+
+        // Still compiling, with nothing to stand in for it
+        RT_RendererProgram * pRP = RenderThreadData::Instance()->GetProgram(progID);
+        if (pRP == nullptr)
+          return;
+
+        pRP->UploadUniformBuffer(buf, version);
+        RenderThreadData::Instance()->boundProgramReady = true;
+        (*ppVA)->Bind();
+        RendererAPI::DrawIndexed(a_mode, dataType, a_instanceCount, count, a_baseVertex, a_baseInstance);
       });
   }
 
@@ -174,13 +223,35 @@ namespace Engine
     return m_commandQueue.Allocate(a_size);
   }
 
+  void Renderer::MergeThreadCommands()
+  {
+    m_commandQueue.MergeThreadCommands();
+  }
+
+  bool Renderer::SetRecordingThreadSlot(int a_slot)
+  {
+    return m_commandQueue.SetThreadSlot(a_slot);
+  }
+
   void Renderer::SwapBuffers()
   {
     m_commandQueue.Swap();
+    m_frameIndex++;
+  }
+
+  uint64_t Renderer::GetFrameIndex() const
+  {
+    return m_frameIndex;
+  }
+
+  RenderCommandQueue::FrameStats Renderer::GetCommandStats() const
+  {
+    return m_commandQueue.GetFrameStats();
   }
 
   void Renderer::ExecuteRenderCommands()
   {
+    PROFILE_SCOPE("ExecuteRenderCommands");
     m_commandQueue.Execute();
   }
 
@@ -39,6 +39,11 @@ namespace Engine
 {
   struct GlobalRenderState;
 
+  namespace impl
+  {
+    class MaterialBase;
+  }
+
   class Renderer
   {
   public:
@@ -56,7 +61,16 @@ namespace Engine
     static void SetSissorBox(int x, int y, int w, int h);
     static void Enable(RenderFeature);
     static void Disable(RenderFeature);
-    static void DrawIndexed(Ref<VertexArray> const &, RenderMode, uint32_t instanceCount, uint32_t elementCount = 0);
+    static void DrawIndexed(Ref<VertexArray> const &, RenderMode, uint32_t instanceCount, uint32_t elementCount = 0,
+                            uint32_t baseVertex = 0, uint32_t baseInstance = 0);
+
+    // Submits a self contained draw call, which binds the material and vertex array itself.
+    // These are sorted on the render thread to reduce state changes. Set the System,
+    // Translucency and Depth in the state, the rest will be filled in. Can be called from
+    // any thread; see MergeThreadCommands().
+    static void DrawIndexed(RenderState, Ref<VertexArray> const &, Ref<impl::MaterialBase> const &,
+                            RenderMode, uint32_t instanceCount, uint32_t elementCount = 0,
+                            uint32_t baseVertex = 0, uint32_t baseInstance = 0);
 
     // Allocates on the temporary buffer. Do not delete!
     // Will be cleared every frame!
@@ -81,14 +95,37 @@ namespace Engine
         (*pFunc)();
         pFunc->~FuncT();
       };
-      a_state.Set(RenderState::Attr::Group, uint64_t(m_group.GetCurrentID()));
-      auto pStorageBuffer = s_instance->m_commandQueue.AllocateForCommand(a_state, renderCmd, sizeof(func));
+      // Groups belong to the main thread
+      Group::IDType groupID = Group::NONE;
+      if (s_instance->m_commandQueue.IsMainThread())
+      {
+        groupID = m_group.GetCurrentID();
+        if (a_state.Get<RenderState::Attr::Type>() == RenderState::Type::Command)
+          a_state.Set<RenderState::Attr::Group>(uint64_t(groupID));
+      }
+      auto pStorageBuffer = s_instance->m_commandQueue.AllocateForCommand(a_state, renderCmd, sizeof(func), groupID);
       new (pStorageBuffer) FuncT(std::forward<FuncT>(func));
     }
 
+    // Draw calls can be submitted from any thread. Those from threads other than the
+    // main thread are added to the command stream when this is called, or at the end
+    // of the frame.
+    void MergeThreadCommands();
+
+    // Worker threads, before they first submit. Fixes the order in which their draw calls
+    // are merged; see RenderCommandQueue::SetThreadSlot().
+    bool SetRecordingThreadSlot(int slot);
+
     void SwapBuffers();
     void* Allocate(uint32_t);
 
+    // Main thread. Counts calls to SwapBuffers(). Commands recorded in frame N are executed 
+    // in the render thread's Nth frame.
+    uint64_t GetFrameIndex() const;
+
+    //The last frame of submitted commands
+    RenderCommandQueue::FrameStats GetCommandStats() const;
+
     //Render thread
     void ExecuteRenderCommands();
 
@@ -111,6 +148,7 @@ namespace Engine
 
     RenderCommandQueue m_commandQueue;
     Group m_group;
+    uint64_t m_frameIndex;
   };
 
 }
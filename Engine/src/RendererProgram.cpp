@@ -10,7 +10,7 @@
 
 namespace Engine
 {
-  void RendererProgram::Init(ResourceID a_shaderSourceID)
+  void RendererProgram::Init(ResourceID a_shaderSourceID, RenderResourceID a_fallbackID)
   {
     m_shaderDataID = a_shaderSourceID;
 
@@ -18,27 +18,41 @@ namespace Engine
     state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
     state.Set<RenderState::Attr::Command>(RenderState::Command::RendererProgramCreate);
 
-    RENDER_SUBMIT(state, [resID = m_id, shaderDataID = m_shaderDataID]()
+    RENDER_SUBMIT(state, [resID = m_id, shaderDataID = m_shaderDataID, fallbackID = a_fallbackID]()
     {
       if (RenderThreadData::Instance()->rendererPrograms.at(resID) != nullptr)
       {
         LOG_WARN("RendererProgram::RendererProgram: RefID '{}' already exists!", resID);
         return;
       }
-      RenderThreadData::Instance()->rendererPrograms.insert(resID, RT_RendererProgram::Create(shaderDataID));
+      RenderThreadData::Instance()->rendererPrograms.insert(resID, RT_RendererProgram::Create(shaderDataID, fallbackID));
     });
   }
 
   RendererProgram::RendererProgram()
+    : m_shaderDataID(INVALID_RESOURCE_ID)
+    , m_sortKey(m_id)
   {
   
   }
 
-  Ref<RendererProgram> RendererProgram::Create(ResourceID a_shaderSourceID)
+  Ref<RendererProgram> RendererProgram::Create(ResourceID a_shaderSourceID, Ref<RendererProgram> const & a_fallback)
   {
     RendererProgram* pRP = new RendererProgram();
     Ref<RendererProgram> ref(pRP);
-    pRP->Init(a_shaderSourceID);
+
+    RenderResourceID fallbackID = INVALID_RENDER_RESOURE_ID;
+    if (a_fallback != nullptr)
+    {
+      ShaderData * pData = ResourceManager::Instance()->GetResource<ShaderData>(a_shaderSourceID);
+      ShaderData * pFallbackData = ResourceManager::Instance()->GetResource<ShaderData>(a_fallback->m_shaderDataID);
+      if (pData != nullptr && pFallbackData != nullptr && pData->HasSameUniforms(*pFallbackData))
+        fallbackID = a_fallback->GetID();
+      else
+        LOG_WARN("RendererProgram::Create: Fallback program does not have the same uniforms. Ignoring.");
+    }
+
+    pRP->Init(a_shaderSourceID, fallbackID);
     return ref;
   }
 
@@ -99,13 +113,18 @@ namespace Engine
 
     RENDER_SUBMIT(state, [resID = m_id]()
     {
-      RT_RendererProgram ** ppRP = RenderThreadData::Instance()->rendererPrograms.at(resID);
-      if (ppRP == nullptr)
+      RenderThreadData::Instance()->boundProgramReady = false;
+      if (RenderThreadData::Instance()->rendererPrograms.at(resID) == nullptr)
       {
         LOG_WARN("RendererProgram::Bind: RefID '{}' does not exist!", resID);
         return;
       }
-      (*ppRP)->Bind();
+      RT_RendererProgram * pRP = RenderThreadData::Instance()->GetProgram(resID);
+      if (pRP == nullptr)
+        return;
+
+      pRP->Bind();
+      RenderThreadData::Instance()->boundProgramReady = true;
     });
   }
 
@@ -117,17 +136,25 @@ namespace Engine
 
     RENDER_SUBMIT(state, [resID = m_id]()
     {
-      RT_RendererProgram ** ppRP = RenderThreadData::Instance()->rendererPrograms.at(resID);
-      if (ppRP == nullptr)
+      if (RenderThreadData::Instance()->rendererPrograms.at(resID) == nullptr)
       {
         LOG_WARN("RendererProgram::Unbind: RefID '{}' does not exist!", resID);
         return;
       }
-      (*ppRP)->Unbind();
+      RenderThreadData::Instance()->boundProgramReady = true;
+      RT_RendererProgram * pRP = RenderThreadData::Instance()->GetProgram(resID);
+      if (pRP != nullptr)
+        pRP->Unbind();
     });
   }
 
   void RendererProgram::UploadUniformBuffer(byte const * a_buf)
+  {
+    UniformBufferVersion version = {};
+    UploadUniformBuffer(a_buf, version);
+  }
+
+  void RendererProgram::UploadUniformBuffer(byte const * a_buf, UniformBufferVersion const & a_version)
   {
     //TODO Store pointer to avoid look-up each call to UploadUniformBuffer()
     ShaderData * pShaderData = ResourceManager::Instance()->GetResource<ShaderData>(m_shaderDataID);
@@ -140,18 +167,24 @@ namespace Engine
     byte * buf_data = (byte*)RENDER_ALLOCATE(pShaderData->GetUniformDataSize());
     memcpy(buf_data, a_buf, pShaderData->GetUniformDataSize());
 
-    RENDER_SUBMIT(state, [resID = m_id, buf = buf_data]()
+    RENDER_SUBMIT(state, [resID = m_id, buf = buf_data, version = a_version]()
     {
-      RT_RendererProgram ** ppRP = RenderThreadData::Instance()->rendererPrograms.at(resID);
-      if (ppRP == nullptr)
+      if (RenderThreadData::Instance()->rendererPrograms.at(resID) == nullptr)
       {
         LOG_WARN("RendererProgram::UploadUniformBuffer: RefID '{}' does not exist!", resID);
         return;
       }
-      (*ppRP)->UploadUniformBuffer(buf);
+      RT_RendererProgram * pRP = RenderThreadData::Instance()->GetProgram(resID);
+      if (pRP != nullptr)
+        pRP->UploadUniformBuffer(buf, version);
     });
   }
 
+  uint32_t RendererProgram::GetSortKey() const
+  {
+    return m_sortKey;
+  }
+
   ShaderUniformDeclaration const* RendererProgram::FindUniformDeclaration(std::string const& a_name) const
   {
     ShaderData * pShaderData = ResourceManager::Instance()->GetResource<ShaderData>(m_shaderDataID);
@@ -166,6 +199,31 @@ namespace Engine
     return nullptr;
   }
 
+  uint32_t RendererProgram::FindUniformIndex(std::string const& a_name) const
+  {
+    ShaderData * pShaderData = ResourceManager::Instance()->GetResource<ShaderData>(m_shaderDataID);
+    BSR_ASSERT(pShaderData != nullptr);
+
+    return pShaderData->FindUniformIndex(a_name);
+  }
+
+  ShaderUniformDeclaration const * RendererProgram::GetUniformDeclaration(uint32_t a_index) const
+  {
+    ShaderData * pShaderData = ResourceManager::Instance()->GetResource<ShaderData>(m_shaderDataID);
+    BSR_ASSERT(pShaderData != nullptr);
+    BSR_ASSERT(a_index < pShaderData->GetUniforms().size());
+
+    return &pShaderData->GetUniforms()[a_index];
+  }
+
+  uint32_t RendererProgram::UniformCount() const
+  {
+    ShaderData * pShaderData = ResourceManager::Instance()->GetResource<ShaderData>(m_shaderDataID);
+    BSR_ASSERT(pShaderData != nullptr);
+
+    return uint32_t(pShaderData->GetUniforms().size());
+  }
+
   void RendererProgram::UploadUniform(std::string const& a_name, void const* a_buf, uint32_t a_size)
   {
     RenderState state = RenderState::Create();
@@ -181,16 +239,19 @@ namespace Engine
 
     RENDER_SUBMIT(state, [resID = m_id, size = a_size, buf_name = buf_name, buf_data = buf_data]()
     {
-      RT_RendererProgram ** ppRP = RenderThreadData::Instance()->rendererPrograms.at(resID);
-      if (ppRP == nullptr)
+      if (RenderThreadData::Instance()->rendererPrograms.at(resID) == nullptr)
       {
         LOG_WARN("RendererProgram::Bind: RefID '{}' does not exist!", resID);
         return;
       }
+      RT_RendererProgram * pRP = RenderThreadData::Instance()->GetProgram(resID);
+      if (pRP == nullptr)
+        return;
+
       std::string name;
 
       Deserialize(buf_name, &name, 1);
-      (*ppRP)->UploadUniform(name, buf_data, size);
+      pRP->UploadUniform(name, buf_data, size);
     });
   }
 
@@ -11,23 +11,46 @@
 
 namespace Engine
 {
+  // Describes which values in a material uniform buffer have changed, so the render
+  // thread can skip uploading anything a program already has.
+  struct UniformBufferVersion
+  {
+    uint64_t          materialID;     // 0 == unknown, always upload everything
+    uint32_t          generation;     // generation of the buffer being sent
+    uint32_t          baseGeneration; // generation last sent for this material
+    uint32_t const *  pDirty;         // bit per uniform, changed since baseGeneration. nullptr == all.
+  };
+
   class RendererProgram : public RenderResource
   {
-    void Init(ResourceID shaderSourceID);
+    friend class ShaderPermutations;
+
+    void Init(ResourceID shaderSourceID, RenderResourceID fallbackID);
     RendererProgram();
 
     RendererProgram(RendererProgram const&) = delete;
     RendererProgram& operator=(RendererProgram const&) = delete;
   public:
 
-    static Ref<RendererProgram> Create(ResourceID shaderSourceID);
+    // Programs compile in the background, and draws using them are skipped until they are 
+    // ready. If 'fallback' is given, it is drawn with instead. It must have the same uniforms, 
+    // eg a cheaper version of the same shader.
+    static Ref<RendererProgram> Create(ResourceID shaderSourceID, Ref<RendererProgram> const & fallback = nullptr);
 
     ~RendererProgram();
 
     uint32_t UniformBufferSize() const;
 
+    // Goes in the RenderState Material bits. Variants of the same shader have 
+    // neighbouring keys, so draws using them are sorted together.
+    uint32_t GetSortKey() const;
+
     void UploadUniformBuffer(byte const *);
+    void UploadUniformBuffer(byte const *, UniformBufferVersion const &);
     ShaderUniformDeclaration const * FindUniformDeclaration(std::string const&) const;
+    uint32_t FindUniformIndex(std::string const&) const;
+    ShaderUniformDeclaration const * GetUniformDeclaration(uint32_t index) const;
+    uint32_t UniformCount() const;
 
     //Deprecated
     void UploadUniform(std::string const& name, void const * buf, uint32_t size);
@@ -43,6 +66,7 @@ namespace Engine
     // Now that we have access to the uniform data, we can create a buffer to transform
     // uniforms over to the render thread
     ResourceID m_shaderDataID;
+    uint32_t m_sortKey;
   };
 }
 
@@ -53,6 +53,7 @@ namespace Engine
   }
 
   ResourceManager::ResourceManager()
+    : m_nextInternalID(ir_DynamicBegin)
   {
 
   }
@@ -72,6 +73,12 @@ namespace Engine
     m_resourceMap.clear();
   }
 
+  ResourceID ResourceManager::NewInternalID()
+  {
+    BSR_ASSERT(m_nextInternalID != INVALID_RESOURCE_ID, "Out of internal resource IDs!");
+    return m_nextInternalID++;
+  }
+
   void ResourceManager::Erase(ResourceID a_id)
   {
     ResourceWrapperBase ** ppData = m_resourceMap.at(a_id);
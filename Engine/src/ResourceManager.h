@@ -16,9 +16,10 @@ namespace Engine
 
   enum InternalResourceID : ResourceID
   {
-    ir_GUIBoxShader = 0x80000000,
-    ir_GUITextShader,
-    ir_GUIBoxBorderShader
+    ir_GUIShader = 0x80000000,
+
+    // Handed out by ResourceManager::NewInternalID()
+    ir_DynamicBegin = 0x80010000
   };
 
   class ResourceWrapperBase
@@ -58,6 +59,9 @@ namespace Engine
     void Clear();
     void Erase(ResourceID);
 
+    // An unused ID from the reserved range, for resources the engine creates at runtime.
+    ResourceID NewInternalID();
+
     template<typename T>
     void RegisterResource(ResourceID a_id, T * a_pObj)
     {
@@ -80,6 +84,7 @@ namespace Engine
 
     static ResourceManager* s_instance;
     Dg::OpenHashMap<ResourceID, ResourceWrapperBase *> m_resourceMap;
+    ResourceID m_nextInternalID;
   };
 
   template<typename T>
@@ -0,0 +1,102 @@
+//@group Renderer
+
+#include "ShaderPermutations.h"
+#include "ShaderUniform.h"
+#include "Options.h"
+#include "Log.h"
+#include "BSR_Assert.h"
+
+namespace Engine
+{
+  // Keys above this bit are for variants. Programs which are not variants use their ID.
+  static uint32_t const s_VariantKeyBit = 1u << 29;
+  static uint32_t s_nextFamily = 0;
+
+  static_assert(SHADER_MAX_FEATURES < 29, "Feature masks need to fit in the RenderState Material bits");
+
+  ShaderPermutations::ShaderPermutations(ResourceID a_baseShaderDataID, std::vector<std::string> const & a_features)
+    : m_baseID(a_baseShaderDataID)
+    , m_sortKeyBase(s_VariantKeyBit | ((s_nextFamily++ << SHADER_MAX_FEATURES) & (s_VariantKeyBit - 1)))
+    , m_features(a_features)
+    , m_variants()
+  {
+
+  }
+
+  Ref<ShaderPermutations> ShaderPermutations::Create(ResourceID a_baseShaderDataID, std::initializer_list<std::string> const & a_features)
+  {
+    BSR_ASSERT(a_features.size() <= SHADER_MAX_FEATURES, "Too many shader features!");
+    return Ref<ShaderPermutations>(new ShaderPermutations(a_baseShaderDataID, a_features));
+  }
+
+  // Variant shader data stays registered with the ResourceManager, the render thread
+  // may still be using it.
+  ShaderPermutations::~ShaderPermutations()
+  {
+
+  }
+
+  Ref<RendererProgram> ShaderPermutations::Get(uint32_t a_features)
+  {
+    a_features &= (1u << m_features.size()) - 1;
+
+    Ref<RendererProgram> * pProg = m_variants.at(a_features);
+    if (pProg != nullptr)
+      return *pProg;
+
+    Ref<RendererProgram> prog = CreateVariant(a_features);
+    if (prog != nullptr)
+      m_variants.insert(a_features, prog);
+    return prog;
+  }
+
+  uint32_t ShaderPermutations::GetFeatureBit(std::string const & a_name) const
+  {
+    for (size_t i = 0; i < m_features.size(); i++)
+    {
+      if (m_features[i] == a_name)
+        return 1u << i;
+    }
+    return 0;
+  }
+
+  uint32_t ShaderPermutations::GetFeatureCount() const
+  {
+    return static_cast<uint32_t>(m_features.size());
+  }
+
+  std::string ShaderPermutations::GetDefines(uint32_t a_features) const
+  {
+    std::string defines;
+    for (size_t i = 0; i < m_features.size(); i++)
+    {
+      if ((a_features & (1u << i)) != 0)
+        defines += "#define " + m_features[i] + "\n";
+    }
+    return defines;
+  }
+
+  Ref<RendererProgram> ShaderPermutations::CreateVariant(uint32_t a_features)
+  {
+    ResourceManager * pRM = ResourceManager::Instance();
+    ShaderData * pBase = pRM->GetResource<ShaderData>(m_baseID);
+    if (pBase == nullptr)
+    {
+      LOG_WARN("ShaderPermutations::Get: Base shader data '{}' does not exist!", m_baseID);
+      return nullptr;
+    }
+
+    ResourceID shaderDataID = m_baseID;
+    Ref<RendererProgram> fallback;
+    if (a_features != 0)
+    {
+      shaderDataID = pRM->NewInternalID();
+      pRM->RegisterResource(shaderDataID, new ShaderData(*pBase, GetDefines(a_features)));
+      fallback = Get(0);
+    }
+
+    Ref<RendererProgram> prog = RendererProgram::Create(shaderDataID, fallback);
+    prog->m_sortKey = m_sortKeyBase | a_features;
+    return prog;
+  }
+}
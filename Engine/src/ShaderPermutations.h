@@ -0,0 +1,63 @@
+//@group Renderer
+
+#ifndef SHADERPERMUTATIONS_H
+#define SHADERPERMUTATIONS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Memory.h"
+#include "ResourceManager.h"
+#include "RendererProgram.h"
+#include "DgMap_AVL.h"
+
+namespace Engine
+{
+  /*
+    Generates variants of a shader from a feature mask, instead of branching on a uniform
+    or writing a copy of the shader for each feature:
+
+      Ref<ShaderPermutations> perms = ShaderPermutations::Create(sdID, {"LIGHTING", "ALPHA_TEST"});
+      Ref<Material> mat = Material::Create(perms->Get(perms->GetFeatureBit("ALPHA_TEST")));
+
+    Bit i of the mask adds '#define <features[i]>' to every source of the shader. Variants
+    are created the first time they are asked for and kept after that. They have the same 
+    uniforms as the base shader, and draw with the base program while they compile.
+    Main thread only.
+  */
+  class ShaderPermutations
+  {
+    ShaderPermutations(ResourceID baseShaderDataID, std::vector<std::string> const & features);
+
+    ShaderPermutations(ShaderPermutations const &) = delete;
+    ShaderPermutations & operator=(ShaderPermutations const &) = delete;
+  public:
+
+    // At most SHADER_MAX_FEATURES features.
+    static Ref<ShaderPermutations> Create(ResourceID baseShaderDataID, std::initializer_list<std::string> const & features);
+
+    ~ShaderPermutations();
+
+    // nullptr if the base shader data does not exist.
+    Ref<RendererProgram> Get(uint32_t features);
+
+    // 0 if the feature does not exist.
+    uint32_t GetFeatureBit(std::string const & name) const;
+    uint32_t GetFeatureCount() const;
+
+  private:
+
+    std::string GetDefines(uint32_t features) const;
+    Ref<RendererProgram> CreateVariant(uint32_t features);
+
+  private:
+
+    ResourceID                                  m_baseID;
+    uint32_t                                    m_sortKeyBase;
+    std::vector<std::string>                    m_features;
+    Dg::Map_AVL<uint32_t, Ref<RendererProgram>> m_variants;
+  };
+}
+
+#endif
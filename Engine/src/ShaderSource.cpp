@@ -57,6 +57,16 @@ namespace Engine
     return result;
   }
 
+  static bool ReadFile(std::string const & a_path, std::string & a_out)
+  {
+    std::ifstream ifs(a_path);
+    if (!ifs.good())
+      return false;
+
+    a_out.assign((std::istreambuf_iterator<char>(ifs)), (std::istreambuf_iterator<char>()));
+    return true;
+  }
+
   //------------------------------------------------------------------------------------------------
   // ShaderSourceElement
   //------------------------------------------------------------------------------------------------
@@ -94,16 +104,15 @@ namespace Engine
         m_src[static_cast<uint32_t>(ele.domain)] = RemoveComments(ele.str);
       else
       {
-        std::ifstream ifs(ele.str);
-        if (!ifs.good())
+        std::string content;
+        if (!ReadFile(ele.str, content))
         {
           LOG_WARN("ShaderSource::ShaderSource() failed to open file '{}'", ele.str.c_str());
           continue;
         }
 
-        std::string content((std::istreambuf_iterator<char>(ifs)),
-          (std::istreambuf_iterator<char>()));
         m_src[static_cast<uint32_t>(ele.domain)] = RemoveComments(content);
+        m_paths[static_cast<uint32_t>(ele.domain)] = ele.str;
       }
     }
   }
@@ -118,9 +127,76 @@ namespace Engine
     return m_src[static_cast<uint32_t>(a_domain)];
   }
 
+  void ShaderSource::Set(ShaderDomain a_domain, std::string const& a_src)
+  {
+    m_src[static_cast<uint32_t>(a_domain)] = a_src;
+  }
+
+  std::string const& ShaderSource::GetPath(ShaderDomain a_domain) const
+  {
+    return m_paths[static_cast<uint32_t>(a_domain)];
+  }
+
+  bool ShaderSource::ReloadFiles()
+  {
+    std::string content[ShaderDomain_COUNT];
+    for (uint32_t i = 0; i < ShaderDomain_COUNT; i++)
+    {
+      if (m_paths[i].empty())
+        continue;
+
+      if (!ReadFile(m_paths[i], content[i]))
+      {
+        LOG_WARN("ShaderSource::ReloadFiles() failed to open file '{}'", m_paths[i].c_str());
+        return false;
+      }
+    }
+
+    for (uint32_t i = 0; i < ShaderDomain_COUNT; i++)
+    {
+      if (!m_paths[i].empty())
+        m_src[i] = RemoveComments(content[i]);
+    }
+    return true;
+  }
+
+  void ShaderSource::InsertAfterPreamble(std::string & a_src, std::string const & a_text)
+  {
+    // #extension directives must come before any declarations, so skip past them too
+    size_t insertAt = 0;
+    size_t lineStart = 0;
+    while (lineStart < a_src.size())
+    {
+      size_t lineEnd = a_src.find('\n', lineStart);
+      lineEnd = lineEnd == std::string::npos ? a_src.size() : lineEnd + 1;
+
+      size_t first = a_src.find_first_not_of(" \t\r", lineStart);
+      if (first < lineEnd && a_src[first] != '\n')
+      {
+        if (a_src[first] != '#')
+          break;
+
+        size_t directive = a_src.find_first_not_of(" \t", first + 1);
+        if (directive >= lineEnd
+          || (a_src.compare(directive, 7, "version") != 0 && a_src.compare(directive, 9, "extension") != 0))
+          break;
+
+        insertAt = lineEnd;
+      }
+      lineStart = lineEnd;
+    }
+
+    if (insertAt > 0 && a_src[insertAt - 1] != '\n')
+      a_src.insert(insertAt++, 1, '\n');
+    a_src.insert(insertAt, a_text);
+  }
+
   void ShaderSource::Clear()
   {
     for (uint32_t i = 0; i < ShaderDomain_COUNT; i++)
+    {
       m_src[i].clear();
+      m_paths[i].clear();
+    }
   }
 }
\ No newline at end of file
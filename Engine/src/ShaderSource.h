@@ -32,12 +32,24 @@ namespace Engine
     ShaderSource(std::initializer_list<ShaderSourceElement> const&);
     void Init(std::initializer_list<ShaderSourceElement> const&);
     std::string const& Get(ShaderDomain) const;
+    void Set(ShaderDomain, std::string const&);
+
+    // The file a source was loaded from. Empty if it was given as a string.
+    std::string const& GetPath(ShaderDomain) const;
+
+    // Read every source which came from a file again. Returns false if a file
+    // could not be opened, in which case nothing is changed.
+    bool ReloadFiles();
+
+    // Inserts 'text' after the #version and #extension lines at the top of the source.
+    static void InsertAfterPreamble(std::string & src, std::string const & text);
 
     void Clear();
 
   private:
 
     std::string m_src[ShaderDomain_COUNT];
+    std::string m_paths[ShaderDomain_COUNT];
   };
 
 }
@@ -32,6 +32,7 @@
 #include "Serialize.h"
 #include "BSR_Assert.h"
 #include "DgBit.h"
+#include "Options.h"
 
 #define ALIGN Dg::ForwardAlign<uint32_t>
 
@@ -186,6 +187,7 @@ namespace Engine
     , m_count(a_count)
     , m_isArray(a_isArray)
     , m_dataOffset(0)
+    , m_blockOffset(INVALID_INDEX)
   {
     BSR_ASSERT(a_type != ShaderDataType::STRUCT);
   }
@@ -221,7 +223,7 @@ namespace Engine
 
   bool ShaderUniformDeclaration::IsArray() const
   {
-    return m_count > 1;
+    return m_isArray;
   }
 
   uint32_t ShaderUniformDeclaration::GetDataSize() const
@@ -239,11 +241,27 @@ namespace Engine
     return m_dataOffset;
   }
 
+  void ShaderUniformDeclaration::SetBlockOffset(uint32_t a_offset)
+  {
+    m_blockOffset = a_offset;
+  }
+
+  uint32_t ShaderUniformDeclaration::GetBlockOffset() const
+  {
+    return m_blockOffset;
+  }
+
+  bool ShaderUniformDeclaration::IsInBlock() const
+  {
+    return m_blockOffset != INVALID_INDEX;
+  }
+
   bool operator==(ShaderUniformDeclaration const& a_uniform_0, ShaderUniformDeclaration const& a_uniform_1)
   {
     bool result = a_uniform_0.m_name == a_uniform_1.m_name;
     result = result && (a_uniform_0.m_type == a_uniform_1.m_type);
     result = result && (a_uniform_0.m_count == a_uniform_1.m_count);
+    result = result && (a_uniform_0.m_isArray == a_uniform_1.m_isArray);
     return result;
   }
 
@@ -321,7 +339,8 @@ namespace Engine
       bool isArray = false;
       if (match.str(3) != "")
       {
-        BSR_ASSERT(Dg::StringToNumber<uint32_t>(count, match.str(3), std::dec), "");
+        bool parsed = Dg::StringToNumber<uint32_t>(count, match.str(3), std::dec);
+        BSR_ASSERT(parsed, "Failed to parse the array size!");
         isArray = true;
       }
       result.push_back(varDecl{match.str(1), match.str(2), isArray, count});
@@ -359,24 +378,81 @@ namespace Engine
 
   ShaderData::ShaderData()
     : m_dataSize(0)
+    , m_blockSize(0)
   {
 
   }
 
   ShaderData::ShaderData(std::initializer_list<ShaderSourceElement> const& a_data)
     : m_dataSize(0)
+    , m_blockSize(0)
   {
     Init(a_data);
   }
 
+  ShaderData::ShaderData(ShaderData const & a_base, std::string const & a_defines)
+    : m_dataSize(a_base.m_dataSize)
+    , m_blockSize(a_base.m_blockSize)
+    , m_input(a_base.m_input)
+    , m_source(a_base.m_source)
+    , m_uniforms(a_base.m_uniforms)
+    , m_textures(a_base.m_textures)
+  {
+    for (int i = 0; i < ShaderDomain_COUNT; i++)
+    {
+      std::string src = m_source.Get(ShaderDomain(i));
+      if (src.empty())
+        continue;
+      ShaderSource::InsertAfterPreamble(src, a_defines);
+      m_source.Set(ShaderDomain(i), src);
+    }
+  }
+
   void ShaderData::Init(std::initializer_list<ShaderSourceElement> const& a_data)
   {
     Clear();
-    m_source.Init(a_data);
+    m_input.Init(a_data);
+    m_source = m_input;
     Parse();
     PostProcess();
   }
 
+  ShaderData * ShaderData::CreateReloaded() const
+  {
+    ShaderSource input = m_input;
+    if (!input.ReloadFiles())
+      return nullptr;
+
+    ShaderData * pResult = new ShaderData();
+    pResult->m_input = input;
+    pResult->m_source = input;
+    pResult->Parse();
+    pResult->PostProcess();
+    return pResult;
+  }
+
+  static bool SameDeclarations(ShaderUniformList const & a_list0, ShaderUniformList const & a_list1)
+  {
+    if (a_list0.size() != a_list1.size())
+      return false;
+
+    for (size_t i = 0; i < a_list0.size(); i++)
+    {
+      if (!(a_list0[i] == a_list1[i]))
+        return false;
+    }
+    return true;
+  }
+
+  bool ShaderData::HasSameUniforms(ShaderData const & a_other) const
+  {
+    if (m_dataSize != a_other.m_dataSize || m_blockSize != a_other.m_blockSize)
+      return false;
+
+    return SameDeclarations(m_uniforms, a_other.m_uniforms)
+      && SameDeclarations(m_textures, a_other.m_textures);
+  }
+
   void ShaderData::Log()
   {
     for (auto& un : m_uniforms)
@@ -385,6 +461,7 @@ namespace Engine
 
   void ShaderData::Clear()
   {
+    m_blockSize = 0;
     m_uniforms.clear();
     //m_textures.clear();
   }
@@ -398,6 +475,133 @@ namespace Engine
       ExtractUniforms(ShaderDomain(i), structList);
       //ExtractUniformBlocks(ShaderDomain(i));
     }
+    LayoutUniformBlock();
+  }
+
+  /*
+    Moves all loose, non-texture uniforms into a std140 block. Each source which declared 
+    any of them gets the same block, inserted after the #version and #extension lines:
+
+      layout(std140) uniform BSR_MaterialBlock
+      {
+        vec2 windowSize;
+        vec4 colour;
+      };
+
+    As the block has no instance name the shader code does not need to change. The
+    block is filled from a ring of uniform buffers, see RT_UniformBufferRing.
+  */
+  void ShaderData::LayoutUniformBlock()
+  {
+    m_blockSize = 0;
+
+#ifdef ENABLE_MATERIAL_UNIFORM_BLOCKS
+    // Flattened struct fields cannot be redeclared in a block, so fall back to glUniform*
+    bool hasBlockUniforms = false;
+    for (auto const & uniform : m_uniforms)
+    {
+      if (uniform.GetType() == ShaderDataType::TEXTURE2D)
+        continue;
+      if (uniform.GetName().find('.') != std::string::npos)
+        return;
+      hasBlockUniforms = true;
+    }
+
+    if (!hasBlockUniforms)
+      return;
+
+    std::string block = std::string("layout(std140) uniform ") + UniformBlockName() + "\n{\n";
+    uint32_t offset = 0;
+    for (auto & uniform : m_uniforms)
+    {
+      if (uniform.GetType() == ShaderDataType::TEXTURE2D)
+        continue;
+
+      offset = ALIGN(offset, Std140Alignment(uniform.GetType(), uniform.IsArray()));
+      uniform.SetBlockOffset(offset);
+      offset += Std140Size(uniform.GetType(), uniform.IsArray(), uniform.GetCount());
+
+      block += "  " + ShaderDataTypeToString(uniform.GetType()) + " " + uniform.GetName();
+      if (uniform.IsArray())
+        block += "[" + std::to_string(uniform.GetCount()) + "]";
+      block += ";\n";
+    }
+    block += "};\n";
+    m_blockSize = ALIGN(offset, 16);
+
+    for (int i = 0; i < ShaderDomain_COUNT; i++)
+    {
+      ShaderDomain domain = ShaderDomain(i);
+      std::string subject = m_source.Get(domain);
+      std::string result;
+      bool removed = false;
+
+      std::smatch match;
+      std::regex r(UNIFORM_VAR_EXPRESSION);
+      while (regex_search(subject, match, r))
+      {
+        result += match.prefix().str();
+        if (IsTypeStringTexture(match.str(1)))
+          result += match.str(0);
+        else
+          removed = true;
+        subject = match.suffix().str();
+      }
+      result += subject;
+
+      if (!removed)
+        continue;
+
+      ShaderSource::InsertAfterPreamble(result, block);
+      m_source.Set(domain, result);
+    }
+#endif
+  }
+
+  void ShaderData::PackUniformBlock(byte const * a_pBuf, byte * a_pBlock) const
+  {
+    // Uniforms which have never been set read as zero, as they would in a fresh program
+    memset(a_pBlock, 0, m_blockSize);
+
+    for (auto const & uniform : m_uniforms)
+    {
+      if (!uniform.IsInBlock())
+        continue;
+
+      UniformBufferElementHeader header;
+      byte const * pSrc = static_cast<byte const *>(header.Deserialize(a_pBuf + uniform.GetDataOffset()));
+      if (header.GetSize() == 0)
+        continue;
+
+      ShaderDataType type = uniform.GetType();
+      byte * pDst = a_pBlock + uniform.GetBlockOffset();
+      uint32_t elementSize = SizeOfShaderDataType(type);
+      uint32_t count = header.GetSize() / elementSize;
+
+      if (GetShaderDataClass(type) == ShaderDataClass::Matrix)
+      {
+        // Columns are padded out to a vec4
+        uint32_t columns = GetMatrixColumnCount(type);
+        uint32_t columnSize = elementSize / columns;
+        for (uint32_t c = 0; c < count * columns; c++)
+          memcpy(pDst + c * 16, pSrc + c * columnSize, columnSize);
+      }
+      else if (uniform.IsArray())
+      {
+        uint32_t stride = Std140ArrayStride(type);
+        for (uint32_t e = 0; e < count; e++)
+          memcpy(pDst + e * stride, pSrc + e * elementSize, elementSize);
+      }
+      else
+      {
+        memcpy(pDst, pSrc, elementSize);
+      }
+    }
+  }
+
+  char const * ShaderData::UniformBlockName()
+  {
+    return "BSR_MaterialBlock";
   }
 
   void ShaderData::PostProcess()
@@ -532,6 +736,11 @@ namespace Engine
     return m_dataSize;
   }
 
+  uint32_t ShaderData::GetUniformBlockSize() const
+  {
+    return m_blockSize;
+  }
+
   ShaderSource const& ShaderData::GetShaderSource() const
   {
     return m_source;
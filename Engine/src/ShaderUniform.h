@@ -25,6 +25,7 @@
 
 #include "BSR_Assert.h"
 #include "Memory.h"
+#include "Utils.h"
 #include "RenderResource.h"
 #include "ShaderUtils.h"
 #include "ShaderSource.h"
@@ -88,9 +89,15 @@ namespace Engine
     void SetDataOffset(uint32_t offset);
     uint32_t GetDataOffset() const;
 
+    // Offset into the std140 material block. INVALID_INDEX if the uniform is not in the block.
+    void SetBlockOffset(uint32_t offset);
+    uint32_t GetBlockOffset() const;
+    bool IsInBlock() const;
+
   private:
 
     uint32_t m_dataOffset;
+    uint32_t m_blockOffset;
 
     bool m_isArray;
     std::string m_name;
@@ -108,15 +115,38 @@ namespace Engine
   public:
 
     ShaderData(std::initializer_list<ShaderSourceElement> const &);
+
+    // A copy of 'base' with 'defines' inserted after the #version and #extension lines. 
+    // Uniforms are parsed without running the preprocessor, so the variant has the same 
+    // uniforms as the base, and materials can be used with either.
+    ShaderData(ShaderData const & base, std::string const & defines);
     static Ref<ShaderData> Create(std::initializer_list<ShaderSourceElement> const &);
 
     void Init(std::initializer_list<ShaderSourceElement> const&);
 
+    // Reads the source files again and parses the result. Sources given as strings are
+    // kept. Returns nullptr if a file could not be read.
+    ShaderData * CreateReloaded() const;
+
+    // Same uniforms and textures in the same order, so material buffers and texture
+    // bindings work with both.
+    bool HasSameUniforms(ShaderData const &) const;
+
     void Clear();
     ShaderUniformDeclaration* FindUniform(std::string const&);
     uint32_t FindUniformIndex(std::string const&) const;
 
     uint32_t GetUniformDataSize() const;
+
+    // Size of the std140 block holding all the non-texture uniforms. 0 if the
+    // uniforms are uploaded one at a time.
+    uint32_t GetUniformBlockSize() const;
+
+    // Convert a material uniform buffer to the std140 layout of the uniform block.
+    void PackUniformBlock(byte const * uniformBuffer, byte * block) const;
+
+    // The name of the block added to the shader source.
+    static char const * UniformBlockName();
     ShaderSource const & GetShaderSource() const;
     ShaderUniformList const & GetUniforms() const;
     ShaderUniformList & GetUniforms();
@@ -134,11 +164,14 @@ namespace Engine
     void PostProcess();
     void ExtractStructs(ShaderDomain, ShaderStructList &);
     void ExtractUniforms(ShaderDomain, ShaderStructList const &);
+    void LayoutUniformBlock();
     static size_t FindStruct(std::string const &, ShaderStructList const &);
     void PushUniform(ShaderUniformDeclaration);
   private:
     uint32_t            m_dataSize;
+    uint32_t            m_blockSize;
 
+    ShaderSource        m_input;  // As given, before the uniform block was added
     ShaderSource        m_source;
     ShaderUniformList   m_uniforms;
     ShaderUniformList   m_textures;
@@ -156,6 +156,64 @@ namespace Engine
     return s_sizes[static_cast<uint32_t>(a_type)];
   }
 
+  uint32_t GetMatrixColumnCount(ShaderDataType a_type)
+  {
+    switch (a_type)
+    {
+      case ShaderDataType::MAT2:
+      case ShaderDataType::MAT2x2:
+      case ShaderDataType::MAT2x3:
+      case ShaderDataType::MAT2x4:
+        return 2;
+      case ShaderDataType::MAT3:
+      case ShaderDataType::MAT3x3:
+      case ShaderDataType::MAT3x2:
+      case ShaderDataType::MAT3x4:
+        return 3;
+      case ShaderDataType::MAT4:
+      case ShaderDataType::MAT4x4:
+      case ShaderDataType::MAT4x2:
+      case ShaderDataType::MAT4x3:
+        return 4;
+    }
+    BSR_ASSERT(false, "Not a matrix type!");
+    return 0;
+  }
+
+  /*
+    std140 rules, from the OpenGL spec section 7.6.2.2:
+      - Scalars are aligned to their size, 4 bytes.
+      - vec2 is aligned to 8 bytes, vec3 and vec4 to 16 bytes.
+      - Arrays and matrix columns are aligned to 16 bytes, and each element
+        or column is padded out to 16 bytes.
+  */
+  uint32_t Std140Alignment(ShaderDataType a_type, bool a_isArray)
+  {
+    ShaderDataClass dataClass = GetShaderDataClass(a_type);
+    if (a_isArray || dataClass == ShaderDataClass::Matrix)
+      return 16;
+
+    uint32_t baseSize = SizeOfShaderDataBaseType(GetShaderDataBaseType(a_type));
+    uint32_t components = GetComponentCount(a_type);
+    if (components == 3)
+      components = 4;
+    return baseSize * components;
+  }
+
+  uint32_t Std140ArrayStride(ShaderDataType a_type)
+  {
+    if (GetShaderDataClass(a_type) == ShaderDataClass::Matrix)
+      return 16 * GetMatrixColumnCount(a_type);
+    return 16;
+  }
+
+  uint32_t Std140Size(ShaderDataType a_type, bool a_isArray, uint32_t a_count)
+  {
+    if (a_isArray || GetShaderDataClass(a_type) == ShaderDataClass::Matrix)
+      return Std140ArrayStride(a_type) * a_count;
+    return SizeOfShaderDataType(a_type);
+  }
+
   GLenum ShaderDataTypeToOpenGLType(ShaderDataType const a_type)
   {
     return SDT_data[static_cast<uint32_t>(a_type)].glenum;
@@ -103,6 +103,14 @@ namespace Engine
 
   uint32_t SizeOfShaderDataBaseType(ShaderDataBaseType);
 
+  // Number of columns of a matrix type, eg 3 for mat3x4.
+  uint32_t GetMatrixColumnCount(ShaderDataType);
+
+  // Layout of a member of a std140 uniform block.
+  uint32_t Std140Alignment(ShaderDataType, bool isArray);
+  uint32_t Std140ArrayStride(ShaderDataType);
+  uint32_t Std140Size(ShaderDataType, bool isArray, uint32_t count);
+
   //------------------------------------------------------------------------------------
   // OpenGL specific
   //------------------------------------------------------------------------------------
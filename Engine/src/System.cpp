@@ -1,6 +1,7 @@
 //@group Systems
 
 #include "System.h"
+#include "Message.h"
 
 namespace Engine
 {
@@ -9,4 +10,39 @@ namespace Engine
     static SystemID s_currentID = 0;
     return ++s_currentID;
   }
-}
\ No newline at end of file
+
+  void System::Subscribe(uint32_t a_messageID)
+  {
+    m_messageIDs.push_back(a_messageID);
+  }
+
+  void System::SubscribeToCategory(uint32_t a_category)
+  {
+    m_categories.push_back(a_category);
+  }
+
+  void System::SubscribeToAll()
+  {
+    m_allMessages = true;
+  }
+
+  bool System::IsSubscribed(uint32_t a_messageID) const
+  {
+    if (m_allMessages)
+      return true;
+
+    for (uint32_t id : m_messageIDs)
+    {
+      if (id == a_messageID)
+        return true;
+    }
+
+    uint32_t category = Message::GetCategory(a_messageID);
+    for (uint32_t c : m_categories)
+    {
+      if (c == category)
+        return true;
+    }
+    return false;
+  }
+}
@@ -4,6 +4,7 @@
 #define EN_SYSTEM_H
 
 #include <stdint.h>
+#include "DgDynamicArray.h"
 #include "utils.h"
 #include "MessageHandler.h"
 #include "Memory.h"
@@ -43,10 +44,25 @@ namespace Engine
     virtual void Update(float dt) =0;
     virtual void Render() {}
 
+    // Messages are only offered to systems which have subscribed to them.
+    bool IsSubscribed(uint32_t messageID) const;
+
   protected:
 
     static SystemID _GetNewID();
 
+    // Call these from OnAttach(). The SystemStack reads the subscriptions once the 
+    // system has been attached.
+    void Subscribe(uint32_t messageID);
+    void SubscribeToCategory(uint32_t category);
+    void SubscribeToAll();
+
+  private:
+
+    Dg::DynamicArray<uint32_t> m_messageIDs;
+    Dg::DynamicArray<uint32_t> m_categories;
+    bool m_allMessages = false;
+
     //System(System const &);
     //System & operator=(System const &);
   };
@@ -22,6 +22,8 @@
 namespace Engine
 {
   SystemStack::SystemStack()
+    : m_subscribersDirty(false)
+    , m_dispatching(false)
   {
 
   }
@@ -35,30 +37,111 @@ namespace Engine
   {
     BSR_ASSERT(a_pLayer != nullptr);
 
+    if (m_dispatching)
+    {
+      if (WillBeOnStack(a_ID))
+        return false;
+      m_pending.push_back({a_ID, a_pLayer});
+      return true;
+    }
+
     if (Find(a_ID) != m_systemStack.end())
       return false;
 
     m_systemStack.push_back({a_ID, a_pLayer});
     a_pLayer->OnAttach();
+    m_subscribersDirty = true;
     return true;
   }
 
   void SystemStack::PopSystem(SystemID a_ID)
   {
+    if (m_dispatching)
+    {
+      m_pending.push_back({a_ID, nullptr});
+      return;
+    }
+
     auto it = Find(a_ID);
     if (it != m_systemStack.end())
     {
       it->second->OnDetach();
       delete it->second;
       m_systemStack.erase(it);
+      m_subscribersDirty = true;
     }
   }
 
   void SystemStack::Clear()
   {
+    BSR_ASSERT(!m_dispatching);
+    for (size_t i = 0; i < m_pending.size(); i++)
+      delete m_pending[i].pSystem;
+    m_pending.clear();
+
     for (auto kv : m_systemStack)
       delete kv.second;
     m_systemStack.clear();
+    m_subscribersDirty = true;
+  }
+
+  Dg::DynamicArray<System *> const & SystemStack::GetSubscribers(uint32_t a_messageID)
+  {
+    if (m_subscribersDirty)
+    {
+      m_subscribers.clear();
+      m_subscribersDirty = false;
+    }
+
+    Dg::DynamicArray<System *> * pSubscribers = m_subscribers.at(a_messageID);
+    if (pSubscribers != nullptr)
+      return *pSubscribers;
+
+    Dg::DynamicArray<System *> subscribers;
+    for (auto const & kv : m_systemStack)
+    {
+      if (kv.second->IsSubscribed(a_messageID))
+        subscribers.push_back(kv.second);
+    }
+    m_subscribers.insert(a_messageID, subscribers);
+    return *m_subscribers.at(a_messageID);
+  }
+
+  void SystemStack::BeginDispatch()
+  {
+    BSR_ASSERT(!m_dispatching);
+    m_dispatching = true;
+  }
+
+  void SystemStack::EndDispatch()
+  {
+    BSR_ASSERT(m_dispatching);
+    m_dispatching = false;
+
+    // A push we accepted during dispatch can still be refused here if OnAttach() of an
+    // earlier system pushed the same ID. We own the system by then, so delete it.
+    for (size_t i = 0; i < m_pending.size(); i++)
+    {
+      PendingChange change = m_pending[i];
+      if (change.pSystem == nullptr)
+        PopSystem(change.id);
+      else if (!PushSystem(change.pSystem, change.id))
+        delete change.pSystem;
+    }
+    m_pending.clear();
+  }
+
+  bool SystemStack::WillBeOnStack(SystemID a_ID)
+  {
+    // The last pending change for this ID decides whether it will be on the stack.
+    bool onStack = Find(a_ID) != m_systemStack.end();
+
+    for (size_t i = 0; i < m_pending.size(); i++)
+    {
+      if (m_pending[i].id == a_ID)
+        onStack = (m_pending[i].pSystem != nullptr);
+    }
+    return onStack;
   }
 
   System * SystemStack::GetSystem(SystemID a_ID)
@@ -21,6 +21,8 @@
 
 #include <stdint.h>
 #include "DgDoublyLinkedList.h"
+#include "DgDynamicArray.h"
+#include "DgOpenHashMap.h"
 #include "System.h"
 
 namespace Engine
@@ -35,21 +37,43 @@ namespace Engine
     SystemStack();
     ~SystemStack();
 
+    // While a message is being dispatched, pushes and pops are queued and applied in
+    // order by EndDispatch(). A popped system is not deleted until then.
     bool PushSystem(System *, SystemID);
     void PopSystem(SystemID);
     System * GetSystem(SystemID);
     void Clear();
 
+    // Systems subscribed to this message, in stack order. The list is built the first 
+    // time a message ID is seen and is invalidated whenever the stack changes.
+    Dg::DynamicArray<System *> const & GetSubscribers(uint32_t messageID);
+
+    // Brackets the handling of a single message by the dispatcher.
+    void BeginDispatch();
+    void EndDispatch();
+
     List::iterator begin();
     List::iterator end();
 
   private:
 
     List::iterator Find(SystemID);
+    bool WillBeOnStack(SystemID);
 
   private:
 
+    // pSystem is nullptr for a pop
+    struct PendingChange
+    {
+      SystemID  id;
+      System *  pSystem;
+    };
+
     List  m_systemStack;
+    Dg::OpenHashMap<uint32_t, Dg::DynamicArray<System *>> m_subscribers;
+    Dg::DynamicArray<PendingChange> m_pending;
+    bool  m_subscribersDirty;
+    bool  m_dispatching;
   };
 }
 
@@ -19,7 +19,7 @@ namespace Engine
 
   void System_Application::OnAttach()
   {
-
+    Subscribe(Message_Command::GetStaticID());
   }
 
   void System_Application::OnDetach()
@@ -24,6 +24,12 @@ namespace Engine
     delete m_pScreen;
   }
 
+  void System_GUI::OnAttach()
+  {
+    Subscribe(Message_Window_Resized::GetStaticID());
+    SubscribeToCategory(MC_GUI);
+  }
+
   void System_GUI::HandleMessage(Message * a_pMsg)
   {
     DISPATCH_MESSAGE(Message_Window_Resized);
@@ -52,8 +58,10 @@ namespace Engine
   {
     GlobalRenderState *pState = Renderer::GetGlobalRenderState();
     Renderer::Disable(RenderFeature::DepthTest);
-    Renderer::Enable(RenderFeature::Sissor);
+    Renderer::Disable(RenderFeature::Sissor);
+    GUI::Renderer::UpdateFontAtlas();
     m_pScreen->Draw();
+    GUI::Renderer::Flush();
     Renderer::SetRenderState(pState);
   }
 
@@ -18,6 +18,7 @@ namespace Engine
     System_GUI(int windowW, int windowH);
     ~System_GUI();
 
+    void OnAttach() override;
     void HandleMessage(Message *) override;
 
     void Update(float);
@@ -26,7 +26,8 @@ namespace Engine
 
   void System_Window::OnAttach()
   {
-
+    Subscribe(Message_Quit::GetStaticID());
+    SubscribeToCategory(MC_Window);
   }
 
   void System_Window::OnDetach()
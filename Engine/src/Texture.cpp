@@ -1,10 +1,13 @@
 //@group Renderer
 
+#include <cstring>
+
 #include "Texture.h"
 #include "RenderState.h"
 #include "Renderer.h"
 #include "RT_Texture.h"
 #include "RenderThreadData.h"
+#include "TextureProcessing.h"
 
 namespace Engine
 {
@@ -21,6 +24,29 @@ namespace Engine
   void Texture2D::Set(uint32_t a_width, uint32_t a_height, void * a_pPixels, TextureAttributes a_attrs)
   {
     m_data.Set(a_width, a_height, a_pPixels, a_attrs);
+    m_mipmaps.clear();
+  }
+
+  Dg::ErrorCode Texture2D::Resize(ResizeMethod a_method, uint32_t a_factor)
+  {
+    TextureData scaled;
+    Dg::ErrorCode result = TextureProcessing::UpscaleCached(m_data, a_method, a_factor, scaled);
+    if (result != Dg::ErrorCode::None)
+      return result;
+
+    m_data = std::move(scaled);
+    m_mipmaps.clear();
+    return Dg::ErrorCode::None;
+  }
+
+  Dg::ErrorCode Texture2D::GenerateMipmaps(MipmapKernel a_kernel)
+  {
+    Dg::ErrorCode result = TextureProcessing::GenerateMipmaps(m_data, a_kernel, m_mipmaps);
+    if (result != Dg::ErrorCode::None)
+      return result;
+
+    m_data.attrs.SetIsMipmapped(true);
+    return Dg::ErrorCode::None;
   }
 
   Texture2D::~Texture2D()
@@ -49,16 +75,24 @@ namespace Engine
     state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
     state.Set<RenderState::Attr::Command>(RenderState::Command::TextureCreate);
 
-    TextureData * pData = new TextureData();
-    pData->Duplicate(m_data);
+    // Level 0, then any mipmaps built on the CPU
+    uint32_t levelCount = 1 + static_cast<uint32_t>(m_mipmaps.size());
+    TextureData * pData = new TextureData[levelCount];
+    pData[0].Duplicate(m_data);
+    for (uint32_t i = 1; i < levelCount; i++)
+    {
+      pData[i].Duplicate(m_mipmaps[i - 1]);
+      pData[i].attrs = m_data.attrs;
+    }
     
     if (freePixels)
     {
       delete[] m_data.pPixels;
       m_data.pPixels = nullptr;
+      m_mipmaps.clear();
     }
 
-    RENDER_SUBMIT(state, [resID = m_id, pData = pData]() mutable
+    RENDER_SUBMIT(state, [resID = m_id, pData = pData, levelCount = levelCount]() mutable
     {
       // TODO all of these we should check that *ptr != nullptr, but really, nullptrs should not be in RenderThreadData
       RT_Texture2D ** ppTexture = RenderThreadData::Instance()->textures.at(resID);
@@ -69,14 +103,38 @@ namespace Engine
         RenderThreadData::Instance()->textures.erase(resID);
       }
         
-      RenderThreadData::Instance()->textures.insert(resID, RT_Texture2D::Create(*pData));
-      delete pData;
+      RenderThreadData::Instance()->textures.insert(resID, RT_Texture2D::Create(pData, levelCount));
+      delete[] pData;
+    });
+  }
+
+  void Texture2D::SetSubData(uint32_t a_x, uint32_t a_y, uint32_t a_width, uint32_t a_height, void const * a_pPixels)
+  {
+    RenderState state = RenderState::Create();
+    state.Set<RenderState::Attr::Type>(RenderState::Type::Command);
+    state.Set<RenderState::Attr::Command>(RenderState::Command::TextureSetSubData);
+
+    size_t size = size_t(a_width) * a_height * GetPixelSize(m_data.attrs.GetPixelType());
+    void * pPixels = RENDER_ALLOCATE(size);
+    memcpy(pPixels, a_pPixels, size);
+
+    RENDER_SUBMIT(state, [resID = m_id, x = a_x, y = a_y, w = a_width, h = a_height, pPixels = pPixels]()
+    {
+      RT_Texture2D ** ppTexture =  RenderThreadData::Instance()->textures.at(resID);
+      if (ppTexture == nullptr)
+      {
+        LOG_WARN("Texture2D::SetSubData(): ID '{}' does not exist!", resID);
+        return;
+      }
+
+      (*ppTexture)->SetSubData(x, y, w, h, pPixels);
     });
   }
 
   void Texture2D::Clear()
   {
     m_data.Clear();
+    m_mipmaps.clear();
   }
 
   void Texture2D::Bind(uint32_t a_slot) const
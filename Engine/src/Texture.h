@@ -20,19 +20,15 @@
 #define TEXTURE_H
 
 #include <stdint.h>
+#include <vector>
 #include "TextureData.h"
 #include "Utils.h"
 #include "RenderResource.h"
 #include "Memory.h"
+#include "DgError.h"
 
 namespace Engine
 {
-  enum class ResizeMethod
-  {
-    HQx,
-    BRz
-  };
-
   class Texture2D : public RenderResource
   {
     Texture2D();
@@ -49,6 +45,10 @@ namespace Engine
 
     void Set(uint32_t width, uint32_t height, void * pPixels, TextureAttributes attrs);
 
+    // Overwrite a region of the uploaded texture. The pixels are copied, and must be the 
+    // pixel type the texture was set with.
+    void SetSubData(uint32_t x, uint32_t y, uint32_t width, uint32_t height, void const * pPixels);
+
     //Loading...
     //bool LoadFromRawData(uint32_t width, uint32_t height, TextureWrap wrap, Colour* pixels, TextureFlags flags);
     //bool LoadFromDataFile(void const*);
@@ -59,7 +59,15 @@ namespace Engine
     //uint32_t GetHeight() const;
 
     //void Resize(uint32_t width, uint32_t height);
-    //void Resize(ResizeMethod, int factor);
+
+    // Scale the pixels up by a factor of 2, 3 or 4, before uploading. Results are cached on
+    // disk, so a texture is only scaled the first time it is seen. ResizeMethod::HQx is not
+    // implemented yet.
+    Dg::ErrorCode Resize(ResizeMethod, uint32_t factor);
+
+    // Build the mip chain on worker threads, before uploading. The texture is then
+    // uploaded with these levels, rather than having the driver generate them.
+    Dg::ErrorCode GenerateMipmaps(MipmapKernel);
 
     //Colour& GetPixel(uint32_t width, uint32_t height);
     //void SetPixel(uint32_t width, uint32_t height, Colour value);
@@ -70,7 +78,8 @@ namespace Engine
 
   private:
 
-    TextureData m_data;
+    TextureData               m_data;
+    std::vector<TextureData>  m_mipmaps;
   };
 }
 
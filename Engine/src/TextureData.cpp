@@ -98,7 +98,7 @@ namespace Engine
   void TextureAttributes::SetIsMipmapped(bool a_val)
   {
     uint32_t val = a_val ? 1 : 0;
-    m_data = Dg::SetSubInt<uint32_t, static_cast<uint32_t>(Begin::MipmapFilter), static_cast<uint32_t>(Size::MipmapFilter)>(m_data, val);
+    m_data = Dg::SetSubInt<uint32_t, static_cast<uint32_t>(Begin::IsMipmapped), static_cast<uint32_t>(Size::IsMipmapped)>(m_data, val);
   }
 
   uint32_t TextureAttributes::GetData() const
@@ -167,6 +167,7 @@ namespace Engine
   {
     if (this != &a_other)
     {
+      Clear();
       attrs = a_other.attrs;
       width = a_other.width;
       height = a_other.height;
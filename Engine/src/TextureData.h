@@ -31,6 +31,20 @@ namespace Engine
     Linear_Linear
   };
 
+  // Pixel art upscalers, see TextureProcessing::Upscale()
+  enum class ResizeMethod
+  {
+    HQx,  // Not implemented, Upscale() returns an error
+    BRz   // xBR
+  };
+
+  // Filters used to build mip chains on the CPU
+  enum class MipmapKernel
+  {
+    Box,
+    Kaiser
+  };
+
   enum class TexturePixelType
   {
     R8,
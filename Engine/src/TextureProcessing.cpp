@@ -0,0 +1,843 @@
+//@group Renderer
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+
+#include "TextureProcessing.h"
+#include "Options.h"
+#include "Log.h"
+#include "JobPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TP_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define TP_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Engine
+{
+  namespace TextureProcessing
+  {
+    static uint32_t const s_Magic = 0x42535254; // 'BSRT'
+    static uint32_t const s_Version = 2;
+
+    struct FileHeader
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint64_t key;
+      uint32_t width;
+      uint32_t height;
+      uint32_t attrs;
+    };
+
+    // Channels in [0, 255]
+    struct RGBA
+    {
+      float v[4];
+    };
+
+    struct Sampler
+    {
+      int32_t     width;
+      int32_t     height;
+      TextureWrap wrap;
+
+      size_t Index(int32_t x, int32_t y) const;
+    };
+
+    //------------------------------------------------------------------------------------------------
+    // Helpful functions
+    //------------------------------------------------------------------------------------------------
+
+    static uint32_t GetSliceCount(uint32_t a_requested, uint32_t a_rows)
+    {
+      uint32_t count = a_requested;
+      if (count == 0)
+        count = JobPool::GetConcurrency();
+
+      // A slice is not worth it for a few rows
+      uint32_t maxCount = a_rows / TEXTURE_MIN_ROWS_PER_SLICE + 1;
+      return std::min(count, maxCount);
+    }
+
+    // Rows are split into contiguous slices, run as jobs on the JobPool. Each slice writes to
+    // its own rows of the output, so the result does not depend on the slice count.
+    template<typename Fn>
+    static void ForEachSlice(uint32_t a_rows, uint32_t a_sliceCount, Fn a_fn)
+    {
+      uint32_t sliceCount = GetSliceCount(a_sliceCount, a_rows);
+      uint32_t sliceSize = (a_rows + sliceCount - 1) / sliceCount;
+
+      JobPool::Run(sliceCount, [&a_fn, a_rows, sliceSize](uint32_t a_slice)
+      {
+        uint32_t begin = std::min(a_rows, a_slice * sliceSize);
+        uint32_t end = std::min(a_rows, (a_slice + 1) * sliceSize);
+        a_fn(begin, end);
+      });
+    }
+
+    static int32_t WrapIndex(int32_t a_i, int32_t a_size, TextureWrap a_wrap)
+    {
+      switch (a_wrap)
+      {
+        case TextureWrap::Repeat:
+        {
+          a_i %= a_size;
+          return a_i < 0 ? a_i + a_size : a_i;
+        }
+        case TextureWrap::Mirror:
+        {
+          int32_t period = 2 * a_size;
+          a_i %= period;
+          if (a_i < 0)
+            a_i += period;
+          return a_i < a_size ? a_i : period - 1 - a_i;
+        }
+        default:
+        {
+          // Border colours are not known here, so clamp
+          return std::min(std::max(a_i, 0), a_size - 1);
+        }
+      }
+    }
+
+    size_t Sampler::Index(int32_t a_x, int32_t a_y) const
+    {
+      return size_t(WrapIndex(a_y, height, wrap)) * width + WrapIndex(a_x, width, wrap);
+    }
+
+    // R8 is expanded to grey, so colour comparisons work on it
+    static std::vector<RGBA> ToRGBA(TextureData const & a_in)
+    {
+      TexturePixelType type = a_in.attrs.GetPixelType();
+      size_t pixelSize = GetPixelSize(type);
+      size_t count = size_t(a_in.width) * a_in.height;
+      std::vector<RGBA> result(count);
+
+      for (size_t i = 0; i < count; i++)
+      {
+        uint8_t const * pPixel = a_in.pPixels + i * pixelSize;
+        RGBA & px = result[i];
+        px = RGBA{{0.f, 0.f, 0.f, 255.f}};
+        for (size_t c = 0; c < pixelSize; c++)
+          px.v[c] = float(pPixel[c]);
+        if (type == TexturePixelType::R8)
+          px.v[1] = px.v[2] = px.v[0];
+      }
+      return result;
+    }
+
+    static uint8_t * FromRGBA(std::vector<RGBA> const & a_in, TexturePixelType a_type)
+    {
+      size_t pixelSize = GetPixelSize(a_type);
+      uint8_t * pPixels = new uint8_t[a_in.size() * pixelSize];
+
+      for (size_t i = 0; i < a_in.size(); i++)
+      {
+        for (size_t c = 0; c < pixelSize; c++)
+          pPixels[i * pixelSize + c] = uint8_t(std::min(std::max(a_in[i].v[c] + 0.5f, 0.f), 255.f));
+      }
+      return pPixels;
+    }
+
+    // FNV-1a
+    static uint64_t Hash(uint64_t a_hash, void const * a_pData, size_t a_size)
+    {
+      unsigned char const * pBytes = static_cast<unsigned char const *>(a_pData);
+      for (size_t i = 0; i < a_size; i++)
+      {
+        a_hash ^= pBytes[i];
+        a_hash *= 0x100000001B3ULL;
+      }
+      return a_hash;
+    }
+
+    static std::filesystem::path GetPath(std::string const & a_directory, uint64_t a_key)
+    {
+      char name[32] = {};
+      snprintf(name, sizeof(name), "%016llx.tex", static_cast<unsigned long long>(a_key));
+      return std::filesystem::path(a_directory) / name;
+    }
+
+    //------------------------------------------------------------------------------------------------
+    // 4-wide floats
+    //------------------------------------------------------------------------------------------------
+
+    // SSE2 on x86, NEON on 64-bit ARM, and plain loops elsewhere. Comparisons give a Mask4,
+    // which is combined with And/Or and applied with Select. Each path does the same IEEE
+    // operations in the same order, so they all give the same output.
+    namespace SIMD
+    {
+#if defined(TP_SSE2)
+      typedef __m128 Float4;
+      typedef __m128 Mask4;
+
+      static Float4 Load(float const * a_p)                 { return _mm_loadu_ps(a_p); }
+      static Float4 Set1(float a_v)                         { return _mm_set1_ps(a_v); }
+      static void   Store(float * a_p, Float4 a_v)          { _mm_storeu_ps(a_p, a_v); }
+      static Float4 Add(Float4 a_a, Float4 a_b)             { return _mm_add_ps(a_a, a_b); }
+      static Float4 Sub(Float4 a_a, Float4 a_b)             { return _mm_sub_ps(a_a, a_b); }
+      static Float4 Mul(Float4 a_a, Float4 a_b)             { return _mm_mul_ps(a_a, a_b); }
+      static Float4 Div(Float4 a_a, Float4 a_b)             { return _mm_div_ps(a_a, a_b); }
+      static Float4 Min(Float4 a_a, Float4 a_b)             { return _mm_min_ps(a_a, a_b); }
+      static Float4 Max(Float4 a_a, Float4 a_b)             { return _mm_max_ps(a_a, a_b); }
+      static Float4 Abs(Float4 a_a)                         { return _mm_andnot_ps(_mm_set1_ps(-0.f), a_a); }
+      static Mask4  Less(Float4 a_a, Float4 a_b)            { return _mm_cmplt_ps(a_a, a_b); }
+      static Mask4  LessEqual(Float4 a_a, Float4 a_b)       { return _mm_cmple_ps(a_a, a_b); }
+      static Mask4  GreaterEqual(Float4 a_a, Float4 a_b)    { return _mm_cmpge_ps(a_a, a_b); }
+      static Mask4  NotEqual(Float4 a_a, Float4 a_b)        { return _mm_cmpneq_ps(a_a, a_b); }
+      static Mask4  And(Mask4 a_a, Mask4 a_b)               { return _mm_and_ps(a_a, a_b); }
+      static Mask4  Or(Mask4 a_a, Mask4 a_b)                { return _mm_or_ps(a_a, a_b); }
+      static Float4 Select(Mask4 a_m, Float4 a_a, Float4 a_b) { return _mm_or_ps(_mm_and_ps(a_m, a_a), _mm_andnot_ps(a_m, a_b)); }
+      static int    Bits(Mask4 a_m)                         { return _mm_movemask_ps(a_m); }
+
+      // Lane l of the result is lane (l + N) % 4 of the input
+      template<int N>
+      static Float4 Rotate(Float4 a_a)                      { return _mm_shuffle_ps(a_a, a_a, _MM_SHUFFLE((N + 3) & 3, (N + 2) & 3, (N + 1) & 3, N & 3)); }
+#elif defined(TP_NEON)
+      typedef float32x4_t Float4;
+      typedef uint32x4_t Mask4;
+
+      static Float4 Load(float const * a_p)                 { return vld1q_f32(a_p); }
+      static Float4 Set1(float a_v)                         { return vdupq_n_f32(a_v); }
+      static void   Store(float * a_p, Float4 a_v)          { vst1q_f32(a_p, a_v); }
+      static Float4 Add(Float4 a_a, Float4 a_b)             { return vaddq_f32(a_a, a_b); }
+      static Float4 Sub(Float4 a_a, Float4 a_b)             { return vsubq_f32(a_a, a_b); }
+      static Float4 Mul(Float4 a_a, Float4 a_b)             { return vmulq_f32(a_a, a_b); }
+      static Float4 Div(Float4 a_a, Float4 a_b)             { return vdivq_f32(a_a, a_b); }
+      static Float4 Min(Float4 a_a, Float4 a_b)             { return vminq_f32(a_a, a_b); }
+      static Float4 Max(Float4 a_a, Float4 a_b)             { return vmaxq_f32(a_a, a_b); }
+      static Float4 Abs(Float4 a_a)                         { return vabsq_f32(a_a); }
+      static Mask4  Less(Float4 a_a, Float4 a_b)            { return vcltq_f32(a_a, a_b); }
+      static Mask4  LessEqual(Float4 a_a, Float4 a_b)       { return vcleq_f32(a_a, a_b); }
+      static Mask4  GreaterEqual(Float4 a_a, Float4 a_b)    { return vcgeq_f32(a_a, a_b); }
+      static Mask4  NotEqual(Float4 a_a, Float4 a_b)        { return vmvnq_u32(vceqq_f32(a_a, a_b)); }
+      static Mask4  And(Mask4 a_a, Mask4 a_b)               { return vandq_u32(a_a, a_b); }
+      static Mask4  Or(Mask4 a_a, Mask4 a_b)                { return vorrq_u32(a_a, a_b); }
+      static Float4 Select(Mask4 a_m, Float4 a_a, Float4 a_b) { return vbslq_f32(a_m, a_a, a_b); }
+
+      static int Bits(Mask4 a_m)
+      {
+        static uint32_t const s_bits[4] = {1, 2, 4, 8};
+        return int(vaddvq_u32(vandq_u32(a_m, vld1q_u32(s_bits))));
+      }
+
+      // Lane l of the result is lane (l + N) % 4 of the input
+      template<int N>
+      static Float4 Rotate(Float4 a_a)                      { return vextq_f32(a_a, a_a, N & 3); }
+#else
+      struct Float4
+      {
+        float v[4];
+      };
+
+      struct Mask4
+      {
+        bool v[4];
+      };
+
+      template<typename Fn>
+      static Float4 Map(Fn a_fn)
+      {
+        Float4 result;
+        for (int l = 0; l < 4; l++)
+          result.v[l] = a_fn(l);
+        return result;
+      }
+
+      template<typename Fn>
+      static Mask4 Test(Fn a_fn)
+      {
+        Mask4 result;
+        for (int l = 0; l < 4; l++)
+          result.v[l] = a_fn(l);
+        return result;
+      }
+
+      static Float4 Load(float const * a_p)                 { return Map([=](int l) { return a_p[l]; }); }
+      static Float4 Set1(float a_v)                         { return Map([=](int) { return a_v; }); }
+      static void   Store(float * a_p, Float4 a_v)          { for (int l = 0; l < 4; l++) a_p[l] = a_v.v[l]; }
+      static Float4 Add(Float4 a_a, Float4 a_b)             { return Map([&](int l) { return a_a.v[l] + a_b.v[l]; }); }
+      static Float4 Sub(Float4 a_a, Float4 a_b)             { return Map([&](int l) { return a_a.v[l] - a_b.v[l]; }); }
+      static Float4 Mul(Float4 a_a, Float4 a_b)             { return Map([&](int l) { return a_a.v[l] * a_b.v[l]; }); }
+      static Float4 Div(Float4 a_a, Float4 a_b)             { return Map([&](int l) { return a_a.v[l] / a_b.v[l]; }); }
+      static Float4 Min(Float4 a_a, Float4 a_b)             { return Map([&](int l) { return a_a.v[l] < a_b.v[l] ? a_a.v[l] : a_b.v[l]; }); }
+      static Float4 Max(Float4 a_a, Float4 a_b)             { return Map([&](int l) { return a_a.v[l] > a_b.v[l] ? a_a.v[l] : a_b.v[l]; }); }
+      static Float4 Abs(Float4 a_a)                         { return Map([&](int l) { return fabsf(a_a.v[l]); }); }
+      static Mask4  Less(Float4 a_a, Float4 a_b)            { return Test([&](int l) { return a_a.v[l] < a_b.v[l]; }); }
+      static Mask4  LessEqual(Float4 a_a, Float4 a_b)       { return Test([&](int l) { return a_a.v[l] <= a_b.v[l]; }); }
+      static Mask4  GreaterEqual(Float4 a_a, Float4 a_b)    { return Test([&](int l) { return a_a.v[l] >= a_b.v[l]; }); }
+      static Mask4  NotEqual(Float4 a_a, Float4 a_b)        { return Test([&](int l) { return a_a.v[l] != a_b.v[l]; }); }
+      static Mask4  And(Mask4 a_a, Mask4 a_b)               { return Test([&](int l) { return a_a.v[l] && a_b.v[l]; }); }
+      static Mask4  Or(Mask4 a_a, Mask4 a_b)                { return Test([&](int l) { return a_a.v[l] || a_b.v[l]; }); }
+      static Float4 Select(Mask4 a_m, Float4 a_a, Float4 a_b) { return Map([&](int l) { return a_m.v[l] ? a_a.v[l] : a_b.v[l]; }); }
+
+      static int Bits(Mask4 a_m)
+      {
+        int result = 0;
+        for (int l = 0; l < 4; l++)
+          result |= a_m.v[l] ? (1 << l) : 0;
+        return result;
+      }
+
+      // Lane l of the result is lane (l + N) % 4 of the input
+      template<int N>
+      static Float4 Rotate(Float4 a_a)                      { return Map([&](int l) { return a_a.v[(l + N) & 3]; }); }
+#endif
+
+      static Float4 Load(RGBA const & a_px)
+      {
+        return Load(a_px.v);
+      }
+
+      static RGBA ToRGBA(Float4 a_v)
+      {
+        RGBA result;
+        Store(result.v, a_v);
+        return result;
+      }
+
+      // a + (b - a) * t
+      static Float4 Mix(Float4 a_a, Float4 a_b, Float4 a_t)
+      {
+        return Add(a_a, Mul(Sub(a_b, a_a), a_t));
+      }
+
+      // Sum of the lanes, added in order
+      static float Sum(Float4 a_v)
+      {
+        float lanes[4];
+        Store(lanes, a_v);
+        return ((lanes[0] + lanes[1]) + lanes[2]) + lanes[3];
+      }
+
+      static Float4 Smoothstep(Float4 a_edge0, Float4 a_edge1, Float4 a_x)
+      {
+        Float4 t = Min(Max(Div(Sub(a_x, a_edge0), Sub(a_edge1, a_edge0)), Set1(0.f)), Set1(1.f));
+        return Mul(Mul(t, t), Sub(Set1(3.f), Mul(Set1(2.f), t)));
+      }
+    }
+
+    //------------------------------------------------------------------------------------------------
+    // xBR
+    //------------------------------------------------------------------------------------------------
+
+    // xBR level 2, after Hyllian's shader. Edges are detected in 4 lanes, one per corner of the
+    // pixel, each rotated so its corner is the bottom right:
+    //   lane 0: bottom right, 1: top right, 2: top left, 3: bottom left
+    // Neighbours are named as in the shader:
+    //          A1 B1 C1
+    //       A0  A  B  C C4
+    //       D0  D  E  F F4
+    //       G0  G  H  I I4
+    //          G5 H5 I5
+    // The lanes are one SIMD register, and colours are one register of RGBA channels.
+    namespace xBR
+    {
+      using namespace SIMD;
+
+      static float const s_EqThreshold = 15.f;
+      static float const s_Coef = 2.f;
+
+      // Lines of the 45, 30 ('left') and 60 ('up') degree edges: A * fy + B * fx > C
+      static float const s_Ao[4] = {1.f, -1.f, -1.f, 1.f};
+      static float const s_Bo[4] = {1.f, 1.f, -1.f, -1.f};
+      static float const s_Co[4] = {1.5f, 0.5f, -0.5f, 0.5f};
+      static float const s_Ax[4] = {1.f, -1.f, -1.f, 1.f};
+      static float const s_Bx[4] = {0.5f, 2.f, -0.5f, -2.f};
+      static float const s_Cx[4] = {1.f, 1.f, -0.5f, 0.f};
+      static float const s_Ay[4] = {1.f, -1.f, -1.f, 1.f};
+      static float const s_By[4] = {2.f, 0.5f, -2.f, -0.5f};
+      static float const s_Cy[4] = {2.f, 0.f, -1.f, 0.5f};
+
+      // Luma, on the shader's scale of [0, 48]. Transparent pixels are pushed below the range,
+      // so they never match opaque ones.
+      static float GetKey(RGBA const & a_px)
+      {
+        float alpha = a_px.v[3] / 255.f;
+        float y = (14.352f * a_px.v[0] + 28.176f * a_px.v[1] + 5.472f * a_px.v[2]) / 255.f;
+        return alpha * y - (1.f - alpha) * 48.f;
+      }
+
+      static Mask4 Eq(Float4 a_a, Float4 a_b)
+      {
+        return Less(Abs(Sub(a_a, a_b)), Set1(s_EqThreshold));
+      }
+
+      static Mask4 NotEq(Float4 a_a, Float4 a_b)
+      {
+        return GreaterEqual(Abs(Sub(a_a, a_b)), Set1(s_EqThreshold));
+      }
+
+      static Float4 WeightedDistance(Float4 a, Float4 b, Float4 c, Float4 d, Float4 e, Float4 f, Float4 g, Float4 h)
+      {
+        Float4 result = Add(Abs(Sub(a, b)), Abs(Sub(a, c)));
+        result = Add(result, Abs(Sub(d, e)));
+        result = Add(result, Abs(Sub(d, f)));
+        return Add(result, Mul(Set1(4.f), Abs(Sub(g, h))));
+      }
+
+      // The line 'A * fy + B * fx > C', anti-aliased over 'delta' either side
+      struct EdgeLine
+      {
+        EdgeLine(float const * a_pA, float const * a_pB, float const * a_pC, float a_delta)
+          : a(Load(a_pA))
+          , b(Load(a_pB))
+          , lower(Sub(Load(a_pC), Set1(a_delta)))
+          , upper(Add(Load(a_pC), Set1(a_delta)))
+        {
+
+        }
+
+        Float4 Coverage(Float4 a_fy, Float4 a_fx) const
+        {
+          return Smoothstep(lower, upper, Add(Mul(a, a_fy), Mul(b, a_fx)));
+        }
+
+        Float4 a, b, lower, upper;
+      };
+
+      static void ScaleSlice(std::vector<RGBA> const & a_src, std::vector<float> const & a_keys, Sampler const & a_sampler,
+                             uint32_t a_factor, uint32_t a_rowBegin, uint32_t a_rowEnd, RGBA * a_pOut)
+      {
+        size_t outWidth = size_t(a_sampler.width) * a_factor;
+
+        // Anti-aliases the edges over one output pixel
+        float delta = 0.5f / float(a_factor);
+        EdgeLine const line45(s_Ao, s_Bo, s_Co, delta);
+        EdgeLine const line30(s_Ax, s_Bx, s_Cx, delta);
+        EdgeLine const line60(s_Ay, s_By, s_Cy, delta);
+
+        Float4 const zero = Set1(0.f);
+        Float4 const one = Set1(1.f);
+        Float4 const coef = Set1(s_Coef);
+
+        for (int32_t y = int32_t(a_rowBegin); y < int32_t(a_rowEnd); y++)
+        {
+          for (int32_t x = 0; x < a_sampler.width; x++)
+          {
+            auto K = [&a_keys, &a_sampler, x, y](int32_t a_dx, int32_t a_dy)
+            {
+              return a_keys[a_sampler.Index(x + a_dx, y + a_dy)];
+            };
+
+            float const bKeys[4] = {K(0, -1), K(-1, 0), K(0, 1), K(1, 0)};     // B D H F
+            float const cKeys[4] = {K(1, -1), K(-1, -1), K(-1, 1), K(1, 1)};   // C A G I
+            float const i4Keys[4] = {K(2, 1), K(1, -2), K(-2, -1), K(-1, 2)};  // I4 C1 A0 G5
+            float const i5Keys[4] = {K(1, 2), K(2, -1), K(-1, -2), K(-2, 1)};  // I5 C4 A1 G0
+            float const h5Keys[4] = {K(0, 2), K(2, 0), K(0, -2), K(-2, 0)};    // H5 F4 B1 D0
+
+            Float4 e = Set1(K(0, 0));
+            Float4 b = Load(bKeys);
+            Float4 c = Load(cKeys);
+            Float4 i4 = Load(i4Keys);
+            Float4 i5 = Load(i5Keys);
+            Float4 h5 = Load(h5Keys);
+
+            // The other neighbours are those of another lane
+            Float4 d = Rotate<1>(b);
+            Float4 f = Rotate<3>(b);
+            Float4 h = Rotate<2>(b);
+            Float4 g = Rotate<2>(c);
+            Float4 i = Rotate<3>(c);
+            Float4 f4 = Rotate<1>(h5);
+
+            Mask4 lv1 = And(And(NotEqual(e, f), NotEqual(e, h)),
+              Or(Or(And(NotEq(f, b), NotEq(h, d)), And(And(Eq(e, i), NotEq(f, i4)), NotEq(h, i5))),
+                 Or(Eq(e, g), Eq(e, c))));
+            Mask4 lv2Left = And(NotEqual(e, g), NotEqual(d, g));
+            Mask4 lv2Up = And(NotEqual(e, c), NotEqual(b, c));
+
+            Mask4 edge = And(Less(WeightedDistance(e, c, g, i, h5, f4, h, f), WeightedDistance(h, d, i5, f, i4, b, e, i)), lv1);
+            if (Bits(edge) == 0)
+            {
+              RGBA const & colE = a_src[a_sampler.Index(x, y)];
+              for (uint32_t sy = 0; sy < a_factor; sy++)
+              {
+                RGBA * pOut = a_pOut + (size_t(y) * a_factor + sy) * outWidth + size_t(x) * a_factor;
+                for (uint32_t sx = 0; sx < a_factor; sx++)
+                  pOut[sx] = colE;
+              }
+              continue;
+            }
+
+            Float4 fg = Abs(Sub(f, g));
+            Float4 hc = Abs(Sub(h, c));
+            Float4 edr = Select(edge, one, zero);
+            Float4 edrLeft = Select(And(And(LessEqual(Mul(coef, fg), hc), lv2Left), edge), one, zero);
+            Float4 edrUp = Select(And(And(GreaterEqual(fg, Mul(coef, hc)), lv2Up), edge), one, zero);
+            int px = Bits(LessEqual(Abs(Sub(e, f)), Abs(Sub(e, h))));
+
+            // Each lane blends towards whichever of its F and H is closer to E
+            Float4 colE = Load(a_src[a_sampler.Index(x, y)]);
+            Float4 colB[4] =
+            {
+              Load(a_src[a_sampler.Index(x, y - 1)]),
+              Load(a_src[a_sampler.Index(x - 1, y)]),
+              Load(a_src[a_sampler.Index(x, y + 1)]),
+              Load(a_src[a_sampler.Index(x + 1, y)])
+            };
+            Float4 colLane[4];
+            for (int l = 0; l < 4; l++)
+              colLane[l] = (px & (1 << l)) ? colB[(l + 3) & 3] : colB[(l + 2) & 3];
+
+            for (uint32_t sy = 0; sy < a_factor; sy++)
+            {
+              Float4 fy = Set1((float(sy) + 0.5f) / float(a_factor));
+              RGBA * pOut = a_pOut + (size_t(y) * a_factor + sy) * outWidth + size_t(x) * a_factor;
+
+              for (uint32_t sx = 0; sx < a_factor; sx++)
+              {
+                Float4 fx = Set1((float(sx) + 0.5f) / float(a_factor));
+
+                Float4 fx45 = Mul(edr, line45.Coverage(fy, fx));
+                Float4 fx30 = Mul(edrLeft, line30.Coverage(fy, fx));
+                Float4 fx60 = Mul(edrUp, line60.Coverage(fy, fx));
+
+                float maximo[4];
+                Store(maximo, Max(Max(fx30, fx60), fx45));
+
+                // Opposite corners are blended together, then the result furthest from E is kept
+                Float4 res1 = Mix(colE, colLane[0], Set1(maximo[0]));
+                res1 = Mix(res1, colLane[2], Set1(maximo[2]));
+                Float4 res2 = Mix(colE, colLane[1], Set1(maximo[1]));
+                res2 = Mix(res2, colLane[3], Set1(maximo[3]));
+
+                float dist1 = Sum(Abs(Sub(colE, res1)));
+                float dist2 = Sum(Abs(Sub(colE, res2)));
+                pOut[sx] = ToRGBA(dist2 >= dist1 ? res2 : res1);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    //------------------------------------------------------------------------------------------------
+    // Mipmaps
+    //------------------------------------------------------------------------------------------------
+
+    namespace Mipmap
+    {
+      // Kaiser windowed sinc, 2 lobes either side
+      static double const s_KaiserLobes = 2.0;
+      static double const s_KaiserAlpha = 4.0;
+
+      struct Tap
+      {
+        uint32_t  index;
+        float     weight;
+      };
+
+      // The taps of each destination pixel along one axis
+      struct Filter1D
+      {
+        std::vector<size_t> offsets;
+        std::vector<Tap>    taps;
+      };
+
+      // Modified Bessel function of the first kind
+      static double BesselI0(double a_x)
+      {
+        double result = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 32; k++)
+        {
+          double t = a_x / (2.0 * k);
+          term *= t * t;
+          result += term;
+          if (term < result * 1e-12)
+            break;
+        }
+        return result;
+      }
+
+      static double KaiserSinc(double a_x)
+      {
+        double t = a_x / s_KaiserLobes;
+        if (t <= -1.0 || t >= 1.0)
+          return 0.0;
+
+        double const pi = 3.14159265358979323846;
+        double sinc = a_x == 0.0 ? 1.0 : sin(pi * a_x) / (pi * a_x);
+        return sinc * BesselI0(s_KaiserAlpha * sqrt(1.0 - t * t)) / BesselI0(s_KaiserAlpha);
+      }
+
+      static void BuildFilter(uint32_t a_srcSize, uint32_t a_dstSize, MipmapKernel a_kernel, TextureWrap a_wrap, Filter1D & a_out)
+      {
+        double scale = double(a_srcSize) / double(a_dstSize);
+
+        for (uint32_t i = 0; i < a_dstSize; i++)
+        {
+          size_t first = a_out.taps.size();
+          a_out.offsets.push_back(first);
+
+          if (a_kernel == MipmapKernel::Box)
+          {
+            // Average of the source pixels under the destination pixel. Source pixels split
+            // between two destination pixels, when the size is odd, count for part of each.
+            double begin = double(i) * scale;
+            double end = double(i + 1) * scale;
+            for (int32_t j = int32_t(floor(begin)); j < int32_t(ceil(end)); j++)
+            {
+              double weight = std::min(double(j + 1), end) - std::max(double(j), begin);
+              if (weight > 0.0)
+                a_out.taps.push_back(Tap{uint32_t(j), float(weight)});
+            }
+          }
+          else
+          {
+            double centre = (double(i) + 0.5) * scale;
+            double radius = s_KaiserLobes * scale;
+            for (int32_t j = int32_t(floor(centre - radius)); j <= int32_t(ceil(centre + radius)); j++)
+            {
+              double weight = KaiserSinc((double(j) + 0.5 - centre) / scale);
+              if (weight != 0.0)
+                a_out.taps.push_back(Tap{uint32_t(WrapIndex(j, int32_t(a_srcSize), a_wrap)), float(weight)});
+            }
+          }
+
+          float sum = 0.f;
+          for (size_t t = first; t < a_out.taps.size(); t++)
+            sum += a_out.taps[t].weight;
+          for (size_t t = first; t < a_out.taps.size(); t++)
+            a_out.taps[t].weight /= sum;
+        }
+        a_out.offsets.push_back(a_out.taps.size());
+      }
+
+      // Separable, horizontally into a float buffer, then vertically into the level
+      static void Downsample(TextureData const & a_in, MipmapKernel a_kernel, TextureData & a_out, uint32_t a_sliceCount)
+      {
+        uint32_t srcWidth = a_in.width;
+        uint32_t srcHeight = a_in.height;
+        uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+        uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+        size_t channels = GetPixelSize(a_in.attrs.GetPixelType());
+
+        Filter1D filterX, filterY;
+        BuildFilter(srcWidth, dstWidth, a_kernel, a_in.attrs.GetWrap(), filterX);
+        BuildFilter(srcHeight, dstHeight, a_kernel, a_in.attrs.GetWrap(), filterY);
+
+        std::vector<float> temp(size_t(dstWidth) * srcHeight * channels);
+        uint8_t * pPixels = new uint8_t[size_t(dstWidth) * dstHeight * channels];
+
+        ForEachSlice(srcHeight, a_sliceCount, [&](uint32_t a_begin, uint32_t a_end)
+        {
+          for (uint32_t y = a_begin; y < a_end; y++)
+          {
+            uint8_t const * pSrcRow = a_in.pPixels + size_t(y) * srcWidth * channels;
+            float * pDstRow = temp.data() + size_t(y) * dstWidth * channels;
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+              float acc[4] = {};
+              for (size_t t = filterX.offsets[x]; t < filterX.offsets[x + 1]; t++)
+              {
+                Tap const & tap = filterX.taps[t];
+                for (size_t c = 0; c < channels; c++)
+                  acc[c] += float(pSrcRow[tap.index * channels + c]) * tap.weight;
+              }
+              for (size_t c = 0; c < channels; c++)
+                pDstRow[x * channels + c] = acc[c];
+            }
+          }
+        });
+
+        ForEachSlice(dstHeight, a_sliceCount, [&](uint32_t a_begin, uint32_t a_end)
+        {
+          for (uint32_t y = a_begin; y < a_end; y++)
+          {
+            uint8_t * pDstRow = pPixels + size_t(y) * dstWidth * channels;
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+              float acc[4] = {};
+              for (size_t t = filterY.offsets[y]; t < filterY.offsets[y + 1]; t++)
+              {
+                Tap const & tap = filterY.taps[t];
+                float const * pSrc = temp.data() + (size_t(tap.index) * dstWidth + x) * channels;
+                for (size_t c = 0; c < channels; c++)
+                  acc[c] += pSrc[c] * tap.weight;
+              }
+
+              // The Kaiser kernel has negative lobes, so can overshoot
+              for (size_t c = 0; c < channels; c++)
+                pDstRow[x * channels + c] = uint8_t(std::min(std::max(acc[c] + 0.5f, 0.f), 255.f));
+            }
+          }
+        });
+
+        a_out.Set(dstWidth, dstHeight, pPixels, a_in.attrs);
+      }
+    }
+
+    //------------------------------------------------------------------------------------------------
+    // TextureProcessing
+    //------------------------------------------------------------------------------------------------
+
+    Dg::ErrorCode Upscale(TextureData const & a_in, ResizeMethod a_method, uint32_t a_factor, TextureData & a_out, uint32_t a_sliceCount)
+    {
+      if (a_in.pPixels == nullptr)
+        return Dg::ErrorCode::NullObject;
+
+      if (a_factor < 2 || a_factor > 4)
+        return Dg::ErrorCode::OutOfBounds;
+
+      Sampler sampler = {int32_t(a_in.width), int32_t(a_in.height), a_in.attrs.GetWrap()};
+      std::vector<RGBA> src = ToRGBA(a_in);
+      std::vector<RGBA> scaled(src.size() * a_factor * a_factor);
+
+      switch (a_method)
+      {
+        case ResizeMethod::HQx:
+        {
+          LOG_WARN("TextureProcessing::Upscale(): hqx is not implemented, use ResizeMethod::BRz");
+          return Dg::ErrorCode::Failure;
+        }
+        case ResizeMethod::BRz:
+        {
+          std::vector<float> keys(src.size());
+          for (size_t i = 0; i < src.size(); i++)
+            keys[i] = xBR::GetKey(src[i]);
+
+          ForEachSlice(a_in.height, a_sliceCount, [&](uint32_t a_begin, uint32_t a_end)
+          {
+            xBR::ScaleSlice(src, keys, sampler, a_factor, a_begin, a_end, scaled.data());
+          });
+          break;
+        }
+        default:
+        {
+          return Dg::ErrorCode::Failure;
+        }
+      }
+
+      a_out.Set(a_in.width * a_factor, a_in.height * a_factor, FromRGBA(scaled, a_in.attrs.GetPixelType()), a_in.attrs);
+      return Dg::ErrorCode::None;
+    }
+
+    Dg::ErrorCode UpscaleCached(TextureData const & a_in, ResizeMethod a_method, uint32_t a_factor, TextureData & a_out, uint32_t a_sliceCount,
+                                std::string const & a_directory)
+    {
+      if (a_in.pPixels == nullptr)
+        return Dg::ErrorCode::NullObject;
+
+      uint32_t method = static_cast<uint32_t>(a_method);
+      uint32_t attrs = a_in.attrs.GetData();
+      size_t inSize = size_t(a_in.width) * a_in.height * GetPixelSize(a_in.attrs.GetPixelType());
+      size_t outSize = inSize * a_factor * a_factor;
+
+      uint64_t key = 0xCBF29CE484222325ULL;
+      key = Hash(key, &s_Version, sizeof(s_Version));
+      key = Hash(key, &method, sizeof(method));
+      key = Hash(key, &a_factor, sizeof(a_factor));
+      key = Hash(key, &a_in.width, sizeof(a_in.width));
+      key = Hash(key, &a_in.height, sizeof(a_in.height));
+      key = Hash(key, &attrs, sizeof(attrs));
+      key = Hash(key, a_in.pPixels, inSize);
+
+      std::filesystem::path path = GetPath(a_directory, key);
+
+      // Hit
+      {
+        std::ifstream ifs(path, std::ios::binary);
+        FileHeader header = {};
+        if (ifs.good()
+          && ifs.read(reinterpret_cast<char *>(&header), sizeof(header))
+          && header.magic == s_Magic
+          && header.version == s_Version
+          && header.key == key
+          && header.width == a_in.width * a_factor
+          && header.height == a_in.height * a_factor
+          && header.attrs == attrs)
+        {
+          uint8_t * pPixels = new uint8_t[outSize];
+          if (ifs.read(reinterpret_cast<char *>(pPixels), outSize))
+          {
+            a_out.Set(header.width, header.height, pPixels, a_in.attrs);
+            return Dg::ErrorCode::None;
+          }
+
+          LOG_WARN("TextureProcessing: Cache file '{}' is truncated", path.string());
+          delete[] pPixels;
+        }
+      }
+
+      // Miss
+      Dg::ErrorCode result = Upscale(a_in, a_method, a_factor, a_out, a_sliceCount);
+      if (result != Dg::ErrorCode::None)
+        return result;
+
+      std::error_code ec;
+      std::filesystem::create_directories(a_directory, ec);
+      if (ec)
+      {
+        LOG_WARN("TextureProcessing: Failed to create directory '{}': {}", a_directory, ec.message());
+        return Dg::ErrorCode::None;
+      }
+
+      FileHeader header = {};
+      header.magic = s_Magic;
+      header.version = s_Version;
+      header.key = key;
+      header.width = a_out.width;
+      header.height = a_out.height;
+      header.attrs = attrs;
+
+      // Write to a temporary file first so a crash can never leave a half written texture
+      std::filesystem::path tempPath = path;
+      tempPath += ".tmp";
+      {
+        std::ofstream ofs(tempPath, std::ios::binary | std::ios::trunc);
+        if (!ofs.write(reinterpret_cast<char const *>(&header), sizeof(header))
+          || !ofs.write(reinterpret_cast<char const *>(a_out.pPixels), outSize))
+        {
+          LOG_WARN("TextureProcessing: Failed to write '{}'", tempPath.string());
+          ofs.close();
+          std::filesystem::remove(tempPath, ec);
+          return Dg::ErrorCode::None;
+        }
+      }
+
+      std::filesystem::rename(tempPath, path, ec);
+      if (ec)
+      {
+        LOG_WARN("TextureProcessing: Failed to write '{}': {}", path.string(), ec.message());
+        std::filesystem::remove(tempPath, ec);
+      }
+
+      return Dg::ErrorCode::None;
+    }
+
+    Dg::ErrorCode GenerateMipmaps(TextureData const & a_in, MipmapKernel a_kernel, std::vector<TextureData> & a_out, uint32_t a_sliceCount)
+    {
+      a_out.clear();
+
+      if (a_in.pPixels == nullptr)
+        return Dg::ErrorCode::NullObject;
+
+      size_t levelCount = 0;
+      for (uint32_t w = a_in.width, h = a_in.height; w > 1 || h > 1; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+        levelCount++;
+
+      // Each level points at the one before, so must not move
+      a_out.reserve(levelCount);
+
+      TextureData const * pSrc = &a_in;
+      for (size_t i = 0; i < levelCount; i++)
+      {
+        a_out.push_back(TextureData());
+        Mipmap::Downsample(*pSrc, a_kernel, a_out.back(), a_sliceCount);
+        pSrc = &a_out.back();
+      }
+
+      return Dg::ErrorCode::None;
+    }
+  }
+}
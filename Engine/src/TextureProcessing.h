@@ -0,0 +1,37 @@
+//@group Renderer
+
+#ifndef TEXTUREPROCESSING_H
+#define TEXTUREPROCESSING_H
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "TextureData.h"
+#include "DgError.h"
+#include "Options.h"
+
+namespace Engine
+{
+  // CPU side texture processing, done once at load time. Work is split into slices of rows,
+  // which are run on the JobPool. A slice count of 0 gives one slice per pool thread. Edge
+  // pixels are sampled with the texture's wrap mode.
+  namespace TextureProcessing
+  {
+    // Scales 'in' up by a factor of 2, 3 or 4.
+    //   HQx: Not implemented yet, returns Dg::ErrorCode::Failure.
+    //   BRz: xBR level 2. Follows edges up to 60 degrees. Good for sprites.
+    Dg::ErrorCode Upscale(TextureData const & in, ResizeMethod, uint32_t factor, TextureData & out, uint32_t sliceCount = 0);
+
+    // As Upscale, but results are saved to 'directory', keyed by a hash of the pixels,
+    // method and factor, so a texture is only upscaled the first time it is seen.
+    Dg::ErrorCode UpscaleCached(TextureData const & in, ResizeMethod, uint32_t factor, TextureData & out, uint32_t sliceCount = 0,
+                                std::string const & directory = TEXTURE_CACHE_DIR);
+
+    // Builds levels 1 to N of the mip chain of 'in', down to 1x1. Each level is filtered
+    // from the one before it.
+    Dg::ErrorCode GenerateMipmaps(TextureData const & in, MipmapKernel, std::vector<TextureData> & out, uint32_t sliceCount = 0);
+  }
+}
+
+#endif
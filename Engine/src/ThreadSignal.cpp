@@ -0,0 +1,23 @@
+//@group Core
+
+#include "ThreadSignal.h"
+
+namespace Engine
+{
+  ThreadSignal::ThreadSignal()
+    : m_mutex()
+    , m_cv()
+  {
+
+  }
+
+  void ThreadSignal::Notify()
+  {
+    // Taking the lock makes sure we cannot notify between the waiting thread
+    // checking the predicate and going to sleep.
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_cv.notify_all();
+  }
+}
\ No newline at end of file
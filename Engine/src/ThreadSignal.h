@@ -0,0 +1,65 @@
+//@group Core
+
+#ifndef THREADSIGNAL_H
+#define THREADSIGNAL_H
+
+#include <stdint.h>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+
+#include "Options.h"
+
+namespace Engine
+{
+  // Lets a thread wait on some state which another thread will change. The waiting
+  // thread spins for a short while in case the wait is short, then goes to sleep until
+  // it is notified.
+  class ThreadSignal
+  {
+  public:
+
+    ThreadSignal();
+
+    // Call after changing the state the other thread is waiting on.
+    void Notify();
+
+    // Waits until pred() returns true. Returns the time spent waiting in microseconds.
+    template<typename Pred>
+    uint64_t Wait(Pred a_pred)
+    {
+      if (a_pred())
+        return 0;
+
+      auto start = std::chrono::steady_clock::now();
+
+      bool done = false;
+      for (uint32_t i = 0; i < THREAD_SIGNAL_SPIN_COUNT; i++)
+      {
+        std::this_thread::yield();
+        if (a_pred())
+        {
+          done = true;
+          break;
+        }
+      }
+
+      if (!done)
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, a_pred);
+      }
+
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+
+  private:
+
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+  };
+}
+
+#endif
\ No newline at end of file